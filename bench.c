@@ -0,0 +1,1066 @@
+#define _GNU_SOURCE
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "my_scanf.h"
+#include "scan_generated.h"
+#include "scan_simd.h"
+#include "scan_stats.h"
+
+// Benchmark suite. Every corpus is generated from a fixed seed so runs are
+// reproducible, and every result goes to stdout and bench_output.txt.
+// Usage: ./bench [--size MB] [--seed N]
+
+// Default size of each generated per-specifier corpus
+#define DEFAULT_CORPUS_MB 8
+
+// Size of the padded lzbop.txt corpus for the whitespace benchmarks
+#define PADDED_CORPUS_BYTES (64u << 20)
+
+// A generated corpus: newline-separated fields of one kind
+typedef struct corpus {
+    char *text;
+    size_t len;
+    size_t fields;
+} corpus;
+
+typedef void (*field_gen_fn)(char *out, size_t *len, unsigned long long *seed);
+
+// What a benchmarked format assigns, so the timing loops pass the right pointers
+enum bench_args {
+    ARGS_INT,       // int
+    ARGS_WIDE,      // long long / unsigned long long
+    ARGS_DOUBLE,    // double
+    ARGS_STRING,    // char[256]
+    ARGS_RECORD     // int, double, char[256], unsigned int
+};
+
+// strto* loop to compare against, if any
+enum baseline {
+    BASELINE_NONE,
+    BASELINE_STRTOLL,
+    BASELINE_STRTOULL_16,
+    BASELINE_STRTOULL_2,
+    BASELINE_STRTOD
+};
+
+typedef struct spec_bench {
+    const char *name;
+    field_gen_fn gen;
+    enum bench_args args;
+    const char *ours;  // Format for scanner_scanf
+    const char *glibc; // Same fields for fscanf, or NULL when glibc has no equivalent
+    enum baseline baseline;
+} spec_bench;
+
+// Corpus generators
+unsigned long long next_random(unsigned long long *seed);
+void gen_int(char *out, size_t *len, unsigned long long *seed);
+void gen_float(char *out, size_t *len, unsigned long long *seed);
+void gen_hex(char *out, size_t *len, unsigned long long *seed);
+void gen_binary(char *out, size_t *len, unsigned long long *seed);
+void gen_roman(char *out, size_t *len, unsigned long long *seed);
+void gen_word(char *out, size_t *len, unsigned long long *seed);
+void gen_record(char *out, size_t *len, unsigned long long *seed);
+int make_corpus(corpus *c, field_gen_fn gen, size_t bytes, unsigned long long seed);
+char *make_padded_corpus(const char *path, size_t target, size_t *len);
+char *make_id_value_records(size_t count, size_t *len);
+
+// Benchmarks
+void bench_specifiers(size_t bytes, unsigned long long seed);
+void bench_whitespace(const char *text, size_t len);
+void bench_scanset(const char *text, size_t len);
+void bench_intern(size_t bytes, unsigned long long seed);
+void bench_batch(void);
+void bench_suppress(void);
+void bench_lines(void);
+void bench_readahead(size_t bytes, unsigned long long seed);
+void bench_index(void);
+void bench_registry(void);
+void bench_parallel(void);
+
+// Helpers
+double time_ours(const corpus *c, const spec_bench *b, size_t *fields);
+double time_glibc(const corpus *c, const spec_bench *b, size_t *fields);
+double time_baseline(const corpus *c, enum baseline which, size_t *fields);
+void report(const char *format, ...);
+double now_seconds(void);
+const char *parse_ipv4(const char *p, const char *end, uint32_t *addr);
+int convert_ipv4(scanner *sc, const scan_program *prog, const scan_op *op, void *dst);
+size_t batch_ipv4(scanner *sc, const scan_op *op, char *dst, size_t stride, size_t rows);
+
+static FILE *output;
+
+int main(int argc, char **argv) {
+    size_t megabytes = DEFAULT_CORPUS_MB;
+    unsigned long long seed = 88172645463325252ULL;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--size") == 0) {
+            megabytes = strtoull(argv[i + 1], NULL, 10);
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            seed = strtoull(argv[i + 1], NULL, 0);
+        }
+    }
+
+    output = fopen("bench_output.txt", "w");
+    if (output == NULL) {
+        printf("Could not open bench_output.txt\n");
+        return 1;
+    }
+    const char *levels[] = {"scalar", "sse2", "ssse3", "avx2"};
+    report("SIMD level %s, %zu MB per corpus, seed %llu\n\n", levels[scan_simd_level()],
+           megabytes, seed);
+
+    bench_specifiers(megabytes << 20, seed);
+
+    size_t len;
+    char *padded = make_padded_corpus("lzbop.txt", PADDED_CORPUS_BYTES, &len);
+    if (padded != NULL) {
+        bench_whitespace(padded, len);
+        bench_scanset(padded, len);
+        free(padded);
+    } else {
+        report("Could not build corpus from lzbop.txt\n\n");
+    }
+
+    bench_intern(megabytes << 20, seed);
+    bench_batch();
+    bench_suppress();
+    bench_lines();
+    bench_readahead(megabytes << 22, seed);
+    bench_index();
+    bench_registry();
+    bench_parallel();
+
+    // Per-specifier counters for everything above (only with -DMY_SCANF_STATS)
+    if (scan_stats_enabled()) {
+        scan_stats_snapshot snap;
+        scan_stats_snapshot_take(&snap);
+        report("Per-specifier statistics\n");
+        scan_stats_print(stdout, &snap);
+        scan_stats_print(output, &snap);
+    }
+
+    fclose(output);
+    return 0;
+}
+
+// CORPUS GENERATORS //
+
+unsigned long long next_random(unsigned long long *seed) {
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 7;
+    *seed ^= *seed << 17;
+    return *seed;
+}
+
+// Integers of 1 to 18 digits, a third of them negative
+void gen_int(char *out, size_t *len, unsigned long long *seed) {
+    unsigned long long r = next_random(seed);
+    long long value = (long long)(r % 1000000000000000000ULL) >> (r % 60);
+    if (r % 3 == 0) {
+        value = -value;
+    }
+    *len += (size_t)sprintf(out + *len, "%lld\n", value);
+}
+
+// Doubles with 6 to 17 significant digits and exponents from -300 to 300
+void gen_float(char *out, size_t *len, unsigned long long *seed) {
+    unsigned long long r = next_random(seed);
+    double value = (double)(r >> 11) / (double)(1ULL << 53) + 1.0;
+    int exponent = (int)(r % 601) - 300;
+    *len += (size_t)sprintf(out + *len, "%.*fe%d\n", 5 + (int)(r % 12), value, exponent);
+}
+
+// 64-bit IDs as 1 to 16 hex digits, half of them with a 0x prefix
+void gen_hex(char *out, size_t *len, unsigned long long *seed) {
+    unsigned long long r = next_random(seed);
+    *len += (size_t)sprintf(out + *len, (r & 1) ? "0x%llx\n" : "%llx\n", r >> (r % 60));
+}
+
+// Bitmasks of 1 to 64 binary digits
+void gen_binary(char *out, size_t *len, unsigned long long *seed) {
+    int bits = 1 + (int)(next_random(seed) % 64);
+    unsigned long long mask = next_random(seed);
+    for (int i = bits - 1; i >= 0; i--) {
+        out[(*len)++] = (char)('0' + ((mask >> i) & 1));
+    }
+    out[(*len)++] = '\n';
+}
+
+// Roman numerals for 1 to 3999
+void gen_roman(char *out, size_t *len, unsigned long long *seed) {
+    static const int values[] = {1000, 900, 500, 400, 100, 90, 50, 40, 10, 9, 5, 4, 1};
+    static const char *symbols[] = {"M", "CM", "D", "CD", "C", "XC", "L", "XL", "X", "IX", "V", "IV", "I"};
+    int n = 1 + (int)(next_random(seed) % 3999);
+    for (int i = 0; i < 13; i++) {
+        while (n >= values[i]) {
+            size_t k = strlen(symbols[i]);
+            memcpy(out + *len, symbols[i], k);
+            *len += k;
+            n -= values[i];
+        }
+    }
+    out[(*len)++] = '\n';
+}
+
+// Identifiers of 1 to 24 word characters
+void gen_word(char *out, size_t *len, unsigned long long *seed) {
+    static const char chars[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_";
+    int n = 1 + (int)(next_random(seed) % 24);
+    for (int i = 0; i < n; i++) {
+        out[(*len)++] = chars[next_random(seed) % (sizeof(chars) - 1)];
+    }
+    out[(*len)++] = '\n';
+}
+
+// Mixed records: "id,value name flags"
+void gen_record(char *out, size_t *len, unsigned long long *seed) {
+    unsigned long long r = next_random(seed);
+    *len += (size_t)sprintf(out + *len, "%llu,%.*f ", r % 10000000, (int)(r % 7),
+                            (double)(r % 100000) / 7.0);
+    gen_word(out, len, seed);
+    out[*len - 1] = ' '; // Word and flags share the line
+    *len += (size_t)sprintf(out + *len, "%llx\n", next_random(seed) >> 40);
+}
+
+// Generates fields until the corpus holds at least bytes
+int make_corpus(corpus *c, field_gen_fn gen, size_t bytes, unsigned long long seed) {
+    c->text = malloc(bytes + 256); // Room for the last field
+    if (c->text == NULL) {
+        return -1;
+    }
+    c->len = 0;
+    c->fields = 0;
+    while (c->len < bytes) {
+        gen(c->text, &c->len, &seed);
+        c->fields++;
+    }
+    c->text[c->len] = '\0';
+    return 0;
+}
+
+// Repeats the file until target bytes, right-padding every token to a
+// 24-column field the way column-aligned logs are laid out
+char *make_padded_corpus(const char *path, size_t target, size_t *len) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        return NULL;
+    }
+
+    char *out = malloc(target);
+    if (out == NULL) {
+        fclose(fp);
+        return NULL;
+    }
+
+    size_t used = 0;
+    char token[256];
+    while (used < target) {
+        if (fscanf(fp, "%255s", token) != 1) {
+            rewind(fp);
+            out[used++] = '\n';
+            continue;
+        }
+        size_t n = strlen(token);
+        size_t field = n < 24 ? 24 : n + 1;
+        if (used + field > target) {
+            break;
+        }
+        memcpy(out + used, token, n);
+        memset(out + used + n, ' ', field - n);
+        used += field;
+    }
+
+    fclose(fp);
+    *len = used;
+    return out;
+}
+
+// Sequential "id,value" records, one per line
+char *make_id_value_records(size_t count, size_t *len) {
+    char *text = malloc(count * 32);
+    if (text == NULL) {
+        return NULL;
+    }
+    *len = 0;
+    for (size_t i = 0; i < count; i++) {
+        *len += (size_t)sprintf(text + *len, "%zu,%zu.%03zu\n", i, i % 9973, i % 1000);
+    }
+    return text;
+}
+
+// BENCHMARKS //
+
+void bench_specifiers(size_t bytes, unsigned long long seed) {
+    static const spec_bench benches[] = {
+        {"%lld", gen_int, ARGS_WIDE, "%lld", "%lld%n", BASELINE_STRTOLL},
+        {"%lf", gen_float, ARGS_DOUBLE, "%lf", "%lf%n", BASELINE_STRTOD},
+        {"%llx", gen_hex, ARGS_WIDE, "%llx", "%llx%n", BASELINE_STRTOULL_16},
+        {"%llb", gen_binary, ARGS_WIDE, "%llb", NULL, BASELINE_STRTOULL_2},
+        {"%r", gen_roman, ARGS_INT, "%r", NULL, BASELINE_NONE},
+        {"%w", gen_word, ARGS_STRING, "%255w", " %255[A-Za-z0-9_]%n", BASELINE_NONE},
+        {"%s", gen_word, ARGS_STRING, "%255s", "%255s%n", BASELINE_NONE},
+        {"record", gen_record, ARGS_RECORD, "%d,%lf %255w %x", "%d,%lf %255[A-Za-z0-9_] %x%n",
+         BASELINE_NONE},
+    };
+    const char *baseline_names[] = {"", "strtoll", "strtoull", "strtoull", "strtod"};
+
+    report("Per-specifier throughput (fscanf reads the same corpus through fmemopen)\n");
+    report("%-7s %8s | %-18s | %-18s | %s\n", "spec", "fields", "my_scanf MB/s  ns", "fscanf MB/s  ns",
+           "strto* MB/s  ns");
+
+    for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+        const spec_bench *b = &benches[i];
+        corpus c;
+        if (make_corpus(&c, b->gen, bytes, seed + i) != 0) {
+            report("%-7s out of memory\n", b->name);
+            continue;
+        }
+        double mb = c.len / 1e6;
+
+        size_t ours_fields;
+        double ours = time_ours(&c, b, &ours_fields);
+        report("%-7s %8zu | %8.1f %9.1f |", b->name, c.fields, mb / ours, ours * 1e9 / c.fields);
+
+        if (b->glibc != NULL) {
+            size_t glibc_fields;
+            double glibc = time_glibc(&c, b, &glibc_fields);
+            report(" %8.1f %9.1f |", mb / glibc, glibc * 1e9 / c.fields);
+            if (glibc_fields != ours_fields) {
+                report(" (FIELD COUNT MISMATCH)");
+            }
+        } else {
+            report(" %8s %9s |", "-", "-");
+        }
+
+        if (b->baseline != BASELINE_NONE) {
+            size_t base_fields;
+            double base = time_baseline(&c, b->baseline, &base_fields);
+            report(" %8.1f %9.1f  %s", mb / base, base * 1e9 / c.fields, baseline_names[b->baseline]);
+        } else {
+            report(" %8s %9s", "-", "-");
+        }
+        report("%s\n", ours_fields == c.fields ? "" : "  (SHORT READ)");
+        free(c.text);
+    }
+    report("\n");
+}
+
+void bench_whitespace(const char *text, size_t len) {
+    const char *names[] = {"scalar", "sse2", "ssse3", "avx2"};
+    report("Whitespace skipping over %zu MiB of padded lzbop.txt\n", len >> 20);
+
+    for (int level = SCAN_SIMD_SCALAR; level <= SCAN_SIMD_AVX2; level++) {
+        scan_simd_force((enum scan_simd_level)level);
+        if ((int)scan_simd_level() != level) {
+            continue; // Not supported on this CPU
+        }
+
+        // Raw kernels: alternate between skipping whitespace and skipping a token
+        double start = now_seconds();
+        const char *p = text;
+        const char *end = text + len;
+        size_t tokens = 0;
+        while (p < end) {
+            p = find_non_whitespace(p, end);
+            p = find_whitespace(p, end);
+            tokens++;
+        }
+        double kernel_time = now_seconds() - start;
+
+        // Whole %s conversions through a memory scanner
+        scanner sc;
+        scanner_init_memory(&sc, text, len);
+        char word[4096];
+        start = now_seconds();
+        while (scanner_scanf(&sc, "%4095s", word) == 1) {
+        }
+        double scan_time = now_seconds() - start;
+
+        report("%-7s kernels %8.1f MB/s   %%s %8.1f MB/s   (%zu tokens)\n", names[level],
+               len / kernel_time / 1e6, len / scan_time / 1e6, tokens);
+    }
+
+    scan_simd_force(SCAN_SIMD_AVX2);
+    report("\n");
+}
+
+void bench_scanset(const char *text, size_t len) {
+    // The padded corpus with every space run turned into one '|' delimiter
+    char *delimited = malloc(len);
+    if (delimited == NULL) {
+        return;
+    }
+    size_t used = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (text[i] != ' ' && text[i] != '\n') {
+            delimited[used++] = text[i];
+        } else if (used > 0 && delimited[used - 1] != '|') {
+            delimited[used++] = '|';
+        }
+    }
+    report("Scanset %%[^|] over %.1f MB of '|'-delimited fields\n", used / 1e6);
+
+    const char *names[] = {"scalar", "sse2", "ssse3", "avx2"};
+    char field[4096];
+    for (int level = SCAN_SIMD_SCALAR; level <= SCAN_SIMD_AVX2; level++) {
+        scan_simd_force((enum scan_simd_level)level);
+        if ((int)scan_simd_level() != level) {
+            continue;
+        }
+        scanner sc;
+        scanner_init_memory(&sc, delimited, used);
+        size_t fields = 0;
+        double start = now_seconds();
+        while (scanner_scanf(&sc, "%4095[^|]|", field) == 1) {
+            fields++;
+        }
+        double elapsed = now_seconds() - start;
+        report("%-7s %8.1f MB/s  (%zu fields)\n", names[level], used / elapsed / 1e6, fields);
+    }
+    scan_simd_force(SCAN_SIMD_AVX2);
+    report("\n");
+    free(delimited);
+}
+
+void bench_intern(size_t bytes, unsigned long long seed) {
+    // A log-like corpus: a vocabulary of identifiers, each repeated many times
+    enum { VOCABULARY = 4096 };
+    char *words = malloc(VOCABULARY * 32);
+    size_t offsets[VOCABULARY + 1];
+    char *text = malloc(bytes + 64);
+    if (words == NULL || text == NULL) {
+        free(words);
+        free(text);
+        return;
+    }
+    size_t words_len = 0;
+    for (int i = 0; i < VOCABULARY; i++) {
+        offsets[i] = words_len;
+        gen_word(words, &words_len, &seed);
+    }
+    offsets[VOCABULARY] = words_len;
+    size_t len = 0;
+    size_t fields = 0;
+    while (len < bytes) {
+        size_t pick = next_random(&seed) % VOCABULARY;
+        size_t n = offsets[pick + 1] - offsets[pick];
+        memcpy(text + len, words + offsets[pick], n);
+        len += n;
+        fields++;
+    }
+    report("Identifiers over %.1f MB (%zu fields from %d distinct words)\n", len / 1e6, fields,
+           VOCABULARY);
+
+    scanner sc;
+    scanner_init_memory(&sc, text, len);
+    char word[256];
+    size_t copied = 0;
+    double start = now_seconds();
+    while (scanner_scanf(&sc, "%255w", word) == 1) {
+        copied++;
+    }
+    double copy_time = now_seconds() - start;
+
+    // Keeping every word: one arena string each, or one ID each
+    scan_arena arena;
+    scan_arena_init(&arena, 0);
+    scanner_init_memory(&sc, text, len);
+    scanner_set_arena(&sc, &arena);
+    char *kept;
+    size_t allocated = 0;
+    start = now_seconds();
+    while (scanner_scanf(&sc, "%mw", &kept) == 1) {
+        allocated++;
+    }
+    double alloc_time = now_seconds() - start;
+    size_t arena_bytes = arena.used;
+    scan_arena_destroy(&arena);
+
+    scan_intern table;
+    scan_intern_init(&table, VOCABULARY);
+    scanner_init_memory(&sc, text, len);
+    scanner_set_intern(&sc, &table);
+    unsigned int id;
+    size_t interned = 0;
+    start = now_seconds();
+    while (scanner_scanf(&sc, "%W", &id) == 1) {
+        interned++;
+    }
+    double intern_time = now_seconds() - start;
+
+    report("%%w copy %8.1f MB/s  %6.1f ns/field  (into one buffer)\n", len / copy_time / 1e6,
+           copy_time * 1e9 / fields);
+    report("%%mw     %8.1f MB/s  %6.1f ns/field  (%zu arena bytes kept)\n", len / alloc_time / 1e6,
+           alloc_time * 1e9 / fields, arena_bytes);
+    report("%%W id   %8.1f MB/s  %6.1f ns/field  (%u distinct, %zu string bytes)%s\n",
+           len / intern_time / 1e6, intern_time * 1e9 / fields, table.count, table.strings.used,
+           copied == fields && allocated == fields && interned == fields ? "" : "  (FIELD COUNT MISMATCH)");
+    report("\n");
+    scan_intern_destroy(&table);
+    free(words);
+    free(text);
+}
+
+void bench_batch(void) {
+    size_t count = 2000000;
+    size_t len;
+    char *text = make_id_value_records(count, &len);
+    int *ids = malloc(count * sizeof(int));
+    double *values = malloc(count * sizeof(double));
+    if (text == NULL || ids == NULL || values == NULL) {
+        free(text);
+        free(ids);
+        free(values);
+        return;
+    }
+    report("Record parsing over %zu rows (%.1f MB)\n", count, len / 1e6);
+
+    scanner sc;
+    scanner_init_memory(&sc, text, len);
+    size_t rows = 0;
+    double start = now_seconds();
+    while (rows < count && scanner_scanf(&sc, "%d,%f", &ids[rows], &values[rows]) == 2) {
+        rows++;
+    }
+    double per_row = now_seconds() - start;
+
+    scan_column columns[] = {{ids, sizeof(int)}, {values, sizeof(double)}};
+    scanner_init_memory(&sc, text, len);
+    size_t error;
+    start = now_seconds();
+    size_t batch_rows = scanner_batch(&sc, "%d,%f", columns, count, &error);
+    double batch = now_seconds() - start;
+
+    // Same format as a straight-line parser from scan_codegen
+    scanner_init_memory(&sc, text, len);
+    size_t generated_rows = 0;
+    start = now_seconds();
+    while (generated_rows < count &&
+           scan_id_value(&sc, &ids[generated_rows], &values[generated_rows]) == 2) {
+        generated_rows++;
+    }
+    double generated = now_seconds() - start;
+
+    report("per row %8.1f MB/s  %6.1f ns/row\n", len / per_row / 1e6, per_row * 1e9 / count);
+    report("batch   %8.1f MB/s  %6.1f ns/row%s\n", len / batch / 1e6, batch * 1e9 / count,
+           rows == batch_rows ? "" : "  (ROW COUNT MISMATCH)");
+    report("codegen %8.1f MB/s  %6.1f ns/row%s\n", len / generated / 1e6, generated * 1e9 / count,
+           rows == generated_rows ? "" : "  (ROW COUNT MISMATCH)");
+    report("\n");
+    free(text);
+    free(ids);
+    free(values);
+}
+
+void bench_suppress(void) {
+    // 20-column records (5 ints, 10 floats, 5 words), of which 3 are wanted
+    size_t count = 200000;
+    char *text = malloc(count * 256);
+    if (text == NULL) {
+        return;
+    }
+    size_t len = 0;
+    unsigned long long seed = 12345;
+    for (size_t i = 0; i < count; i++) {
+        for (int col = 0; col < 20; col++) {
+            unsigned long long r = next_random(&seed);
+            if (col % 4 == 0) {
+                len += (size_t)sprintf(text + len, "%llu", r % 1000000000);
+            } else if (col % 4 == 3) {
+                len += (size_t)sprintf(text + len, "w%llx", r >> 40);
+            } else {
+                len += (size_t)sprintf(text + len, "%.9e", (double)(r >> 11) / 1e3);
+            }
+            text[len++] = (col == 19) ? '\n' : ',';
+        }
+    }
+    report("Wide records: %zu rows of 20 columns (%.1f MB), 3 columns wanted\n", count, len / 1e6);
+
+    const char *all = "%d,%lf,%lf,%31w,%d,%lf,%lf,%31w,%d,%lf,%lf,%31w,%d,%lf,%lf,%31w,%d,%lf,%lf,%31w\n";
+    const char *picked = "%*d,%*f,%lf,%*w,%*d,%*f,%*f,%*w,%d,%*f,%*f,%*w,%*d,%*f,%*f,%31w,%*d,%*f,%*f,%*w\n";
+    int ints[5];
+    double floats[10];
+    char words[5][32];
+
+    scanner sc;
+    scanner_init_memory(&sc, text, len);
+    size_t rows = 0;
+    double start = now_seconds();
+    while (scanner_scanf(&sc, all, &ints[0], &floats[0], &floats[1], words[0], &ints[1], &floats[2],
+                         &floats[3], words[1], &ints[2], &floats[4], &floats[5], words[2], &ints[3],
+                         &floats[6], &floats[7], words[3], &ints[4], &floats[8], &floats[9],
+                         words[4]) == 20) {
+        rows++;
+    }
+    double dummies = now_seconds() - start;
+
+    scanner_init_memory(&sc, text, len);
+    size_t picked_rows = 0;
+    start = now_seconds();
+    while (scanner_scanf(&sc, picked, &floats[0], &ints[0], words[0]) == 3) {
+        picked_rows++;
+    }
+    double suppressed = now_seconds() - start;
+
+    report("all 20 into dummies %8.1f MB/s  %7.1f ns/row\n", len / dummies / 1e6, dummies * 1e9 / count);
+    report("3 kept, 17 %%*      %8.1f MB/s  %7.1f ns/row%s\n", len / suppressed / 1e6,
+           suppressed * 1e9 / count, rows == count && picked_rows == count ? "" : "  (ROW COUNT MISMATCH)");
+    report("\n");
+    free(text);
+}
+
+void bench_lines(void) {
+    // id,value rows with one malformed row in a hundred
+    size_t count = 2000000;
+    char *text = malloc(count * 32);
+    if (text == NULL) {
+        return;
+    }
+    size_t len = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (i % 100 == 37) {
+            len += (size_t)sprintf(text + len, "%zu,PSYCH!\n", i);
+        } else {
+            len += (size_t)sprintf(text + len, "%zu,%zu.%03zu\n", i, i % 9973, i % 1000);
+        }
+    }
+    report("Line records with 1%% bad rows over %zu rows (%.1f MB)\n", count, len / 1e6);
+
+    // Scan, and on a bad row drain the rest of the line by hand
+    int id;
+    double value;
+    scanner sc;
+    scanner_init_memory(&sc, text, len);
+    size_t good = 0;
+    size_t bad = 0;
+    double start = now_seconds();
+    for (;;) {
+        int n = scanner_scanf(&sc, "%d,%lf", &id, &value);
+        if (n == 2) {
+            good++;
+            continue;
+        }
+        if (scanner_peek(&sc) == EOF) {
+            break;
+        }
+        bad++;
+        int c;
+        while ((c = scanner_getc(&sc)) != '\n' && c != EOF) {
+        }
+    }
+    double drained = now_seconds() - start;
+
+    scanner_init_memory(&sc, text, len);
+    scan_lines it;
+    scan_lines_init(&it, &sc, "%d,%lf", &id, &value);
+    start = now_seconds();
+    while (scan_lines_next(&it) != SCAN_LINE_END) {
+    }
+    double lines = now_seconds() - start;
+
+    report("scanf + drain %8.1f MB/s  %6.1f ns/row  (%zu ok, %zu bad)\n", len / drained / 1e6,
+           drained * 1e9 / count, good, bad);
+    report("scan_lines    %8.1f MB/s  %6.1f ns/row  (%zu ok, %zu bad)%s\n", len / lines / 1e6,
+           lines * 1e9 / count, it.accepted, it.rejected,
+           it.accepted == good && it.rejected == bad ? "" : "  (ROW COUNT MISMATCH)");
+    report("\n");
+    scan_lines_destroy(&it);
+    free(text);
+}
+
+void bench_readahead(size_t bytes, unsigned long long seed) {
+    // Mixed records in a temporary file, read with read(2) in the parsing
+    // thread and with the background reader
+    corpus c;
+    if (make_corpus(&c, gen_record, bytes, seed) != 0) {
+        return;
+    }
+    FILE *file = tmpfile();
+    if (file == NULL || fwrite(c.text, 1, c.len, file) != c.len || fflush(file) != 0) {
+        report("Could not write the read-ahead corpus\n\n");
+        if (file != NULL) {
+            fclose(file);
+        }
+        free(c.text);
+        return;
+    }
+    int fd = fileno(file);
+    report("File input over %.1f MB of records (warm page cache)\n", c.len / 1e6);
+
+    const char *names[] = {"read(2)", "read-ahead"};
+    size_t rows[2] = {0, 0};
+    for (int mode = 0; mode < 2; mode++) {
+        lseek(fd, 0, SEEK_SET);
+        scanner sc;
+        double start = now_seconds();
+        if (mode == 0) {
+            scanner_init_fd(&sc, fd, 0);
+        } else {
+            scanner_init_readahead(&sc, fd, 0, 0);
+        }
+        int i;
+        double d;
+        char word[256];
+        unsigned int x;
+        while (scanner_scanf(&sc, "%d,%lf %255w %x", &i, &d, word, &x) == 4) {
+            rows[mode]++;
+        }
+        scanner_destroy(&sc);
+        double elapsed = now_seconds() - start;
+        report("%-10s %8.1f MB/s  %6.1f ns/row%s\n", names[mode], c.len / elapsed / 1e6,
+               elapsed * 1e9 / c.fields,
+               rows[mode] == c.fields ? "" : "  (ROW COUNT MISMATCH)");
+    }
+    report("\n");
+    fclose(file);
+    free(c.text);
+}
+
+void bench_index(void) {
+    size_t count = 8000000;
+    size_t len;
+    char *text = make_id_value_records(count, &len);
+    char path[] = "/tmp/scan_bench_XXXXXX";
+    int fd = (text != NULL) ? mkstemp(path) : -1;
+    if (fd < 0 || write(fd, text, len) != (ssize_t)len) {
+        report("Could not write the index corpus\n\n");
+        if (fd >= 0) {
+            close(fd);
+            remove(path);
+        }
+        free(text);
+        return;
+    }
+    free(text);
+    char index_path[64];
+    snprintf(index_path, sizeof(index_path), "%s.idx", path);
+    report("Random access over %zu records (%.1f MB)\n", count, len / 1e6);
+
+    // Reaching the last record without an index means parsing everything before it
+    scanner sc;
+    scanner_map_file(&sc, path);
+    int id = -1;
+    double value;
+    double start = now_seconds();
+    for (size_t i = 0; i < count && scanner_scanf(&sc, "%d,%lf", &id, &value) == 2; i++) {
+    }
+    double linear = now_seconds() - start;
+
+    scan_index index;
+    start = now_seconds();
+    scan_index_open(&index, path, NULL, 0);
+    double built = now_seconds() - start;
+    scan_index_destroy(&index);
+    start = now_seconds();
+    int reused = scan_index_open(&index, path, NULL, 0);
+    double loaded = now_seconds() - start;
+
+    enum { LOOKUPS = 100000 };
+    unsigned long long seed = 7;
+    size_t found = 0;
+    start = now_seconds();
+    for (int k = 0; k < LOOKUPS; k++) {
+        size_t record = (size_t)(next_random(&seed) % count);
+        if (scan_index_seek(&index, &sc, record) == 0 &&
+            scanner_scanf(&sc, "%d,%lf", &id, &value) == 2 && (size_t)id == record) {
+            found++;
+        }
+    }
+    double lookups = now_seconds() - start;
+    scanner_destroy(&sc);
+
+    report("scan to last record  %10.3f ms\n", linear * 1e3);
+    report("build index          %10.3f ms  (%.1f MB/s, %zu entries)\n", built * 1e3,
+           len / built / 1e6, index.entries);
+    report("load saved index     %10.3f ms%s\n", loaded * 1e3, reused == 0 ? "" : "  (REBUILT)");
+    report("seek + parse         %10.3f us/lookup%s\n", lookups * 1e6 / LOOKUPS,
+           found == LOOKUPS ? "" : "  (WRONG RECORDS)");
+    report("\n");
+    scan_index_destroy(&index);
+    close(fd);
+    remove(path);
+    remove(index_path);
+}
+
+// Dotted quad at p, read no further than end. Returns the byte after it, or
+// NULL if it is not one.
+const char *parse_ipv4(const char *p, const char *end, uint32_t *addr) {
+    uint32_t value = 0;
+    for (int part = 0; part < 4; part++) {
+        if (part > 0 && (p == end || *p++ != '.')) {
+            return NULL;
+        }
+        unsigned int octet = 0;
+        int digits = 0;
+        while (digits < 3 && p < end && *p >= '0' && *p <= '9') {
+            octet = octet * 10 + (unsigned int)(*p++ - '0');
+            digits++;
+        }
+        if (digits == 0 || octet > 255) {
+            return NULL;
+        }
+        value = (value << 8) | octet;
+    }
+    *addr = value;
+    return p;
+}
+
+// %{ipv4}, one field at a time through the scanner
+int convert_ipv4(scanner *sc, const scan_program *prog, const scan_op *op, void *dst) {
+    (void)prog;
+    (void)op;
+    char field[16];
+    size_t len = 0;
+    int c;
+    while (len < 15 && (c = scanner_peek(sc)) != EOF && (is_digit(c) || c == '.')) {
+        field[len++] = (char)scanner_getc(sc);
+    }
+    return parse_ipv4(field, field + len, dst) == field + len;
+}
+
+// Bulk %{ipv4}: straight over the buffered bytes, going through the scanner
+// only for a field that may run past them
+size_t batch_ipv4(scanner *sc, const scan_op *op, char *dst, size_t stride, size_t rows) {
+    for (size_t r = 0; r < rows; r++) {
+        skip_whitespace(sc);
+        const char *next = NULL;
+        if (sc->end - sc->cur > 15) {
+            next = parse_ipv4(sc->cur, sc->end, (uint32_t *)(dst + r * stride));
+            if (next != NULL && (is_digit((unsigned char)*next) || *next == '.')) {
+                next = NULL; // A longer token is not an address
+            }
+        } else {
+            scanner_checkpoint cp = scanner_mark(sc);
+            if (convert_ipv4(sc, NULL, op, dst + r * stride)) {
+                scanner_commit(sc, cp);
+                continue;
+            }
+            scanner_rollback(sc, cp);
+        }
+        if (next == NULL) {
+            return r;
+        }
+        sc->cur = next;
+    }
+    return rows;
+}
+
+void bench_registry(void) {
+    size_t count = 2000000;
+    char *text = malloc(count * 16);
+    if (text == NULL) {
+        return;
+    }
+    size_t len = 0;
+    unsigned long long seed = 99;
+    for (size_t i = 0; i < count; i++) {
+        unsigned long long r = next_random(&seed);
+        len += (size_t)sprintf(text + len, "%llu.%llu.%llu.%llu\n", r & 255, (r >> 8) & 255,
+                               (r >> 16) & 255, (r >> 24) & 255);
+    }
+    report("Registered %%{ipv4} over %zu rows (%.1f MB)\n", count, len / 1e6);
+
+    scan_converter rows_only = {convert_ipv4, NULL, NULL, sizeof(uint32_t), 0};
+    scan_converter bulk = {convert_ipv4, NULL, batch_ipv4, sizeof(uint32_t), 0};
+    scan_register_name("ipv4_rows", &rows_only);
+    scan_register_name("ipv4", &bulk);
+
+    // Built-in octets, recombined afterwards
+    unsigned char *octets = malloc(count * 4);
+    uint32_t *by_row = malloc(count * sizeof(uint32_t));
+    uint32_t *by_bulk = malloc(count * sizeof(uint32_t));
+    if (octets == NULL || by_row == NULL || by_bulk == NULL) {
+        free(octets);
+        free(by_row);
+        free(by_bulk);
+        free(text);
+        return;
+    }
+    scan_column columns[4];
+    for (int k = 0; k < 4; k++) {
+        columns[k].base = octets + k;
+        columns[k].stride = 4;
+    }
+    scanner sc;
+    scanner_init_memory(&sc, text, len);
+    double start = now_seconds();
+    size_t builtin_rows = scanner_batch(&sc, "%hhu.%hhu.%hhu.%hhu\n", columns, count, NULL);
+    double builtin = now_seconds() - start;
+
+    scan_column column = {by_row, sizeof(uint32_t)};
+    scanner_init_memory(&sc, text, len);
+    start = now_seconds();
+    size_t row_rows = scanner_batch(&sc, "%{ipv4_rows}\n", &column, count, NULL);
+    double per_row = now_seconds() - start;
+
+    column.base = by_bulk;
+    scanner_init_memory(&sc, text, len);
+    start = now_seconds();
+    size_t bulk_rows = scanner_batch(&sc, "%{ipv4}\n", &column, count, NULL);
+    double bulked = now_seconds() - start;
+
+    int same = builtin_rows == count && row_rows == count && bulk_rows == count &&
+               memcmp(by_row, by_bulk, count * sizeof(uint32_t)) == 0;
+    report("%%hhu x 4 built-in %8.1f MB/s  %7.1f ns/row\n", len / builtin / 1e6, builtin * 1e9 / count);
+    report("%%{ipv4} per row   %8.1f MB/s  %7.1f ns/row\n", len / per_row / 1e6, per_row * 1e9 / count);
+    report("%%{ipv4} bulk      %8.1f MB/s  %7.1f ns/row%s\n", len / bulked / 1e6,
+           bulked * 1e9 / count, same ? "" : "  (RESULTS DIFFER)");
+    report("\n");
+    free(octets);
+    free(by_row);
+    free(by_bulk);
+    free(text);
+}
+
+void bench_parallel(void) {
+    size_t count = 8000000;
+    size_t len;
+    char *text = make_id_value_records(count, &len);
+    int *ids = malloc(count * sizeof(int));
+    double *values = malloc(count * sizeof(double));
+    if (text == NULL || ids == NULL || values == NULL) {
+        free(text);
+        free(ids);
+        free(values);
+        return;
+    }
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    report("Parallel record parsing over %zu rows (%.1f MB, %ld CPUs)\n", count, len / 1e6, cpus);
+
+    scan_column columns[] = {{ids, sizeof(int)}, {values, sizeof(double)}};
+    double single = 0;
+    for (int threads = 1; threads <= 2 * cpus && threads <= 64; threads *= 2) {
+        size_t rows;
+        size_t error;
+        double start = now_seconds();
+        scan_parallel(text, len, "%d,%f", columns, count, threads, &rows, &error);
+        double elapsed = now_seconds() - start;
+        if (threads == 1) {
+            single = elapsed;
+        }
+        report("%2d threads %8.1f MB/s  speedup %5.2fx%s\n", threads, len / elapsed / 1e6,
+               single / elapsed, rows == count ? "" : "  (ROW COUNT MISMATCH)");
+    }
+    report("\n");
+    free(text);
+    free(ids);
+    free(values);
+}
+
+// HELPERS //
+
+// Runs the my_scanf format over the corpus through a memory scanner
+double time_ours(const corpus *c, const spec_bench *b, size_t *fields) {
+    int i;
+    long long ll;
+    double d;
+    char s[256];
+    unsigned int u;
+    int want = (b->args == ARGS_RECORD) ? 4 : 1;
+    scanner sc;
+    scanner_init_memory(&sc, c->text, c->len);
+    *fields = 0;
+
+    double start = now_seconds();
+    for (;;) {
+        int got;
+        switch (b->args) {
+            case ARGS_INT:    got = scanner_scanf(&sc, b->ours, &i); break;
+            case ARGS_WIDE:   got = scanner_scanf(&sc, b->ours, &ll); break;
+            case ARGS_DOUBLE: got = scanner_scanf(&sc, b->ours, &d); break;
+            case ARGS_STRING: got = scanner_scanf(&sc, b->ours, s); break;
+            default:          got = scanner_scanf(&sc, b->ours, &i, &d, s, &u); break;
+        }
+        if (got != want) {
+            break;
+        }
+        (*fields)++;
+    }
+    return now_seconds() - start;
+}
+
+// Runs the glibc format with fscanf over the corpus in a memory stream
+double time_glibc(const corpus *c, const spec_bench *b, size_t *fields) {
+    *fields = 0;
+    FILE *fp = fmemopen(c->text, c->len, "r");
+    if (fp == NULL) {
+        return 1;
+    }
+    int i;
+    long long ll;
+    double d;
+    char s[256];
+    unsigned int u;
+    int used;
+    int want = (b->args == ARGS_RECORD) ? 4 : 1;
+
+    double start = now_seconds();
+    for (;;) {
+        int got;
+        switch (b->args) {
+            case ARGS_INT:    got = fscanf(fp, b->glibc, &i, &used); break;
+            case ARGS_WIDE:   got = fscanf(fp, b->glibc, &ll, &used); break;
+            case ARGS_DOUBLE: got = fscanf(fp, b->glibc, &d, &used); break;
+            case ARGS_STRING: got = fscanf(fp, b->glibc, s, &used); break;
+            default:          got = fscanf(fp, b->glibc, &i, &d, s, &u, &used); break;
+        }
+        if (got != want) {
+            break;
+        }
+        (*fields)++;
+    }
+    double elapsed = now_seconds() - start;
+    fclose(fp);
+    return elapsed;
+}
+
+// Runs a strto* loop over the corpus
+double time_baseline(const corpus *c, enum baseline which, size_t *fields) {
+    char *p = c->text;
+    char *end = c->text + c->len;
+    volatile unsigned long long sink = 0; // Keeps the loop from being optimized away
+    *fields = 0;
+
+    double start = now_seconds();
+    while (p < end) {
+        char *next = p;
+        switch (which) {
+            case BASELINE_STRTOLL:     sink += (unsigned long long)strtoll(p, &next, 10); break;
+            case BASELINE_STRTOULL_16: sink += strtoull(p, &next, 16); break;
+            case BASELINE_STRTOULL_2:  sink += strtoull(p, &next, 2); break;
+            case BASELINE_STRTOD:      sink += (strtod(p, &next) > 1.0); break;
+            default: break;
+        }
+        if (next == p) {
+            break;
+        }
+        p = next + 1; // Skip the newline
+        (*fields)++;
+    }
+    return now_seconds() - start;
+}
+
+// Prints to stdout and to bench_output.txt
+void report(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+
+    va_start(args, format);
+    vfprintf(output, format, args);
+    va_end(args);
+}
+
+double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
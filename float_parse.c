@@ -0,0 +1,984 @@
+#include <errno.h>
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "float_pow5.h"
+#include "my_scanf.h"
+#include "scan_simd.h"
+
+// Correctly rounded decimal and hexadecimal float conversion.
+//
+// The lexer walks the token once and gathers two views of it: the first 19
+// significant digits as a 64-bit integer w with a power of ten (value is about
+// w * 10^exp10), and every significant digit in a big decimal for the rare
+// cases the fast paths cannot decide. Conversion then tries, in order:
+//   1. Clinger's fast path, exact when w and 10^exp10 are both exact doubles
+//   2. Eisel-Lemire, one or two 64x128-bit multiplies against a table of 5^q
+//   3. Simple decimal conversion on the big decimal (shifts by powers of two)
+
+// Significant digits kept by the big decimal; enough to round any double
+#define DECIMAL_MAX_DIGITS 768
+
+// Decimal exponents beyond this are clamped; they are zero or infinity anyway
+#define EXPONENT_LIMIT 100000
+
+// Simple decimal conversion never shifts by more than 60 bits at a time
+#define DECIMAL_MAX_SHIFT 60
+
+// Below this decimal point the value is certainly zero
+#define DECIMAL_POINT_RANGE 2047
+
+enum float_kind {
+    FLOAT_DECIMAL,
+    FLOAT_HEX,
+    FLOAT_INF,
+    FLOAT_NAN
+};
+
+// Arbitrary-precision decimal: value = 0.d1 d2 d3 ... * 10^decimal_point
+typedef struct decimal {
+    uint32_t num_digits;
+    int32_t decimal_point;
+    int truncated; // Nonzero digits were dropped past DECIMAL_MAX_DIGITS
+    uint8_t digits[DECIMAL_MAX_DIGITS];
+} decimal;
+
+typedef struct float_token {
+    int kind;      // enum float_kind
+    int negative;
+
+    // Decimal: w * 10^exp10, w holding at most 19 significant digits
+    uint64_t w;
+    int64_t exp10;
+    int w_truncated; // Nonzero digits did not fit in w
+
+    // Decimal: every significant digit, for the slow path
+    decimal big;
+
+    // Hex: m * 2^exp2, with up to 32 significant hex digits in m (enough to
+    // round a long double)
+    unsigned __int128 m;
+    int64_t exp2;
+    int hex_digits;
+    int sticky;    // Nonzero hex digits did not fit in m
+} float_token;
+
+// Parameters of an IEEE binary format
+typedef struct binary_format {
+    int explicit_bits;     // Stored mantissa bits
+    int minimum_exponent;  // Negative exponent bias
+    int infinite_power;    // Biased exponent of infinity
+    int smallest_power_of_ten;
+    int largest_power_of_ten;
+    int min_exponent_round_to_even;
+    int max_exponent_round_to_even;
+    int max_exponent_fast_path;
+    uint64_t max_mantissa_fast_path;
+} binary_format;
+
+static const binary_format binary64 = {52, -1023, 0x7FF, -342, 308, -4, 23, 22, 1ULL << 53};
+static const binary_format binary32 = {23, -127, 0xFF, -64, 38, -17, 10, 10, 1ULL << 24};
+
+// Result of a conversion before it is packed into a float: biased exponent
+// and stored mantissa bits
+typedef struct adjusted_mantissa {
+    uint64_t mantissa;
+    int32_t power2;
+} adjusted_mantissa;
+
+static const double exact_powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static const float exact_powers_of_ten_f[] = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+
+// LEXER //
+
+static int lex_float(scanner *sc, float_token *tok);
+static int lex_hex(scanner *sc, float_token *tok);
+
+// Matches the rest of a keyword such as "inf", ignoring case. A mismatching
+// character is consumed, like every other failed read.
+static int match_keyword(scanner *sc, const char *rest) {
+    for (int i = 0; rest[i] != '\0'; i++) {
+        int c = scanner_getc(sc);
+        if (c == EOF || (c | 0x20) != rest[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Adds one significant decimal digit to both views of the number
+static inline void add_digit(float_token *tok, int d, int fraction) {
+    decimal *big = &tok->big;
+    if (big->num_digits == 0 && d == 0) {
+        // Leading zero: only moves the decimal point when after the '.'
+        if (fraction) {
+            big->decimal_point--;
+            tok->exp10--;
+        }
+        return;
+    }
+
+    if (big->num_digits < DECIMAL_MAX_DIGITS) {
+        big->digits[big->num_digits] = (uint8_t)d;
+    } else if (d != 0) {
+        big->truncated = 1;
+    }
+
+    if (big->num_digits < 19) {
+        tok->w = tok->w * 10 + (uint64_t)d;
+        if (fraction) {
+            tok->exp10--;
+        }
+    } else {
+        if (!fraction) {
+            tok->exp10++; // Dropped integer digit still scales the value
+        }
+        if (d != 0) {
+            tok->w_truncated = 1;
+        }
+    }
+
+    big->num_digits++;
+    if (!fraction) {
+        big->decimal_point++;
+    }
+}
+
+// Takes eight buffered digits at once while they all fit in w
+static inline void add_eight_digits(scanner *sc, float_token *tok, int fraction) {
+    decimal *big = &tok->big;
+    while (big->num_digits > 0 && big->num_digits + 8 <= 19 && sc->end - sc->cur >= 8) {
+        uint64_t chunk = load_eight_bytes(sc->cur);
+        if (!is_eight_digits(chunk)) {
+            return;
+        }
+        tok->w = tok->w * 100000000 + parse_eight_digits(chunk);
+        for (int k = 0; k < 8; k++) {
+            big->digits[big->num_digits + k] = (uint8_t)(sc->cur[k] - '0');
+        }
+        big->num_digits += 8;
+        if (fraction) {
+            tok->exp10 -= 8;
+        } else {
+            big->decimal_point += 8;
+        }
+        sc->cur += 8;
+    }
+}
+
+// Reads an optionally signed exponent, clamped to +-EXPONENT_LIMIT. Returns 0
+// if there is no digit (the offending character is consumed).
+static int lex_exponent(scanner *sc, int64_t *exponent) {
+    int c = scanner_getc(sc);
+    int negative = 0;
+    if (c == '-') {
+        negative = 1;
+        c = scanner_getc(sc);
+    } else if (c == '+') {
+        c = scanner_getc(sc);
+    }
+
+    if (!is_digit(c)) {
+        return 0;
+    }
+
+    int64_t value = 0;
+    while (is_digit(c)) {
+        if (value < EXPONENT_LIMIT) {
+            value = value * 10 + (c - '0');
+        }
+        c = scanner_getc(sc);
+    }
+    scanner_ungetc(sc, c);
+
+    *exponent = negative ? -value : value;
+    return 1;
+}
+
+static int lex_float(scanner *sc, float_token *tok) {
+    tok->kind = FLOAT_DECIMAL;
+    tok->negative = 0;
+    tok->w = 0;
+    tok->exp10 = 0;
+    tok->w_truncated = 0;
+    tok->big.num_digits = 0;
+    tok->big.decimal_point = 0;
+    tok->big.truncated = 0;
+
+    // Step 1: Skip leading whitespace
+    skip_whitespace(sc);
+    int c = scanner_getc(sc);
+
+    // Step 2: Check for optional sign
+    if (c == '-') {
+        tok->negative = 1;
+        c = scanner_getc(sc);
+    } else if (c == '+') {
+        c = scanner_getc(sc);
+    }
+
+    // Step 3: "inf", "infinity" and "nan" in any case
+    if (c == 'i' || c == 'I') {
+        if (!match_keyword(sc, "nf")) {
+            return 0;
+        }
+        int next = scanner_peek(sc);
+        if ((next == 'i' || next == 'I') && !match_keyword(sc, "inity")) {
+            return 0;
+        }
+        tok->kind = FLOAT_INF;
+        return 1;
+    }
+    if (c == 'n' || c == 'N') {
+        if (!match_keyword(sc, "an")) {
+            return 0;
+        }
+        tok->kind = FLOAT_NAN;
+        return 1;
+    }
+
+    // Step 4: "0x" starts a hex float
+    if (c == '0') {
+        int next = scanner_getc(sc);
+        if (next == 'x' || next == 'X') {
+            return lex_hex(sc, tok);
+        }
+        scanner_ungetc(sc, next);
+    }
+
+    // Step 5: Read integer part
+    int digit_found = 0;
+    while (is_digit(c)) {
+        digit_found = 1;
+        add_digit(tok, c - '0', 0);
+        add_eight_digits(sc, tok, 0);
+        c = scanner_getc(sc);
+    }
+
+    // Step 6: Check for decimal point and read fractional part
+    if (c == '.') {
+        c = scanner_getc(sc);
+        while (is_digit(c)) {
+            digit_found = 1;
+            add_digit(tok, c - '0', 1);
+            add_eight_digits(sc, tok, 1);
+            c = scanner_getc(sc);
+        }
+    }
+
+    // Step 7: Check if we found at least one digit
+    if (!digit_found) {
+        return 0; // Failure - no valid float
+    }
+
+    // Step 8: Check for scientific notation (e or E)
+    if (c == 'e' || c == 'E') {
+        int64_t exponent;
+        if (!lex_exponent(sc, &exponent)) {
+            return 0; // If we had 'e' but no valid exponent, that's an error
+        }
+        tok->exp10 += exponent;
+        tok->big.decimal_point += (int32_t)exponent;
+    } else {
+        scanner_ungetc(sc, c); // We consumed one too many characters
+    }
+
+    // Drop what did not fit and trailing zeros from the big decimal
+    decimal *big = &tok->big;
+    if (big->num_digits > DECIMAL_MAX_DIGITS) {
+        big->num_digits = DECIMAL_MAX_DIGITS;
+    }
+    while (big->num_digits > 0 && big->digits[big->num_digits - 1] == 0) {
+        big->num_digits--;
+    }
+    return 1;
+}
+
+// Skip path for %*f: consumes exactly what lex_float would, crossing digit
+// runs with skip_digits and gathering nothing
+
+// is_digit, inlined (EOF is not a digit)
+static inline int is_decimal(int c) {
+    return (unsigned)(c - '0') < 10;
+}
+
+static int skip_exponent(scanner *sc) {
+    int c = scanner_getc(sc);
+    if (c == '-' || c == '+') {
+        c = scanner_getc(sc);
+    }
+    if (!is_decimal(c)) {
+        return 0;
+    }
+    skip_digits(sc, 10);
+    return 1;
+}
+
+static int skip_hex_float(scanner *sc) {
+    int digit_found = 0;
+    int c = scanner_getc(sc);
+    if (is_hex_digit(c)) {
+        digit_found = 1;
+        skip_digits(sc, 16);
+        c = scanner_getc(sc);
+    }
+    if (c == '.') {
+        c = scanner_getc(sc);
+        if (is_hex_digit(c)) {
+            digit_found = 1;
+            skip_digits(sc, 16);
+            c = scanner_getc(sc);
+        }
+    }
+    if (!digit_found) {
+        return 0;
+    }
+    if (c == 'p' || c == 'P') {
+        return skip_exponent(sc);
+    }
+    scanner_ungetc(sc, c);
+    return 1;
+}
+
+int skip_float(scanner *sc) {
+    skip_whitespace(sc);
+    int c = scanner_getc(sc);
+    if (c == '-' || c == '+') {
+        c = scanner_getc(sc);
+    }
+
+    if (c == 'i' || c == 'I') {
+        if (!match_keyword(sc, "nf")) {
+            return 0;
+        }
+        int next = scanner_peek(sc);
+        return !((next == 'i' || next == 'I') && !match_keyword(sc, "inity"));
+    }
+    if (c == 'n' || c == 'N') {
+        return match_keyword(sc, "an");
+    }
+    if (c == '0') {
+        int next = scanner_getc(sc);
+        if (next == 'x' || next == 'X') {
+            return skip_hex_float(sc);
+        }
+        scanner_ungetc(sc, next);
+    }
+
+    int digit_found = 0;
+    if (is_decimal(c)) {
+        digit_found = 1;
+        skip_digits(sc, 10);
+        c = scanner_getc(sc);
+    }
+    if (c == '.') {
+        c = scanner_getc(sc);
+        if (is_decimal(c)) {
+            digit_found = 1;
+            skip_digits(sc, 10);
+            c = scanner_getc(sc);
+        }
+    }
+    if (!digit_found) {
+        return 0;
+    }
+    if (c == 'e' || c == 'E') {
+        return skip_exponent(sc);
+    }
+    scanner_ungetc(sc, c);
+    return 1;
+}
+
+// Adds one hex digit: the first 32 significant ones go into m, the rest only
+// scale the value (integer part) and set sticky if nonzero
+static inline void add_hex_digit(float_token *tok, int d, int fraction) {
+    if (tok->hex_digits == 0 && d == 0) {
+        if (fraction) {
+            tok->exp2 -= 4;
+        }
+    } else if (tok->hex_digits < 32) {
+        tok->m = (tok->m << 4) | (uint64_t)d;
+        tok->hex_digits++;
+        if (fraction) {
+            tok->exp2 -= 4;
+        }
+    } else {
+        if (!fraction) {
+            tok->exp2 += 4;
+        }
+        if (d != 0) {
+            tok->sticky = 1;
+        }
+    }
+}
+
+// Reads the part of a hex float after "0x": hex digits, an optional '.' and
+// fraction, and an optional binary exponent p[+-]digits
+static int lex_hex(scanner *sc, float_token *tok) {
+    tok->kind = FLOAT_HEX;
+    tok->m = 0;
+    tok->exp2 = 0;
+    tok->hex_digits = 0;
+    tok->sticky = 0;
+
+    int c = scanner_getc(sc);
+    int digit_found = 0;
+    while (is_hex_digit(c)) {
+        digit_found = 1;
+        add_hex_digit(tok, hex_to_int(c), 0);
+        c = scanner_getc(sc);
+    }
+
+    if (c == '.') {
+        c = scanner_getc(sc);
+        while (is_hex_digit(c)) {
+            digit_found = 1;
+            add_hex_digit(tok, hex_to_int(c), 1);
+            c = scanner_getc(sc);
+        }
+    }
+
+    if (!digit_found) {
+        return 0;
+    }
+
+    if (c == 'p' || c == 'P') {
+        int64_t exponent;
+        if (!lex_exponent(sc, &exponent)) {
+            return 0;
+        }
+        tok->exp2 += exponent;
+    } else {
+        scanner_ungetc(sc, c);
+    }
+    return 1;
+}
+
+// EISEL-LEMIRE //
+
+static inline int leading_zeroes(uint64_t x) {
+    return __builtin_clzll(x);
+}
+
+// Upper 128 bits of w * 5^q, using the second table word only when the first
+// product leaves the needed bits undecided
+static inline unsigned __int128 product_approximation(int64_t q, uint64_t w, int bit_precision) {
+    int index = 2 * (int)(q - POW5_TABLE_MIN_Q);
+    unsigned __int128 first = (unsigned __int128)w * power_of_five_128[index];
+    uint64_t high = (uint64_t)(first >> 64);
+    uint64_t low = (uint64_t)first;
+
+    uint64_t precision_mask = UINT64_MAX >> bit_precision;
+    if ((high & precision_mask) == precision_mask) {
+        unsigned __int128 second = (unsigned __int128)w * power_of_five_128[index + 1];
+        uint64_t second_high = (uint64_t)(second >> 64);
+        low += second_high;
+        if (second_high > low) {
+            high++;
+        }
+    }
+    return ((unsigned __int128)high << 64) | low;
+}
+
+// floor(log2(10^q)) + 63, valid for the table range
+static inline int32_t power_of_ten_to_two(int32_t q) {
+    return (((152170 + 65536) * q) >> 16) + 63;
+}
+
+// Correctly rounded w * 10^q for w < 2^64 given exactly (Mushtak & Lemire show
+// the 128-bit product always suffices)
+static adjusted_mantissa compute_float(const binary_format *fmt, int64_t q, uint64_t w) {
+    adjusted_mantissa answer;
+    if (w == 0 || q < fmt->smallest_power_of_ten) {
+        answer.power2 = 0;
+        answer.mantissa = 0;
+        return answer;
+    }
+    if (q > fmt->largest_power_of_ten) {
+        answer.power2 = fmt->infinite_power;
+        answer.mantissa = 0;
+        return answer;
+    }
+
+    int lz = leading_zeroes(w);
+    w <<= lz;
+    unsigned __int128 product = product_approximation(q, w, fmt->explicit_bits + 3);
+    uint64_t high = (uint64_t)(product >> 64);
+    uint64_t low = (uint64_t)product;
+
+    int upperbit = (int)(high >> 63);
+    int shift = upperbit + 64 - fmt->explicit_bits - 3;
+    answer.mantissa = high >> shift;
+    answer.power2 = power_of_ten_to_two((int32_t)q) + upperbit - lz - fmt->minimum_exponent;
+
+    if (answer.power2 <= 0) {
+        // Subnormal, or zero if everything falls below the smallest exponent
+        if (-answer.power2 + 1 >= 64) {
+            answer.power2 = 0;
+            answer.mantissa = 0;
+            return answer;
+        }
+        answer.mantissa >>= -answer.power2 + 1;
+        answer.mantissa += (answer.mantissa & 1); // Round up
+        answer.mantissa >>= 1;
+        answer.power2 = (answer.mantissa < (1ULL << fmt->explicit_bits)) ? 0 : 1;
+        return answer;
+    }
+
+    // Usually we round up, but exactly halfway cases with an even result round down
+    if (low <= 1 && q >= fmt->min_exponent_round_to_even && q <= fmt->max_exponent_round_to_even &&
+        (answer.mantissa & 3) == 1) {
+        if ((answer.mantissa << shift) == high) {
+            answer.mantissa &= ~1ULL;
+        }
+    }
+
+    answer.mantissa += (answer.mantissa & 1); // Round up
+    answer.mantissa >>= 1;
+    if (answer.mantissa >= (2ULL << fmt->explicit_bits)) {
+        answer.mantissa = 1ULL << fmt->explicit_bits;
+        answer.power2++; // Rounding carried into the next binade
+    }
+    answer.mantissa &= ~(1ULL << fmt->explicit_bits);
+    if (answer.power2 >= fmt->infinite_power) {
+        answer.power2 = fmt->infinite_power;
+        answer.mantissa = 0;
+    }
+    return answer;
+}
+
+// SIMPLE DECIMAL CONVERSION //
+
+static void trim_decimal(decimal *d) {
+    while (d->num_digits > 0 && d->digits[d->num_digits - 1] == 0) {
+        d->num_digits--;
+    }
+}
+
+// How far to shift so the decimal point moves by about n digits
+static uint32_t decimal_shift_for(int32_t n) {
+    static const uint8_t powers[] = {0, 3, 6, 9, 13, 16, 19, 23, 26, 29,
+                                     33, 36, 39, 43, 46, 49, 53, 56, 59};
+    return (n < 19) ? powers[n] : DECIMAL_MAX_SHIFT;
+}
+
+// d = d / 2^shift
+static void decimal_right_shift(decimal *d, uint32_t shift) {
+    uint32_t read_index = 0;
+    uint32_t write_index = 0;
+    uint64_t n = 0;
+
+    while ((n >> shift) == 0) {
+        if (read_index < d->num_digits) {
+            n = 10 * n + d->digits[read_index++];
+        } else if (n == 0) {
+            return;
+        } else {
+            while ((n >> shift) == 0) {
+                n = 10 * n;
+                read_index++;
+            }
+            break;
+        }
+    }
+
+    d->decimal_point -= (int32_t)(read_index - 1);
+    if (d->decimal_point < -DECIMAL_POINT_RANGE) {
+        d->num_digits = 0;
+        d->decimal_point = 0;
+        d->truncated = 0;
+        return;
+    }
+
+    uint64_t mask = (1ULL << shift) - 1;
+    while (read_index < d->num_digits) {
+        uint8_t new_digit = (uint8_t)(n >> shift);
+        n = 10 * (n & mask) + d->digits[read_index++];
+        d->digits[write_index++] = new_digit;
+    }
+    while (n > 0) {
+        uint8_t new_digit = (uint8_t)(n >> shift);
+        n = 10 * (n & mask);
+        if (write_index < DECIMAL_MAX_DIGITS) {
+            d->digits[write_index++] = new_digit;
+        } else if (new_digit > 0) {
+            d->truncated = 1;
+        }
+    }
+    d->num_digits = write_index;
+    trim_decimal(d);
+}
+
+// d = d * 2^shift. Digits are produced least significant first into a
+// scratch buffer, then copied back keeping the most significant ones.
+static void decimal_left_shift(decimal *d, uint32_t shift) {
+    if (d->num_digits == 0) {
+        return;
+    }
+
+    uint8_t scratch[DECIMAL_MAX_DIGITS + 20];
+    uint32_t produced = 0;
+    uint64_t n = 0;
+    for (int32_t i = (int32_t)d->num_digits - 1; i >= 0; i--) {
+        n += (uint64_t)d->digits[i] << shift;
+        scratch[produced++] = (uint8_t)(n % 10);
+        n /= 10;
+    }
+    while (n > 0) {
+        scratch[produced++] = (uint8_t)(n % 10);
+        n /= 10;
+    }
+
+    uint32_t keep = produced < DECIMAL_MAX_DIGITS ? produced : DECIMAL_MAX_DIGITS;
+    for (uint32_t i = 0; i < produced - keep; i++) {
+        if (scratch[i] != 0) {
+            d->truncated = 1;
+        }
+    }
+    for (uint32_t i = 0; i < keep; i++) {
+        d->digits[i] = scratch[produced - 1 - i];
+    }
+
+    d->decimal_point += (int32_t)(produced - d->num_digits);
+    d->num_digits = keep;
+    trim_decimal(d);
+}
+
+// Integer part of d, rounded half to even
+static uint64_t round_decimal(const decimal *d) {
+    if (d->num_digits == 0 || d->decimal_point < 0) {
+        return 0;
+    }
+    if (d->decimal_point > 18) {
+        return UINT64_MAX;
+    }
+
+    uint32_t dp = (uint32_t)d->decimal_point;
+    uint64_t n = 0;
+    for (uint32_t i = 0; i < dp; i++) {
+        n = 10 * n + ((i < d->num_digits) ? d->digits[i] : 0);
+    }
+
+    int round_up = 0;
+    if (dp < d->num_digits) {
+        round_up = d->digits[dp] >= 5;
+        if (d->digits[dp] == 5 && dp + 1 == d->num_digits) {
+            // Exactly half: round to even unless digits were dropped
+            round_up = d->truncated || (dp > 0 && (d->digits[dp - 1] & 1));
+        }
+    }
+    return round_up ? n + 1 : n;
+}
+
+// Slow but exact conversion of a big decimal: scale it into [1/2, 1) with
+// binary shifts, then shift in the mantissa bits and round
+static adjusted_mantissa decimal_to_binary(const binary_format *fmt, decimal *d) {
+    adjusted_mantissa answer = {0, 0};
+    adjusted_mantissa infinity = {0, fmt->infinite_power};
+
+    if (d->num_digits == 0 || d->decimal_point < -324) {
+        return answer;
+    }
+    if (d->decimal_point >= 310) {
+        return infinity;
+    }
+
+    int32_t exp2 = 0;
+    while (d->decimal_point > 0) {
+        uint32_t shift = decimal_shift_for(d->decimal_point);
+        decimal_right_shift(d, shift);
+        if (d->decimal_point < -DECIMAL_POINT_RANGE) {
+            return answer;
+        }
+        exp2 += (int32_t)shift;
+    }
+
+    while (d->decimal_point <= 0) {
+        uint32_t shift;
+        if (d->decimal_point == 0) {
+            if (d->digits[0] >= 5) {
+                break;
+            }
+            shift = (d->digits[0] < 2) ? 2 : 1;
+        } else {
+            shift = decimal_shift_for(-d->decimal_point);
+        }
+        decimal_left_shift(d, shift);
+        if (d->decimal_point > DECIMAL_POINT_RANGE) {
+            return infinity;
+        }
+        exp2 -= (int32_t)shift;
+    }
+
+    // Now in [1/2, 1); the binary formats use [1, 2)
+    exp2--;
+    while (fmt->minimum_exponent + 1 > exp2) {
+        uint32_t n = (uint32_t)(fmt->minimum_exponent + 1 - exp2);
+        if (n > DECIMAL_MAX_SHIFT) {
+            n = DECIMAL_MAX_SHIFT;
+        }
+        decimal_right_shift(d, n);
+        exp2 += (int32_t)n;
+    }
+    if (exp2 - fmt->minimum_exponent >= fmt->infinite_power) {
+        return infinity;
+    }
+
+    int mantissa_bits = fmt->explicit_bits + 1;
+    decimal_left_shift(d, (uint32_t)mantissa_bits);
+    uint64_t mantissa = round_decimal(d);
+    if (mantissa >= (1ULL << mantissa_bits)) {
+        // Rounding overflowed into another bit
+        decimal_right_shift(d, 1);
+        exp2++;
+        mantissa = round_decimal(d);
+        if (exp2 - fmt->minimum_exponent >= fmt->infinite_power) {
+            return infinity;
+        }
+    }
+
+    answer.power2 = exp2 - fmt->minimum_exponent;
+    if (mantissa < (1ULL << fmt->explicit_bits)) {
+        answer.power2--; // Subnormal
+    }
+    answer.mantissa = mantissa & ((1ULL << fmt->explicit_bits) - 1);
+    return answer;
+}
+
+// HEX ROUNDING //
+
+// Rounds m * 2^exp2 (plus sticky bits below m) to the format, half to even.
+// Sets *inexact if any nonzero bits were rounded away.
+static adjusted_mantissa round_binary(const binary_format *fmt, uint64_t m, int64_t exp2,
+                                      int sticky, int *inexact) {
+    adjusted_mantissa answer = {0, 0};
+    *inexact = sticky;
+    if (m == 0) {
+        return answer;
+    }
+
+    // Normalize so the leading bit is bit 63: value = m * 2^exp2
+    int lz = leading_zeroes(m);
+    m <<= lz;
+    exp2 -= lz;
+
+    int64_t biased = exp2 + 63 - fmt->minimum_exponent;
+    int64_t shift = 64 - (fmt->explicit_bits + 1);
+    if (biased <= 0) {
+        shift += 1 - biased; // Subnormal: drop extra bits
+        biased = 0;
+    }
+    if (biased >= fmt->infinite_power) {
+        answer.power2 = fmt->infinite_power;
+        *inexact = 1;
+        return answer;
+    }
+    if (shift > 64) {
+        *inexact = 1;
+        return answer; // Less than half the smallest subnormal
+    }
+
+    uint64_t mantissa;
+    uint64_t round_bit;
+    uint64_t rest;
+    if (shift == 64) {
+        mantissa = 0;
+        round_bit = m >> 63;
+        rest = m << 1;
+    } else {
+        mantissa = m >> shift;
+        round_bit = (m >> (shift - 1)) & 1;
+        rest = m & ((1ULL << (shift - 1)) - 1);
+    }
+    if (round_bit || rest) {
+        *inexact = 1;
+    }
+    if (round_bit && (rest || sticky || (mantissa & 1))) {
+        mantissa++;
+    }
+
+    if (biased == 0) {
+        // Rounding may have produced the smallest normal number
+        answer.power2 = (mantissa >> fmt->explicit_bits) ? 1 : 0;
+    } else {
+        if (mantissa >> (fmt->explicit_bits + 1)) {
+            mantissa >>= 1;
+            biased++;
+            if (biased >= fmt->infinite_power) {
+                answer.power2 = fmt->infinite_power;
+                return answer;
+            }
+        }
+        answer.power2 = (int32_t)biased;
+    }
+    answer.mantissa = mantissa & ((1ULL << fmt->explicit_bits) - 1);
+    return answer;
+}
+
+// CONVERSION //
+
+// Converts a lexed token to the given binary format. Sets errno to ERANGE on
+// overflow and on underflow to zero or to an inexact subnormal, like strtod.
+static adjusted_mantissa convert_token(const binary_format *fmt, float_token *tok) {
+    adjusted_mantissa am;
+    int inexact = 1;
+
+    if (tok->kind == FLOAT_HEX) {
+        if (tok->m == 0) {
+            am.mantissa = 0;
+            am.power2 = 0;
+            return am;
+        }
+
+        // Fold m into 64 bits; anything shifted out only matters as sticky
+        unsigned __int128 m = tok->m;
+        int64_t exp2 = tok->exp2;
+        int sticky = tok->sticky;
+        if (m >> 64) {
+            int shift = 64 - leading_zeroes((uint64_t)(m >> 64));
+            sticky |= (m & (((unsigned __int128)1 << shift) - 1)) != 0;
+            m >>= shift;
+            exp2 += shift;
+        }
+        am = round_binary(fmt, (uint64_t)m, exp2, sticky, &inexact);
+    } else {
+        if (tok->w == 0 && !tok->w_truncated) {
+            am.mantissa = 0;
+            am.power2 = 0;
+            return am;
+        }
+        am = compute_float(fmt, tok->exp10, tok->w);
+        if (tok->w_truncated) {
+            // The true value lies between w and w + 1; if both round the same
+            // way we are done, otherwise let the big decimal decide
+            adjusted_mantissa upper = compute_float(fmt, tok->exp10, tok->w + 1);
+            if (upper.mantissa != am.mantissa || upper.power2 != am.power2) {
+                am = decimal_to_binary(fmt, &tok->big);
+            }
+        }
+    }
+
+    if (am.power2 == fmt->infinite_power || (am.power2 == 0 && (am.mantissa == 0 || inexact))) {
+        errno = ERANGE;
+    }
+    return am;
+}
+
+int read_double(scanner *sc, double *value) {
+    float_token tok;
+    if (!lex_float(sc, &tok)) {
+        return 0;
+    }
+
+    uint64_t sign = (uint64_t)tok.negative << 63;
+    if (tok.kind == FLOAT_INF || tok.kind == FLOAT_NAN) {
+        double special = (tok.kind == FLOAT_INF) ? HUGE_VAL : __builtin_nan("");
+        *value = tok.negative ? -special : special;
+        return 1;
+    }
+
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+    // Clinger's fast path: w and 10^|exp10| are exact doubles, so a single
+    // correctly rounded multiply or divide gives the answer
+    if (tok.kind == FLOAT_DECIMAL && !tok.w_truncated && tok.w <= binary64.max_mantissa_fast_path &&
+        tok.exp10 >= -binary64.max_exponent_fast_path && tok.exp10 <= binary64.max_exponent_fast_path) {
+        double result = (double)tok.w;
+        if (tok.exp10 < 0) {
+            result /= exact_powers_of_ten[-tok.exp10];
+        } else {
+            result *= exact_powers_of_ten[tok.exp10];
+        }
+        *value = tok.negative ? -result : result;
+        return 1;
+    }
+#endif
+
+    adjusted_mantissa am = convert_token(&binary64, &tok);
+    uint64_t bits = am.mantissa | ((uint64_t)am.power2 << 52) | sign;
+    memcpy(value, &bits, sizeof(bits));
+    return 1;
+}
+
+int read_float(scanner *sc, float *value) {
+    float_token tok;
+    if (!lex_float(sc, &tok)) {
+        return 0;
+    }
+
+    uint32_t sign = (uint32_t)tok.negative << 31;
+    if (tok.kind == FLOAT_INF || tok.kind == FLOAT_NAN) {
+        float special = (tok.kind == FLOAT_INF) ? HUGE_VALF : __builtin_nanf("");
+        *value = tok.negative ? -special : special;
+        return 1;
+    }
+
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+    if (tok.kind == FLOAT_DECIMAL && !tok.w_truncated && tok.w <= binary32.max_mantissa_fast_path &&
+        tok.exp10 >= -binary32.max_exponent_fast_path && tok.exp10 <= binary32.max_exponent_fast_path) {
+        float result = (float)tok.w;
+        if (tok.exp10 < 0) {
+            result /= exact_powers_of_ten_f[-tok.exp10];
+        } else {
+            result *= exact_powers_of_ten_f[tok.exp10];
+        }
+        *value = tok.negative ? -result : result;
+        return 1;
+    }
+#endif
+
+    adjusted_mantissa am = convert_token(&binary32, &tok);
+    uint32_t bits = (uint32_t)am.mantissa | ((uint32_t)am.power2 << 23) | sign;
+    memcpy(value, &bits, sizeof(bits));
+    return 1;
+}
+
+// long double has no table-driven path: the gathered digits are written back
+// out in canonical form (with a trailing 1 standing in for dropped nonzero
+// digits) and strtold does the rounding
+int read_long_double(scanner *sc, long double *value) {
+    float_token tok;
+    if (!lex_float(sc, &tok)) {
+        return 0;
+    }
+
+    if (tok.kind == FLOAT_INF || tok.kind == FLOAT_NAN) {
+        long double special = (tok.kind == FLOAT_INF) ? HUGE_VALL : __builtin_nanl("");
+        *value = tok.negative ? -special : special;
+        return 1;
+    }
+
+    char text[DECIMAL_MAX_DIGITS + 64];
+    int len = 0;
+    text[len++] = tok.negative ? '-' : '+';
+    if (tok.kind == FLOAT_HEX) {
+        len += sprintf(text + len, "0x%016llx%016llx%sp%lld", (unsigned long long)(tok.m >> 64),
+                       (unsigned long long)tok.m, tok.sticky ? "1" : "",
+                       (long long)(tok.exp2 - (tok.sticky ? 4 : 0)));
+    } else {
+        text[len++] = '0';
+        text[len++] = '.';
+        for (uint32_t i = 0; i < tok.big.num_digits; i++) {
+            text[len++] = (char)('0' + tok.big.digits[i]);
+        }
+        if (tok.big.num_digits == 0) {
+            text[len++] = '0';
+        }
+        if (tok.big.truncated) {
+            text[len++] = '1';
+        }
+        len += sprintf(text + len, "e%d", (int)tok.big.decimal_point);
+    }
+
+    *value = strtold(text, NULL);
+    return 1;
+}
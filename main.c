@@ -1,8 +1,19 @@
-#include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-int my_scanf(const char *format, ...);
+#include "my_scanf.h"
+#include "scan_generated.h"
+#include "scan_simd.h"
+#include "scan_stats.h"
 
 // Test functions
 void test_char_multiple();
@@ -13,6 +24,30 @@ void test_hex_multiple();
 void test_binary();
 void test_roman();
 void test_word();
+void test_scanner_file();
+void test_memory_scanner();
+void test_compiled_format();
+void test_simd_whitespace();
+void test_int_lengths();
+void test_float_exact();
+void test_hex_binary_wide();
+void test_batch();
+void test_parallel();
+void test_string_widths();
+void test_scansets();
+void test_stats();
+void test_reentrant();
+void test_push();
+void test_codegen();
+void test_checkpoints();
+void test_numbers();
+void test_arena();
+void test_intern();
+void test_suppress();
+void test_lines();
+void test_readahead();
+void test_index();
+void test_registry();
 
 int main(void) {
     // Redirect standard input to my own text file
@@ -27,592 +62,30 @@ int main(void) {
     test_binary();
     test_roman();
     test_word();
-}
-
-// Core helper functions
-int read_int(FILE *stream, int *value);
-int read_char(FILE *stream, char *c);
-int read_string(FILE *stream, char *str);
-int read_double(FILE *stream, double *value);
-int read_hex(FILE *stream, unsigned int *value);
-int read_binary(FILE *stream, unsigned int *value);
-int read_roman(FILE *stream, int *value);
-int read_word(FILE *stream, char *str);
-
-// Ancillary helper functions
-void skip_whitespace(FILE *stream);
-int is_whitespace(int c);
-int is_digit(int c);
-int is_hex_digit(int c);
-int hex_to_int(int c);
-int is_binary_digit(int c);
-int roman_to_int(char c);
-int is_roman_digit(int c);
-int is_word_char(int c);
-
-int my_scanf(const char *format, ...) {
-    va_list args;
-    va_start(args, format);
-
-    int count = 0; // Number of successful assignments
-    int i = 0; // Index into format string
-
-    while (format[i] != '\0') {
-        if (format[i] == '%') {
-            i++; // Move past '%'
-
-            switch (format[i]) {
-                case 'c': {
-                    char *ptr = va_arg(args, char*);
-                    if (read_char(stdin, ptr)) {
-                        count++;
-                    } else {
-                        va_end(args);
-                        return count;
-                    }
-                    break;
-                }
-                case 'd': {
-                    int *ptr = va_arg(args, int*);
-                    if (read_int(stdin, ptr)) {
-                        count++;
-                    } else {
-                        va_end(args);
-                        return count;
-                    }
-                    break;
-                }
-                case 's': {
-                    char *ptr = va_arg(args, char*);
-                    if (read_string(stdin, ptr)) {
-                        count++;
-                    } else {
-                        va_end(args);
-                        return count;
-                    }
-                    break;
-                }
-                case 'f': {
-                    double *ptr = va_arg(args, double*);
-                    if (read_double(stdin, ptr)) {
-                        count++;
-                    } else {
-                        va_end(args);
-                        return count;
-                    }
-                    break;
-                }
-                case 'x': {
-                    unsigned int *ptr = va_arg(args, unsigned int*);
-                    if (read_hex(stdin, ptr)) {
-                        count++;
-                    } else {
-                        va_end(args);
-                        return count;
-                    }
-                    break;
-                }
-                case '%': {
-                    // Match literal '%'
-                    int c = getc(stdin);
-
-                    // Skip leading whitespace (like other format specifiers do)
-                    while (is_whitespace(c)) {
-                        c = getc(stdin);
-                    }
-
-                    // Check if the character is '%'
-                    if (c == '%') {
-                        // Successfully matched, continue.
-                        // Don't increment count - we didn't assign to a variable
-                    } else {
-                        // Mismatch - matching failed
-                        va_end(args);
-                        return count;
-                    }
-                    break;
-                }
-                // Custom extensions
-                    case 'b': {
-                    unsigned int *ptr = va_arg(args, unsigned int*);
-                    if (read_binary(stdin, ptr)) {
-                        count++;
-                    } else {
-                        va_end(args);
-                        return count;
-                    }
-                    break;
-                }
-                case 'r': {
-                    int *ptr = va_arg(args, int*);
-                    if (read_roman(stdin, ptr)) {
-                        count++;
-                    } else {
-                        va_end(args);
-                        return count;
-                    }
-                    break;
-                }
-                case 'w': {
-                    char *ptr = va_arg(args, char*);
-                    if (read_word(stdin, ptr)) {
-                        count++;
-                    } else {
-                        va_end(args);
-                        return count;
-                    }
-                    break;
-                }
-                default: {
-                    // Unknown format specifier - stop processing
-                    // This handles cases like %p, %n, %o, etc. that we haven't implemented
-                    va_end(args);
-                    return count;
-                }
-            }
-            i++;
-        } else if (is_whitespace(format[i])) {
-            skip_whitespace(stdin);
-            i++;
-        } else {
-            // Match literal character
-            int c = getchar();
-            if (c != format[i]) {
-                // Mismatch - return early
-                va_end(args);
-                return count;
-            }
-            i++;
-        }
-    }
-
-    va_end(args);
-    return count;
-}
-
-// CORE HELPER FUNCTIONS //
-
-int read_char(FILE *stream, char *c) {
-    const int ch = getc(stream);
-    if (ch == EOF) {
-        return 0; // Failure - no character available
-    }
-    *c = (char)ch; // Store the characters at the pointer location
-    return 1; // Success
-}
-
-int read_int(FILE *stream, int *value) {
-    int c = getc(stream);
-    int sign = 1;
-    int result = 0;
-    int digit_found = 0;
-
-    // Step 1: Skip leading whitespace
-    while (is_whitespace(c)) {
-        c = getc(stream);
-    }
-
-    // Step 2: Check for optional sign
-    if (c == '-') {
-        sign = -1;
-        c = getc(stream);
-    } else if (c == '+') {
-        c = getc(stream);
-    }
-
-    // Step 3: Read digits
-    while (is_digit(c)) {
-        digit_found = 1;
-        result = result * 10 + (c - '0'); // Build the number
-        c = getc(stream);
-    }
-
-    // Step 4: Check if we found at least one digit
-    if (!digit_found) {
-        return 0; // Failure - no valid integer inputted
-    }
-
-    // Apply positive or negative sign and store result
-    *value = result * sign;
-
-    ungetc(c, stream); // We consumed one too many characters
-    return 1; // Success
-}
-
-int read_string(FILE *stream, char *str) {
-    int c = getc(stream);
-    int index = 0;
-
-    // Step 1: Skip leading whitespace
-    while (is_whitespace(c)) {
-        c = getc(stream);
-    }
-
-    // Step 2: Check for EOF before reading anything
-    if (c == EOF) {
-        return 0; // Failure - no string to read
-    }
-
-    // Step 3: Read characters until whitespace or EOF
-    while (c != EOF && !is_whitespace(c)) {
-        str[index] = (char)c;
-        index++;
-        c = getc(stream);
-    }
-
-    // Step 4: Null-terminate the string
-    str[index] = '\0';
-
-    // Step 5: Put back the whitespace/EOF character
-    if (c != EOF) {
-        ungetc(c, stream);
-    }
-
-    // Step 6: Check if we read at least one character
-    if (index == 0) {
-        return 0; // Failure - no characters read
-    }
-
-    return 1; // Success
-}
-
-int read_double(FILE *stream, double *value) {
-    int c = getc(stream);
-    int sign = 1;
-    double result = 0.0;
-    int digit_found = 0;
-
-    // Step 1: Skip leading whitespace
-    while (is_whitespace(c)) {
-        c = getc(stream);
-    }
-
-    // Step 2: Check for optional sign
-    if (c == '-') {
-        sign = -1;
-        c = getc(stream);
-    } else if (c == '+') {
-        c = getc(stream);
-    }
-
-    // Step 3: Read integer part
-    while (is_digit(c)) {
-        digit_found = 1;
-        result = result * 10.0 + (c - '0');
-        c = getc(stream);
-    }
-
-    // Step 4: Check for decimal point
-    if (c == '.') {
-        c = getc(stream);
-        double fraction = 0.1;
-
-        // Read fractional part
-        while (is_digit(c)) {
-            digit_found = 1;
-            result = result + (c - '0') * fraction;
-            fraction = fraction * 0.1;
-            c = getc(stream);
-        }
-    }
-
-    // Step 5: Check if we found at least one digit
-    if (!digit_found) {
-        return 0; // Failure - no valid float
-    }
-
-    // Step 6: Check for scientific notation (e or E)
-    if (c == 'e' || c == 'E') {
-        c = getc(stream);
-        int exp_sign = 1;
-        int exponent = 0;
-        int exp_digit_found = 0;
-
-        // Check for optional sign in exponent
-        if (c == '-') {
-            exp_sign = -1;
-            c = getc(stream);
-        } else if (c == '+') {
-            c = getc(stream);
-        }
-
-        // Read exponent digits
-        while (is_digit(c)) {
-            exp_digit_found = 1;
-            exponent = exponent * 10 + (c - '0');
-            c = getc(stream);
-        }
-
-        // If we had 'e' but no valid exponent, that's an error
-        if (!exp_digit_found) {
-            return 0;
-        }
-
-        // Apply exponent: result = result * 10^(exp_sign * exponent)
-        exponent = exponent * exp_sign;
-
-        // Calculate 10^exponent
-        double multiplier = 1.0;
-        if (exponent > 0) {
-            for (int i = 0; i < exponent; i++) {
-                multiplier *= 10.0;
-            }
-        } else if (exponent < 0) {
-            for (int i = 0; i < -exponent; i++) {
-                multiplier /= 10.0;
-            }
-        }
-
-        result = result * multiplier;
-    }
-
-    if (c != EOF) {
-        ungetc(c, stream); // We consumed one too many characters
-    }
-
-    // Apply sign and store result
-    *value = result * sign;
-
-    return 1; // Success
-}
-
-int read_hex(FILE *stream, unsigned int *value) {
-    int c = getc(stream);
-    unsigned int result = 0;
-    int digit_found = 0;
-
-    // Step 1: Skip leading whitespace
-    while (is_whitespace(c)) {
-        c = getc(stream);
-    }
-
-    // Step 2: Optional "0x" or "0X" prefix
-    if (c == '0') {
-        int next = getc(stream);
-        if (next == 'x' || next == 'X') {
-            // Valid 0x prefix, move to next character
-            c = getc(stream);
-        } else {
-            // Just a '0', not followed by 'x'
-            // The '0' is a valid hex digit
-            digit_found = 1;
-            result = 0;
-            c = next; // Process the character after '0'
-        }
-    }
-
-    // Step 3: Read hex digits
-    while (is_hex_digit(c)) {
-        digit_found = 1;
-        result = result * 16 + hex_to_int(c);
-        c = getc(stream);
-    }
-
-    // Step 4: Check if we found at least one digit
-    if (!digit_found) {
-        return 0; // Failure - no valid hex number
-    }
-
-    // Step 5: Put back the non-hex character
-    if (c != EOF) {
-        ungetc(c, stream);
-    }
-
-    *value = result;
-    return 1; // Success
-}
-
-int read_binary(FILE *stream, unsigned int *value) {
-    int c = getc(stream);
-    unsigned int result = 0;
-    int digit_found = 0;
-
-    // Skip leading whitespace
-    while (is_whitespace(c)) {
-        c = getc(stream);
-    }
-
-    // Optional '0b' prefix
-    if (c == '0') {
-        int next = getc(stream);
-        if (next == 'b' || next == 'B') {
-            c = getc(stream);
-        } else {
-            digit_found = 1;
-            result = 0;
-            c = next;
-        }
-    }
-
-    // Read binary digits
-    while (is_binary_digit(c)) {
-        digit_found = 1;
-        result = result * 2 + (c - '0'); // Convert from binary to decimal
-        c = getc(stream);
-    }
-
-    if (!digit_found) {
-        return 0;
-    }
-
-    if (c != EOF) {
-        ungetc(c, stream);
-    }
-
-    *value = result;
-    return 1;
-}
-
-int read_roman(FILE *stream, int *value) {
-    int c = getc(stream);
-    int result = 0;
-    int digit_found = 0;
-    char roman_str[100];
-    int index = 0;
-
-    // Skip leading whitespace
-    while (is_whitespace(c)) {
-        c = getc(stream);
-    }
-
-    // Read all Roman numeral characters into a string first
-    while (is_roman_digit(c)) {
-        digit_found = 1;
-        roman_str[index++] = (char)c;
-        c = getc(stream);
-    }
-
-    if (!digit_found) {
-        return 0;
-    }
-
-    roman_str[index] = '\0'; // Null terminate
-
-    // Now convert the string
-    for (int i = 0; i < index; i++) {
-        int current = roman_to_int(roman_str[i]);
-
-        // Look ahead to next character
-        if (i + 1 < index) {
-            int next = roman_to_int(roman_str[i + 1]);
-
-            // If current is less than next, it's subtractive (IV, IX, XL, etc.)
-            if (current < next) {
-                result += (next - current);
-                i++;
-                continue;
-            }
-        }
-
-        // Normal case: just add the value
-        result += current;
-    }
-
-    if (c != EOF) {
-        ungetc(c, stream);
-    }
-
-    *value = result;
-    return 1;
-}
-
-int read_word(FILE *stream, char *str) {
-    int c = getc(stream);
-    int index = 0;
-
-    // Skip leading whitespace
-    while (is_whitespace(c)) {
-        c = getc(stream);
-    }
-
-    if (c == EOF) {
-        return 0;
-    }
-
-    // Read word characters
-    while (c != EOF && is_word_char(c)) {
-        str[index] = (char)c;
-        index++;
-        c = getc(stream);
-    }
-
-    // Null terminate
-    str[index] = '\0';
-
-    if (c != EOF) {
-        ungetc(c, stream);
-    }
-
-    if (index == 0) {
-        return 0;
-    }
-
-    return 1; // Success
-}
-
-// ANCILLARY HELPER FUNCTIONS //
-
-int is_whitespace(int c) {
-    return (c == ' ' || c == '\n' || c == '\t' \
-        || c == '\r' || c == '\f' || c == '\v');
-}
-
-void skip_whitespace(FILE *stream) {
-    int c = getc(stream);
-    while (is_whitespace(c)) { // If c is still whitespace
-        c = getc(stream);  // Keep reading
-    }
-    ungetc(c, stream); // Put back the first non whitespace character
-}
-
-int is_digit(int c) {
-    return (c >= '0' && c <= '9');
-}
-
-int is_hex_digit(int c) {
-    return (c >= '0' && c <= '9') || \
-           (c >= 'a' && c <= 'f') || \
-           (c >= 'A' && c <= 'F');
-}
-
-int hex_to_int(int c) {
-    if (c >= '0' && c <= '9') {
-        return c - '0';
-    } else if (c >= 'a' && c <= 'f') {
-        return c - 'a' + 10; // 'a' = 10, 'b' = 11, etc.
-    } else if (c >= 'A' && c <= 'F') {
-        return c - 'A' + 10; // 'A' = 10, 'B' = 11, etc.
-    }
-    return 0;
-}
-
-int is_binary_digit(int c) {
-    return (c == '0' || c == '1');
-}
-
-int roman_to_int(char c) {
-    switch (c) {
-        case 'I': return 1;
-        case 'V': return 5;
-        case 'X': return 10;
-        case 'L': return 50;
-        case 'C': return 100;
-        case 'D': return 500;
-        case 'M': return 1000;
-        default: return 0;
-    }
-}
-
-int is_roman_digit(int c) {
-    return (c == 'I' || c == 'V' || c == 'X' || c == 'L' || c == 'C' || c == 'D' || c == 'M');
-}
-
-// Only considers alphanumeric & underscore characters
-int is_word_char(int c) {
-    return (c >= 'a' && c <= 'z') || \
-           (c >= 'A' && c <= 'Z') || \
-           (c >= '0' && c <= '9') || \
-           (c == '_');
+    test_scanner_file();
+    test_memory_scanner();
+    test_compiled_format();
+    test_simd_whitespace();
+    test_int_lengths();
+    test_float_exact();
+    test_hex_binary_wide();
+    test_batch();
+    test_parallel();
+    test_string_widths();
+    test_scansets();
+    test_stats();
+    test_reentrant();
+    test_push();
+    test_codegen();
+    test_checkpoints();
+    test_numbers();
+    test_arena();
+    test_intern();
+    test_suppress();
+    test_lines();
+    test_readahead();
+    test_index();
+    test_registry();
 }
 
 // BELOW ARE MY TEST FUNCTIONS //
@@ -796,6 +269,28 @@ void test_roman() {
             printf("FAIL (got %d)\n", val);
         }
     }
+
+    // Numerals of any length are converted without a buffer: 200 I's, and a
+    // run of M's past INT_MAX saturates with ERANGE
+    size_t long_len = 3000000;
+    char *numeral = malloc(long_len + 1);
+    memset(numeral, 'I', 200);
+    strcpy(numeral + 200, "V");
+    int ones = 0;
+    int ones_ret = my_sscanf(numeral, "%r", &ones);
+    memset(numeral, 'M', long_len);
+    numeral[long_len] = '\0';
+    int big = 0;
+    errno = 0;
+    int big_ret = my_sscanf(numeral, "%r", &big);
+    int big_errno = errno;
+    free(numeral);
+    if (ones_ret == 1 && ones == 203 && big_ret == 1 && big == INT_MAX && big_errno == ERANGE) {
+        printf("PASS (200 I's then V read as %d, 3000000 M's saturate)\n", ones);
+    } else {
+        printf("FAIL (long numerals: %d/%d, %d/%d errno %d)\n", ones_ret, ones, big_ret, big,
+               big_errno);
+    }
     printf("\n");
 }
 
@@ -817,4 +312,2363 @@ void test_word() {
     my_scanf("%w", word3);
     printf("Test 3: '%s' (expected word with numbers)\n", word3);
 
-}
\ No newline at end of file
+}
+
+void test_scanner_file() {
+    printf("Testing buffered scanner over a FILE\n");
+
+    FILE *reference = fopen("lzbop.txt", "r");
+    FILE *stream = fopen("lzbop.txt", "r");
+    if (reference == NULL || stream == NULL) {
+        printf("FAIL (could not open lzbop.txt)\n");
+        return;
+    }
+
+    // A tiny buffer forces tokens to straddle refills
+    scanner sc;
+    scanner_init_file(&sc, stream, 16);
+
+    int tokens = 0;
+    int mismatches = 0;
+    char s1[100];
+    char s2[100];
+    while (fscanf(reference, "%99s", s1) == 1) {
+        if (scanner_scanf(&sc, "%s", s2) != 1 || strcmp(s1, s2) != 0) {
+            mismatches++;
+        }
+        tokens++;
+    }
+    if (mismatches == 0 && scanner_scanf(&sc, "%s", s2) == 0) {
+        printf("PASS (%d tokens match fscanf)\n", tokens);
+    } else {
+        printf("FAIL (%d of %d tokens differ from fscanf)\n", mismatches, tokens);
+    }
+
+    scanner_destroy(&sc);
+
+    // After a sync the stream continues right after the last consumed byte
+    rewind(stream);
+    scanner_init_file(&sc, stream, 16);
+    scanner_scanf(&sc, "%s %s", s2, s2);
+    scanner_sync(&sc);
+    if (fscanf(stream, "%99s", s1) == 1 && strcmp(s1, "the") == 0) {
+        printf("PASS (stream resumes at '%s' after sync)\n", s1);
+    } else {
+        printf("FAIL (stream resumed at '%s', expected 'the')\n", s1);
+    }
+
+    scanner_destroy(&sc);
+    fclose(stream);
+    fclose(reference);
+    printf("\n");
+}
+
+void test_memory_scanner() {
+    printf("Testing my_sscanf and memory-mapped scanning\n");
+
+    int d;
+    unsigned int h;
+    unsigned int b;
+    int r;
+    char w[100];
+    int ret = my_sscanf("  -42 BEEF 0b101 MCMXCIV else_should", "%d %x %b %r %w", &d, &h, &b, &r, w);
+    if (ret == 5 && d == -42 && h == 0xBEEF && b == 5 && r == 1994 && strcmp(w, "else_should") == 0) {
+        printf("PASS (my_sscanf read all 5 fields)\n");
+    } else {
+        printf("FAIL (my_sscanf returned %d)\n", ret);
+    }
+
+    // Walk the whole mapped file token by token and compare against fscanf
+    scanner sc;
+    FILE *reference = fopen("lzbop.txt", "r");
+    if (reference == NULL || scanner_map_file(&sc, "lzbop.txt") != 0) {
+        printf("FAIL (could not map lzbop.txt)\n");
+        return;
+    }
+
+    int mismatches = 0;
+    size_t total = 0;
+    size_t consumed;
+    char s1[100];
+    char s2[100];
+    while (fscanf(reference, "%99s", s1) == 1) {
+        if (my_mscanf(&sc, &consumed, "%s", s2) != 1 || strcmp(s1, s2) != 0) {
+            mismatches++;
+        }
+        total += consumed;
+    }
+
+    long size = ftell(reference);
+    if (mismatches == 0 && total == (size_t)size && scanner_offset(&sc) == total) {
+        printf("PASS (consumed all %zu mapped bytes)\n", total);
+    } else {
+        printf("FAIL (%d mismatches, consumed %zu of %ld bytes)\n", mismatches, total, size);
+    }
+
+    scanner_destroy(&sc);
+    fclose(reference);
+    printf("\n");
+}
+
+void test_compiled_format() {
+    printf("Testing compiled format programs\n");
+
+    // Literal runs are merged and whitespace folds into the next op
+    scan_program *prog = scan_compile("  %d:%d  %% %c");
+    scanner sc;
+    scanner_init_memory(&sc, "12:34 \t% z", 11);
+    int a;
+    int b;
+    char c;
+    int ret = scan_exec(&sc, prog, &a, &b, &c);
+    if (ret == 3 && a == 12 && b == 34 && c == 'z') {
+        printf("PASS (%d ops, read %d %d %c)\n", prog->count, a, b, c);
+    } else {
+        printf("FAIL (scan_exec returned %d)\n", ret);
+    }
+    scan_program_free(prog);
+
+    // A literal mismatch still consumes the mismatching character
+    size_t consumed;
+    scanner_init_memory(&sc, "5+6", 3);
+    ret = my_mscanf(&sc, &consumed, "%d-%d", &a, &b);
+    if (ret == 1 && consumed == 2) {
+        printf("PASS (mismatch stopped after %zu bytes)\n", consumed);
+    } else {
+        printf("FAIL (returned %d after %zu bytes)\n", ret, consumed);
+    }
+
+    // The cache must notice when the same buffer holds a different format
+    char format[8];
+    unsigned int h;
+    strcpy(format, "%d");
+    my_sscanf("17", format, &a);
+    strcpy(format, "%x");
+    my_sscanf("ff", format, &h);
+    int stack_ok = (a == 17 && h == 0xff);
+    char *heap_format = malloc(8);
+    unsigned int heap_hex;
+    int heap_int;
+    strcpy(heap_format, "%x");
+    my_sscanf("10", heap_format, &heap_hex);
+    strcpy(heap_format, "%d");
+    my_sscanf("10", heap_format, &heap_int);
+    free(heap_format);
+    // A literal keeps hitting its cached program, call after call
+    int literal_ok = 1;
+    for (int k = 0; k < 3; k++) {
+        literal_ok &= (my_sscanf("8 9", "%d %d", &a, &b) == 2 && a == 8 && b == 9);
+    }
+    if (stack_ok && heap_hex == 0x10 && heap_int == 10 && literal_ok) {
+        printf("PASS (cache keyed by pointer and contents)\n");
+    } else {
+        printf("FAIL (stack %d, heap 0x%x and %d, literal %d)\n", stack_ok, heap_hex, heap_int,
+               literal_ok);
+    }
+    printf("\n");
+}
+
+void test_simd_whitespace() {
+    printf("Testing SIMD whitespace kernels\n");
+
+    // Mix every whitespace character with near misses (8, 14, 31, 33) and
+    // high bytes at irregular spacing
+    char text[300];
+    const char pool[] = " \t\n\v\f\r\x08\x0e\x1f!a\xa0\xff ";
+    for (int i = 0; i < (int)sizeof(text); i++) {
+        text[i] = pool[(i * 7 + i / 13) % (sizeof(pool) - 1)];
+    }
+    const char *end = text + sizeof(text);
+
+    // Reference answers from the scalar kernels
+    const char *expected_non_ws[sizeof(text)];
+    const char *expected_ws[sizeof(text)];
+    scan_simd_force(SCAN_SIMD_SCALAR);
+    for (int i = 0; i < (int)sizeof(text); i++) {
+        expected_non_ws[i] = find_non_whitespace(text + i, end);
+        expected_ws[i] = find_whitespace(text + i, end);
+    }
+
+    const char *names[] = {"scalar", "sse2", "ssse3", "avx2"};
+    for (int level = SCAN_SIMD_SSE2; level <= SCAN_SIMD_AVX2; level++) {
+        scan_simd_force((enum scan_simd_level)level);
+        if ((int)scan_simd_level() != level) {
+            printf("PASS (%s not supported, skipped)\n", names[level]);
+            continue;
+        }
+        int mismatches = 0;
+        for (int i = 0; i < (int)sizeof(text); i++) {
+            if (find_non_whitespace(text + i, end) != expected_non_ws[i] ||
+                find_whitespace(text + i, end) != expected_ws[i]) {
+                mismatches++;
+            }
+        }
+        if (mismatches == 0) {
+            printf("PASS (%s matches scalar at every offset)\n", names[level]);
+        } else {
+            printf("FAIL (%s differs at %d offsets)\n", names[level], mismatches);
+        }
+    }
+
+    scan_simd_force(SCAN_SIMD_AVX2);
+    printf("\n");
+}
+
+void test_int_lengths() {
+    printf("Testing integer length modifiers and overflow\n");
+
+    const char *inputs[] = {
+        "0", "-0", "101112", "  +0000000000000000000000012345678", "1234567890123456",
+        "2147483647", "2147483648", "-2147483649", "3000000000",
+        "9223372036854775807", "9223372036854775808", "-9223372036854775808",
+        "-9223372036854775809", "18446744073709551615", "18446744073709551616",
+        "99999999999999999999999", "-1", "65535", "-129"
+    };
+    int num_inputs = sizeof(inputs) / sizeof(inputs[0]);
+
+    // Every value must match sscanf, including whether errno ends up ERANGE
+    int mismatches = 0;
+    int failures = 0;
+    for (int i = 0; i < num_inputs; i++) {
+        int d1, d2;
+        long l1, l2;
+        long long ll1, ll2;
+        unsigned int u1, u2;
+        size_t z1, z2;
+        short h1, h2;
+        unsigned char hh1, hh2;
+        int e1, e2;
+
+        errno = 0;
+        sscanf(inputs[i], "%d", &d1);
+        e1 = errno;
+        errno = 0;
+        my_sscanf(inputs[i], "%d", &d2);
+        e2 = errno;
+        mismatches += (d1 != d2 || e1 != e2);
+
+        errno = 0;
+        sscanf(inputs[i], "%ld", &l1);
+        e1 = errno;
+        errno = 0;
+        my_sscanf(inputs[i], "%ld", &l2);
+        e2 = errno;
+        mismatches += (l1 != l2 || e1 != e2);
+
+        errno = 0;
+        sscanf(inputs[i], "%lld", &ll1);
+        e1 = errno;
+        errno = 0;
+        my_sscanf(inputs[i], "%lld", &ll2);
+        e2 = errno;
+        mismatches += (ll1 != ll2 || e1 != e2);
+
+        errno = 0;
+        sscanf(inputs[i], "%u", &u1);
+        e1 = errno;
+        errno = 0;
+        my_sscanf(inputs[i], "%u", &u2);
+        e2 = errno;
+        mismatches += (u1 != u2 || e1 != e2);
+
+        errno = 0;
+        sscanf(inputs[i], "%zu", &z1);
+        e1 = errno;
+        errno = 0;
+        my_sscanf(inputs[i], "%zu", &z2);
+        e2 = errno;
+        mismatches += (z1 != z2 || e1 != e2);
+
+        sscanf(inputs[i], "%hd %hhu", &h1, &hh1);
+        my_sscanf(inputs[i], "%hd %hhu", &h2, &hh2);
+        mismatches += (h1 != h2);
+
+        if (mismatches != 0) {
+            printf("FAIL (differs from sscanf on '%s')\n", inputs[i]);
+            failures++;
+            mismatches = 0;
+        }
+    }
+    if (failures == 0) {
+        printf("PASS (checked %d inputs against sscanf)\n", num_inputs);
+    }
+
+    // Long runs go through both the eight-digit path and the scalar tail
+    const char *long_runs = "12345678901234567 00000000000000000000042 -98765432109876543";
+    long long values[3];
+    int ret = my_sscanf(long_runs, "%lld %lld %lld", &values[0], &values[1], &values[2]);
+    if (ret == 3 && values[0] == 12345678901234567LL && values[1] == 42 &&
+        values[2] == -98765432109876543LL) {
+        printf("PASS (long digit runs)\n");
+    } else {
+        printf("FAIL (long digit runs returned %d)\n", ret);
+    }
+
+    // A pipe can't be rewound, and the failed seek must not replace ERANGE
+    int fds[2];
+    if (pipe(fds) == 0) {
+        const char *text = "99999999999999999999 5\n";
+        write(fds[1], text, strlen(text));
+        close(fds[1]);
+        FILE *stream = fdopen(fds[0], "r");
+        long big = 0;
+        long small = 0;
+        errno = 0;
+        int big_ret = my_fscanf(stream, "%ld", &big);
+        int big_errno = errno;
+        errno = 0;
+        int small_ret = my_fscanf(stream, "%ld", &small);
+        int small_errno = errno;
+        fclose(stream);
+        if (big_ret == 1 && big == LONG_MAX && big_errno == ERANGE && small_ret == 1 && small == 5 &&
+            small_errno == 0) {
+            printf("PASS (ERANGE survives scanning a pipe)\n");
+        } else {
+            printf("FAIL (pipe gave %ld with errno %d, then %ld with errno %d)\n", big, big_errno,
+                   small, small_errno);
+        }
+    }
+    printf("\n");
+}
+
+void test_float_exact() {
+    printf("Testing correctly rounded floats against strtod\n");
+
+    // Halfway cases, subnormals, overflow, long mantissas, hex floats and specials
+    const char *inputs[] = {
+        "3.141592", "1.41421356", "39e-5", "0.543", "2e10", "1e300", "1e23", "0.1",
+        "9007199254740993", "9007199254740993.00000000000000000000000000001",
+        "2.2250738585072011e-308", "2.2250738585072014e-308", "4.9406564584124654e-324",
+        "2.4703282292062327e-324", "2.4703282292062328e-324", "1e-400", "1e400",
+        "1.7976931348623157e308", "1.7976931348623159e308", "7.038531e-26",
+        "123456789012345678901234567890e-10", "0.00000000000000000000000000000000000001e38",
+        "0x1.8p3", "-0x1P-2", "0x1.fffffffffffff8p1023", "0x1p-1074", "0x.8p1",
+        "inf", "-Infinity", "nan", "-0"
+    };
+    int num_inputs = sizeof(inputs) / sizeof(inputs[0]);
+
+    int failures = 0;
+    for (int i = 0; i < num_inputs; i++) {
+        double d1 = strtod(inputs[i], NULL);
+        float f1 = strtof(inputs[i], NULL);
+        long double l1 = strtold(inputs[i], NULL);
+
+        double d2;
+        float f2;
+        long double l2;
+        int ret = my_sscanf(inputs[i], "%lf", &d2);
+        ret += my_sscanf(inputs[i], "%hf", &f2);
+        ret += my_sscanf(inputs[i], "%Lf", &l2);
+
+        // Compare bit patterns (NaNs never compare equal as values)
+        int same = ret == 3 && memcmp(&d1, &d2, sizeof(d1)) == 0 &&
+                   memcmp(&f1, &f2, sizeof(f1)) == 0 &&
+                   (l1 == l2 || (l1 != l1 && l2 != l2));
+        if (!same) {
+            printf("FAIL ('%s': strtod=%a my_scanf=%a)\n", inputs[i], d1, d2);
+            failures++;
+        }
+    }
+    if (failures == 0) {
+        printf("PASS (%d inputs bit-identical to strtod/strtof/strtold)\n", num_inputs);
+    }
+
+    // Overflow and underflow report ERANGE like strtod
+    double d;
+    errno = 0;
+    my_sscanf("1e999", "%f", &d);
+    int overflow = errno;
+    errno = 0;
+    my_sscanf("1e-999", "%f", &d);
+    int underflow = errno;
+    errno = 0;
+    my_sscanf("0x1p-1074", "%f", &d);
+    int exact_subnormal = errno;
+    if (overflow == ERANGE && underflow == ERANGE && exact_subnormal == 0) {
+        printf("PASS (ERANGE on overflow and underflow)\n");
+    } else {
+        printf("FAIL (errno %d, %d, %d)\n", overflow, underflow, exact_subnormal);
+    }
+    printf("\n");
+}
+
+void test_hex_binary_wide() {
+    printf("Testing 64-bit hex and binary conversions\n");
+
+    // Hex must match sscanf for every length, including ERANGE on overflow
+    const char *inputs[] = {
+        "0", "0x0", "ff", "0XdeadBEEF", "00000000000000000000000000000abc", "7fffffff",
+        "100000000", "ffffffffffffffff", "0x10000000000000000", "123456789abcdef0123",
+        "0x0123456789ABCDEF", "cafe;rest"
+    };
+    int num_inputs = sizeof(inputs) / sizeof(inputs[0]);
+    int failures = 0;
+    for (int i = 0; i < num_inputs; i++) {
+        unsigned int x1, x2;
+        unsigned long lx1, lx2;
+        unsigned long long llx1, llx2;
+        int e1, e2;
+        int mismatches = 0;
+
+        errno = 0;
+        sscanf(inputs[i], "%x", &x1);
+        e1 = errno;
+        errno = 0;
+        my_sscanf(inputs[i], "%x", &x2);
+        e2 = errno;
+        mismatches += (x1 != x2 || e1 != e2);
+
+        errno = 0;
+        sscanf(inputs[i], "%lx", &lx1);
+        e1 = errno;
+        errno = 0;
+        my_sscanf(inputs[i], "%lx", &lx2);
+        e2 = errno;
+        mismatches += (lx1 != lx2 || e1 != e2);
+
+        errno = 0;
+        sscanf(inputs[i], "%llx", &llx1);
+        e1 = errno;
+        errno = 0;
+        my_sscanf(inputs[i], "%llx", &llx2);
+        e2 = errno;
+        mismatches += (llx1 != llx2 || e1 != e2);
+
+        if (mismatches != 0) {
+            printf("FAIL (differs from sscanf on '%s')\n", inputs[i]);
+            failures++;
+        }
+    }
+    if (failures == 0) {
+        printf("PASS (checked %d hex inputs against sscanf)\n", num_inputs);
+    }
+
+    // Binary: 64 digits fill a word, the 65th significant digit overflows
+    char bits64[80];
+    char bits65[80];
+    memset(bits64, '1', 64);
+    strcpy(bits64 + 64, " 0b101");
+    bits65[0] = '1';
+    memset(bits65 + 1, '0', 64);
+    bits65[65] = '\0';
+    unsigned long long b1 = 0, b2 = 0, b3 = 0;
+    errno = 0;
+    int ret = my_sscanf(bits64, "%llb %llb", &b1, &b2);
+    int e_fit = errno;
+    errno = 0;
+    my_sscanf(bits65, "%llb", &b3);
+    int e_over = errno;
+    if (ret == 2 && b1 == ~0ULL && b2 == 5 && e_fit == 0 && b3 == ~0ULL && e_over == ERANGE) {
+        printf("PASS (%%llb fills 64 bits and reports overflow)\n");
+    } else {
+        printf("FAIL (%%llb returned %d, %llx, %llx, %llx)\n", ret, b1, b2, b3);
+    }
+
+    // Kernels against the scalar versions at every offset of a mixed buffer
+    char text[200];
+    const char pool[] = "0123456789abcdefABCDEFgG/:@`x 1010110\xb3\xc1\xe6";
+    for (int i = 0; i < (int)sizeof(text); i++) {
+        text[i] = pool[(i * 11 + i / 7) % (sizeof(pool) - 1)];
+    }
+    int hex_n[sizeof(text) - 64];
+    int bin_n[sizeof(text) - 64];
+    uint64_t hex_v[sizeof(text) - 64];
+    uint64_t bin_v[sizeof(text) - 64];
+    scan_simd_force(SCAN_SIMD_SCALAR);
+    for (int i = 0; i < (int)sizeof(text) - 64; i++) {
+        hex_n[i] = hex_prefix16(text + i, &hex_v[i]);
+        bin_n[i] = binary_prefix64(text + i, &bin_v[i]);
+    }
+    const char *names[] = {"scalar", "sse2", "ssse3", "avx2"};
+    for (int level = SCAN_SIMD_SSE2; level <= SCAN_SIMD_AVX2; level++) {
+        scan_simd_force((enum scan_simd_level)level);
+        if ((int)scan_simd_level() != level) {
+            printf("PASS (%s not supported, skipped)\n", names[level]);
+            continue;
+        }
+        int mismatches = 0;
+        for (int i = 0; i < (int)sizeof(text) - 64; i++) {
+            uint64_t hv, bv;
+            int hn = hex_prefix16(text + i, &hv);
+            int bn = binary_prefix64(text + i, &bv);
+            mismatches += (hn != hex_n[i] || hv != hex_v[i] || bn != bin_n[i] || bv != bin_v[i]);
+        }
+        if (mismatches == 0) {
+            printf("PASS (%s hex/binary kernels match scalar)\n", names[level]);
+        } else {
+            printf("FAIL (%s hex/binary kernels differ at %d offsets)\n", names[level], mismatches);
+        }
+    }
+
+    scan_simd_force(SCAN_SIMD_AVX2);
+    printf("\n");
+}
+
+void test_batch() {
+    printf("Testing batch scanning into columns and structs\n");
+
+    const char *text = "1,2.5 alpha\n2,-0.25 beta\n3,1e3 gamma\n";
+
+    // Columnar: one array per field
+    int ids[4];
+    double values[4];
+    char names[4][16];
+    scan_column soa[] = {
+        {ids, sizeof(ids[0])}, {values, sizeof(values[0])}, {names, sizeof(names[0])}
+    };
+    scanner sc;
+    scanner_init_memory(&sc, text, strlen(text));
+    size_t error;
+    size_t rows = scanner_batch(&sc, "%d,%f %s", soa, 4, &error);
+    if (rows == 3 && error == SCAN_NO_ERROR && ids[2] == 3 && values[1] == -0.25 &&
+        strcmp(names[2], "gamma") == 0) {
+        printf("PASS (SoA: %zu rows, clean end of input)\n", rows);
+    } else {
+        printf("FAIL (SoA: %zu rows, error offset %zu)\n", rows, error);
+    }
+
+    // Array of structs through offsetof, stopping at the row limit
+    struct record {
+        char name[16];
+        long long id;
+        double value;
+    } records[2];
+    scan_column aos[] = {
+        {&records[0].id, sizeof(records[0])},
+        {&records[0].value, sizeof(records[0])},
+        {records[0].name, sizeof(records[0])}
+    };
+    scanner_init_memory(&sc, text, strlen(text));
+    rows = scanner_batch(&sc, "%lld,%f %s", aos, 2, &error);
+    if (rows == 2 && error == SCAN_NO_ERROR && records[1].id == 2 && records[0].value == 2.5 &&
+        strcmp(records[1].name, "beta") == 0) {
+        printf("PASS (AoS: stopped at the %zu row limit)\n", rows);
+    } else {
+        printf("FAIL (AoS: %zu rows)\n", rows);
+    }
+
+    // A malformed row reports where it began, even across buffer refills
+    FILE *fp = tmpfile();
+    if (fp == NULL) {
+        printf("FAIL (could not create temporary file)\n");
+        return;
+    }
+    fputs("10,1 a\n20,2 b\n30,x c\n40,4 d\n", fp);
+    rewind(fp);
+    scanner_init_file(&sc, fp, 8);
+    rows = scanner_batch(&sc, "%d,%f %s", soa, 4, &error);
+    if (rows == 2 && error == 14 && ids[1] == 20) {
+        printf("PASS (malformed row %zu found at offset %zu)\n", rows + 1, error);
+    } else {
+        printf("FAIL (%zu rows, error offset %zu, expected 2 rows and offset 14)\n", rows, error);
+    }
+    scanner_destroy(&sc);
+    fclose(fp);
+
+    // A row starting with %[ keeps its leading whitespace, as scanner_scanf does
+    const char *padded = "  a b,1\n";
+    char batch_name[16];
+    char scanf_name[16];
+    int batch_id = 0;
+    int scanf_id = 0;
+    scan_column set_columns[2] = {{batch_name, sizeof(batch_name)}, {&batch_id, sizeof(int)}};
+    scanner_init_memory(&sc, padded, strlen(padded));
+    rows = scanner_batch(&sc, "%15[^,],%d", set_columns, 1, &error);
+    scanner_init_memory(&sc, padded, strlen(padded));
+    int assigned = scanner_scanf(&sc, "%15[^,],%d", scanf_name, &scanf_id);
+    if (rows == 1 && assigned == 2 && strcmp(batch_name, "  a b") == 0 &&
+        strcmp(batch_name, scanf_name) == 0 && batch_id == 1) {
+        printf("PASS (%%[ row keeps leading whitespace: [%s])\n", batch_name);
+    } else {
+        printf("FAIL (%%[ row: batch [%s] (%zu rows), scanf [%s] (%d)\n", batch_name, rows,
+               scanf_name, assigned);
+    }
+    printf("\n");
+}
+
+void test_parallel() {
+    printf("Testing multi-threaded chunked parsing\n");
+
+    // About 3 MB of records with a blank line now and then, so there are
+    // dozens of chunks
+    size_t count = 200000;
+    char *text = malloc(count * 24);
+    long long *ids = malloc(count * sizeof(long long));
+    double *values = malloc(count * sizeof(double));
+    if (text == NULL || ids == NULL || values == NULL) {
+        printf("FAIL (out of memory)\n");
+        free(text);
+        free(ids);
+        free(values);
+        return;
+    }
+    size_t len = 0;
+    for (size_t i = 0; i < count; i++) {
+        len += (size_t)sprintf(text + len, "%zu %zu.5\n%s", i * 3, i % 1000, i % 997 == 0 ? "\n" : "");
+    }
+    scan_column columns[] = {{ids, sizeof(long long)}, {values, sizeof(double)}};
+
+    int threads[] = {1, 4, 16};
+    for (int t = 0; t < 3; t++) {
+        memset(ids, 0, count * sizeof(long long));
+        size_t rows;
+        size_t error;
+        int ret = scan_parallel(text, len, "%lld %f", columns, count, threads[t], &rows, &error);
+        int in_order = 1;
+        for (size_t i = 0; i < count; i++) {
+            if (ids[i] != (long long)(i * 3) || values[i] != (double)(i % 1000) + 0.5) {
+                in_order = 0;
+                break;
+            }
+        }
+        if (ret == 0 && rows == count && error == SCAN_NO_ERROR && in_order) {
+            printf("PASS (%d threads: %zu rows in record order)\n", threads[t], rows);
+        } else {
+            printf("FAIL (%d threads: ret %d, %zu rows, error %zu)\n", threads[t], ret, rows, error);
+        }
+    }
+
+    // A malformed line deep inside the input stops the rows right before it
+    char *bad = strchr(text + len / 2, '\n') + 1;
+    if (*bad == '\n') {
+        bad++; // Skip a blank line
+    }
+    long long first;
+    sscanf(bad, "%lld", &first);
+    size_t bad_row = (size_t)first / 3;
+    char saved = bad[0];
+    bad[0] = '?';
+    size_t rows;
+    size_t error;
+    scan_parallel(text, len, "%lld %f", columns, count, 8, &rows, &error);
+    if (rows == bad_row && error == (size_t)(bad - text)) {
+        printf("PASS (stopped at malformed row %zu, offset %zu)\n", rows, error);
+    } else {
+        printf("FAIL (%zu rows and offset %zu, expected %zu and %zu)\n", rows, error, bad_row,
+               (size_t)(bad - text));
+    }
+    bad[0] = saved;
+
+    // A short row in the middle of a chunk is reported where it is, and the
+    // next line's fields are not pulled into it
+    char *short_line = strchr(text + len / 3, '\n') + 1;
+    if (*short_line == '\n') {
+        short_line++;
+    }
+    sscanf(short_line, "%lld", &first);
+    size_t short_row = (size_t)first / 3;
+    char *space = strchr(short_line, ' ');
+    memset(space, ' ', (size_t)(strchr(space, '\n') - space)); // "600 12.5" -> "600     "
+    scan_parallel(text, len, "%lld %f", columns, count, 4, &rows, &error);
+    if (rows == short_row && error == (size_t)(short_line - text)) {
+        printf("PASS (short row %zu reported at its own offset %zu)\n", rows, error);
+    } else {
+        printf("FAIL (%zu rows and offset %zu, expected %zu and %zu)\n", rows, error, short_row,
+               (size_t)(short_line - text));
+    }
+
+    free(text);
+    free(ids);
+    free(values);
+    printf("\n");
+}
+
+void test_string_widths() {
+    printf("Testing bounded and zero-copy string conversions\n");
+
+    // Widths split long tokens and leave the rest for the next conversion
+    char s1[8], s2[8], w1[4], w2[32];
+    char c4[4];
+    int ret = my_sscanf("abcdefghij klm_no!pq  xyzw", "%5s%7s %3w%31w %4c", s1, s2, w1, w2, c4);
+    if (ret == 5 && strcmp(s1, "abcde") == 0 && strcmp(s2, "fghij") == 0 &&
+        strcmp(w1, "klm") == 0 && strcmp(w2, "_no") == 0 && memcmp(c4, "!pq ", 4) == 0) {
+        printf("PASS (%%5s %%7s %%3w %%31w %%4c stop at their widths)\n");
+    } else {
+        printf("FAIL (returned %d: '%s' '%s' '%s' '%s')\n", ret, s1, s2, w1, w2);
+    }
+
+    // Views point into the input itself
+    const char *text = "  alpha beta-gamma\tdelta";
+    scan_view v1, v2, v3;
+    ret = my_sscanf(text, "%v %4v%v", &v1, &v2, &v3);
+    if (ret == 3 && v1.ptr == text + 2 && v1.len == 5 && v2.len == 4 &&
+        memcmp(v2.ptr, "beta", 4) == 0 && v3.len == 6 && memcmp(v3.ptr, "-gamma", 6) == 0) {
+        printf("PASS (%%v returns pointers into the input)\n");
+    } else {
+        printf("FAIL (%%v returned %d)\n", ret);
+    }
+
+    // With a small FILE buffer, tokens that straddle a refill are kept whole
+    FILE *reference = fopen("lzbop.txt", "r");
+    FILE *stream = fopen("lzbop.txt", "r");
+    if (reference == NULL || stream == NULL) {
+        printf("FAIL (could not open lzbop.txt)\n");
+        return;
+    }
+    scanner sc;
+    scanner_init_file(&sc, stream, 32);
+    int tokens = 0;
+    int mismatches = 0;
+    char word[100];
+    scan_view view;
+    while (fscanf(reference, "%99s", word) == 1) {
+        if (scanner_scanf(&sc, "%v", &view) != 1 || view.len != strlen(word) ||
+            memcmp(view.ptr, word, view.len) != 0) {
+            mismatches++;
+        }
+        tokens++;
+    }
+    if (mismatches == 0) {
+        printf("PASS (%d views across refills match fscanf)\n", tokens);
+    } else {
+        printf("FAIL (%d of %d views differ from fscanf)\n", mismatches, tokens);
+    }
+    scanner_destroy(&sc);
+    fclose(stream);
+    fclose(reference);
+
+    // Word kernels against the scalar version at every offset
+    char mixed[200];
+    const char pool[] = "aZ_09/:@[`{ \x80\xffqQ";
+    for (int i = 0; i < (int)sizeof(mixed); i++) {
+        mixed[i] = pool[(i * 5 + i / 11) % (sizeof(pool) - 1)];
+    }
+    const char *expected[sizeof(mixed)];
+    scan_simd_force(SCAN_SIMD_SCALAR);
+    for (int i = 0; i < (int)sizeof(mixed); i++) {
+        expected[i] = find_non_word(mixed + i, mixed + sizeof(mixed));
+    }
+    scan_simd_force(SCAN_SIMD_AVX2);
+    mismatches = 0;
+    for (int i = 0; i < (int)sizeof(mixed); i++) {
+        mismatches += (find_non_word(mixed + i, mixed + sizeof(mixed)) != expected[i]);
+    }
+    if (mismatches == 0) {
+        printf("PASS (word kernel matches scalar)\n");
+    } else {
+        printf("FAIL (word kernel differs at %d offsets)\n", mismatches);
+    }
+    printf("\n");
+}
+
+void test_scansets() {
+    printf("Testing %%[...] scansets\n");
+
+    // Same fields as sscanf for delimiters, ranges, negation, widths and the
+    // special placement of ']' and '-'
+    const char *inputs[] = {
+        "alpha,beta|gamma delta", "  lead,x|y", "a]b-c]d,e|f", ",empty|first", "x-y-z|end",
+        "UPPER lower 123", "\xc3\xa9t\xc3\xa9,ok|\x80"
+    };
+    const char *formats[] = {
+        "%[^,],%[^|]|%s", " %[^,],%[^|]|%s", "%[]a-c],%[^|]|%s", "%[^,],%[^|]|%s", "%[-x-z]|%s %s",
+        "%3[A-Z]%[A-Z ]%[a-z]", "%[^,],%2[^|]|%[\x80-\xff]"
+    };
+    int num_inputs = sizeof(inputs) / sizeof(inputs[0]);
+    int failures = 0;
+    for (int i = 0; i < num_inputs; i++) {
+        char a1[64] = "", b1[64] = "", c1[64] = "";
+        char a2[64] = "", b2[64] = "", c2[64] = "";
+        int r1 = sscanf(inputs[i], formats[i], a1, b1, c1);
+        int r2 = my_sscanf(inputs[i], formats[i], a2, b2, c2);
+        if (r1 != r2 || strcmp(a1, a2) != 0 || strcmp(b1, b2) != 0 || strcmp(c1, c2) != 0) {
+            printf("FAIL ('%s' with '%s': sscanf %d '%s' '%s' '%s', my_sscanf %d '%s' '%s' '%s')\n",
+                   inputs[i], formats[i], r1, a1, b1, c1, r2, a2, b2, c2);
+            failures++;
+        }
+    }
+    if (failures == 0) {
+        printf("PASS (%d scanset formats match sscanf)\n", num_inputs);
+    }
+
+    // Long delimited fields go through the vector kernels; compare them with
+    // the scalar bitmap at every offset for a few sets
+    char text[300];
+    for (int i = 0; i < (int)sizeof(text); i++) {
+        text[i] = (i % 23 == 0) ? (char)((i * 37 + i / 5) & 0xFF) : (char)('a' + i % 26);
+    }
+    const char *sets[] = {"%[^,|]", "%[a-z0-9_]", "%[\x01-\x7f]", "%[^\x80-\xff]"};
+    int mismatches = 0;
+    for (int k = 0; k < 4; k++) {
+        scan_program *prog = scan_compile(sets[k]);
+        const scan_set *set = &prog->sets[0];
+        for (int i = 0; i < (int)sizeof(text); i++) {
+            scan_simd_force(SCAN_SIMD_SCALAR);
+            const char *expected = find_not_in_set(set, text + i, text + sizeof(text));
+            for (int level = SCAN_SIMD_SSE2; level <= SCAN_SIMD_AVX2; level++) {
+                scan_simd_force((enum scan_simd_level)level);
+                mismatches += (find_not_in_set(set, text + i, text + sizeof(text)) != expected);
+            }
+        }
+        scan_program_free(prog);
+    }
+    scan_simd_force(SCAN_SIMD_AVX2);
+    if (mismatches == 0) {
+        printf("PASS (set kernels match scalar at every level)\n");
+    } else {
+        printf("FAIL (set kernels differ at %d offsets)\n", mismatches);
+    }
+    printf("\n");
+}
+
+void test_stats() {
+    printf("Testing hot-path statistics\n");
+
+    scan_stats_snapshot snap;
+    if (!scan_stats_enabled()) {
+        my_sscanf("1 2", "%d %d", &(int){0}, &(int){0});
+        scan_stats_snapshot_take(&snap);
+        if (snap.kinds[SCAN_STAT_INT].calls == 0) {
+            printf("PASS (compiled out; build with -DMY_SCANF_STATS to record)\n");
+        } else {
+            printf("FAIL (counters moved while compiled out)\n");
+        }
+        printf("\n");
+        return;
+    }
+
+    // One success of each, then a mismatch, an early EOF and an unknown specifier
+    scan_stats_reset();
+    int a, b;
+    char word[16];
+    my_sscanf("12 abc,x 9", "%d %3s,%d", &a, word, &b);
+    enum scan_stat_kind kind;
+    enum scan_fail_reason reason;
+    int got_last = scan_stats_last_failure(&kind, &reason);
+    my_sscanf("5", "%d %d", &a, &b);
+    my_sscanf("7", "%d %p", &a, &b);
+    scan_stats_snapshot_take(&snap);
+
+    scan_stat_counters *ints = &snap.kinds[SCAN_STAT_INT];
+    int ok = ints->calls == 5 && ints->successes == 3 && ints->failures[SCAN_FAIL_MISMATCH] == 1 &&
+             ints->failures[SCAN_FAIL_EOF] == 1 && ints->bytes == 2 + 1 + 1 + 0 + 1 &&
+             snap.kinds[SCAN_STAT_STRING].successes == 1 &&
+             snap.kinds[SCAN_STAT_LITERAL].successes == 1 &&
+             snap.kinds[SCAN_STAT_UNKNOWN].failures[SCAN_FAIL_UNSUPPORTED] == 1 &&
+             got_last && kind == SCAN_STAT_INT && reason == SCAN_FAIL_MISMATCH;
+    uint64_t histogram_total = 0;
+    for (int k = 0; k < SCAN_STATS_BUCKETS; k++) {
+        histogram_total += ints->histogram[k];
+    }
+    if (ok && histogram_total == ints->calls) {
+        printf("PASS (calls, failure reasons, bytes and histogram add up)\n");
+    } else {
+        printf("FAIL (%%d calls %llu, ok %llu, bytes %llu)\n", (unsigned long long)ints->calls,
+               (unsigned long long)ints->successes, (unsigned long long)ints->bytes);
+        scan_stats_print(stdout, &snap);
+    }
+
+    // A scan that succeeds clears the failure of the one before it
+    my_sscanf("x", "%d", &a);
+    int failed_first = scan_stats_last_failure(&kind, &reason);
+    my_sscanf("4 5", "%d %d", &a, &b);
+    int failed_after = scan_stats_last_failure(&kind, &reason);
+    if (failed_first && !failed_after) {
+        printf("PASS (a successful scan clears the last failure)\n");
+    } else {
+        printf("FAIL (last failure %d before, %d after a successful scan)\n", failed_first,
+               failed_after);
+    }
+
+    // So does each push record
+    scan_push ps;
+    scan_push_init(&ps, "%d,%d", &a, &b);
+    scan_push_feed(&ps, "x,1\n2,3\n", 8);
+    enum scan_push_status bad = scan_push_next(&ps);
+    failed_first = scan_stats_last_failure(&kind, &reason);
+    enum scan_push_status good = scan_push_next(&ps);
+    failed_after = scan_stats_last_failure(&kind, &reason);
+    scan_push_destroy(&ps);
+    if (bad == SCAN_PUSH_ERROR && good == SCAN_PUSH_RECORD && failed_first && !failed_after) {
+        printf("PASS (a successful push record clears the last failure)\n");
+    } else {
+        printf("FAIL (push statuses %d %d, last failure %d then %d)\n", (int)bad, (int)good,
+               failed_first, failed_after);
+    }
+
+    // Counts from worker threads show up in the aggregate
+    char text[4096];
+    size_t len = 0;
+    for (int i = 0; i < 400; i++) {
+        len += (size_t)sprintf(text + len, "%d\n", i);
+    }
+    int values[400];
+    scan_column column = {values, sizeof(int)};
+    size_t rows;
+    scan_stats_reset();
+    scan_parallel(text, len, "%d", &column, 400, 4, &rows, NULL);
+    scan_stats_snapshot_take(&snap);
+    if (rows == 400 && snap.kinds[SCAN_STAT_INT].successes == 400) {
+        printf("PASS (per-thread counters aggregate to %zu)\n", rows);
+    } else {
+        printf("FAIL (%llu successes for %zu rows)\n",
+               (unsigned long long)snap.kinds[SCAN_STAT_INT].successes, rows);
+    }
+    printf("\n");
+}
+
+// A caller-side variadic wrapper, the kind my_vsscanf exists for
+int logged_sscanf(const char *str, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int count = my_vsscanf(str, format, args);
+    va_end(args);
+    return count;
+}
+
+typedef struct pipe_reader {
+    int fd;
+    long long sum;
+    int count;
+} pipe_reader;
+
+void *read_pipe_ints(void *arg) {
+    pipe_reader *reader = arg;
+    scanner sc;
+    scanner_init_fd(&sc, reader->fd, 64);
+    int value;
+    while (scanner_scanf(&sc, "%d", &value) == 1) {
+        reader->sum += value;
+        reader->count++;
+    }
+    scanner_destroy(&sc);
+    return NULL;
+}
+
+void test_reentrant() {
+    printf("Testing v-variants, my_fscanf and descriptor scanning\n");
+
+    int a = 0;
+    int b = 0;
+    char word[16];
+    if (logged_sscanf("7 eight 9", "%d %15s %d", &a, word, &b) == 3 && a == 7 && b == 9 &&
+        strcmp(word, "eight") == 0) {
+        printf("PASS (my_vsscanf through a variadic wrapper)\n");
+    } else {
+        printf("FAIL (my_vsscanf read %d '%s' %d)\n", a, word, b);
+    }
+
+    // my_fscanf leaves the stream right after the last consumed byte
+    FILE *stream = tmpfile();
+    fputs("10 20 tail", stream);
+    rewind(stream);
+    char rest[16] = "";
+    if (my_fscanf(stream, "%d %d", &a, &b) == 2 && a == 10 && b == 20 &&
+        fscanf(stream, "%15s", rest) == 1 && strcmp(rest, "tail") == 0) {
+        printf("PASS (my_fscanf read 10 20, stream resumes at '%s')\n", rest);
+    } else {
+        printf("FAIL (my_fscanf read %d %d, stream resumed at '%s')\n", a, b, rest);
+    }
+    fclose(stream);
+
+    // my_dscanf on a file seeks back whatever it read ahead
+    int fd = open("lzbop.txt", O_RDONLY);
+    char first[32];
+    char second[32];
+    char third[32];
+    int ok = fd >= 0 && my_dscanf(fd, "%31s %31s", first, second) == 2 &&
+             my_dscanf(fd, "%31s", third) == 1 && strcmp(third, "the") == 0;
+    if (ok) {
+        printf("PASS (consecutive my_dscanf calls: '%s' '%s' '%s')\n", first, second, third);
+    } else {
+        printf("FAIL (my_dscanf did not resume after its own reads)\n");
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    // On a pipe it reads byte by byte, so the next call still sees the rest
+    int fds[2];
+    if (pipe(fds) == 0) {
+        const char *text = "12 34\n56";
+        write(fds[1], text, strlen(text));
+        close(fds[1]);
+        int c = 0;
+        ok = my_dscanf(fds[0], "%d", &a) == 1 && my_dscanf(fds[0], "%d %d", &b, &c) == 2;
+        if (ok && a == 12 && b == 34 && c == 56) {
+            printf("PASS (my_dscanf on a pipe read %d, then %d %d)\n", a, b, c);
+        } else {
+            printf("FAIL (my_dscanf on a pipe read %d, then %d %d)\n", a, b, c);
+        }
+        close(fds[0]);
+    }
+
+    // Several threads each drain their own pipe through their own scanner
+    enum { READERS = 4, VALUES = 2000 };
+    pipe_reader readers[READERS];
+    pthread_t threads[READERS];
+    int writers[READERS];
+    for (int t = 0; t < READERS; t++) {
+        int p[2];
+        if (pipe(p) != 0) {
+            printf("FAIL (could not create pipes)\n\n");
+            return;
+        }
+        readers[t] = (pipe_reader){p[0], 0, 0};
+        writers[t] = p[1];
+        pthread_create(&threads[t], NULL, read_pipe_ints, &readers[t]);
+    }
+    for (int i = 0; i < VALUES; i++) {
+        for (int t = 0; t < READERS; t++) {
+            char line[32];
+            int len = sprintf(line, "%d\n", i * (t + 1));
+            write(writers[t], line, (size_t)len);
+        }
+    }
+    ok = 1;
+    for (int t = 0; t < READERS; t++) {
+        close(writers[t]);
+        pthread_join(threads[t], NULL);
+        close(readers[t].fd);
+        long long expected = (long long)(t + 1) * VALUES * (VALUES - 1) / 2;
+        ok = ok && readers[t].count == VALUES && readers[t].sum == expected;
+    }
+    if (ok) {
+        printf("PASS (%d threads each scanned %d values from their own pipe)\n", READERS, VALUES);
+    } else {
+        printf("FAIL (a concurrent pipe reader lost values)\n");
+    }
+    printf("\n");
+}
+
+void test_push() {
+    printf("Testing push-style incremental scanning\n");
+
+    // Fed one byte at a time, tokens like 1.4142 and MCMXC arrive in pieces
+    const char *text = "1.4142 MCMXC root\n2.5e3 XIV two_words\n-0.75 MMXXIV last";
+    double value;
+    int roman;
+    char word[16];
+    scan_push ps;
+    scan_push_init(&ps, "%f %r %15s", &value, &roman, word);
+
+    double values[3];
+    int romans[3];
+    char words[3][16];
+    int records = 0;
+    int early = 0; // Records returned before their last token could have ended
+    size_t fed = 0;
+    enum scan_push_status status;
+    for (;;) {
+        while ((status = scan_push_next(&ps)) == SCAN_PUSH_RECORD) {
+            if (records < 3) {
+                values[records] = value;
+                romans[records] = roman;
+                strcpy(words[records], word);
+            }
+            early += (records == 0 && fed < 18);
+            records++;
+        }
+        if (status != SCAN_PUSH_NEED_MORE) {
+            break;
+        }
+        if (text[fed] == '\0') {
+            scan_push_finish(&ps);
+        } else {
+            scan_push_feed(&ps, text + fed++, 1);
+        }
+    }
+    scan_push_destroy(&ps);
+
+    int ok = status == SCAN_PUSH_END && records == 3 && !early &&
+             values[0] == 1.4142 && romans[0] == 1990 && strcmp(words[0], "root") == 0 &&
+             values[1] == 2500.0 && romans[1] == 14 && strcmp(words[1], "two_words") == 0 &&
+             values[2] == -0.75 && romans[2] == 2024 && strcmp(words[2], "last") == 0;
+    if (ok) {
+        printf("PASS (byte-at-a-time feed gives the same 3 records as a blocking scan)\n");
+    } else {
+        printf("FAIL (%d records, status %d)\n", records, (int)status);
+    }
+
+    // Random fragment sizes over many records match scan_batch over the whole text
+    enum { ROWS = 2000 };
+    char *data = malloc(ROWS * 48);
+    size_t len = 0;
+    unsigned int seed = 12345;
+    for (int i = 0; i < ROWS; i++) {
+        seed = seed * 1103515245u + 12345u;
+        len += (size_t)sprintf(data + len, "%d,%x:%s\n", (int)(seed >> 8) - 4000000,
+                               seed, (seed & 1) ? "alpha" : "be_ta9");
+    }
+    int ids[ROWS];
+    unsigned int hexes[ROWS];
+    char names[ROWS][8];
+    scan_column columns[] = {{ids, sizeof(int)}, {hexes, sizeof(unsigned int)}, {names, 8}};
+    scanner sc;
+    scanner_init_memory(&sc, data, len);
+    size_t batch_rows = scanner_batch(&sc, "%d,%x:%7w", columns, ROWS, NULL);
+
+    int id;
+    unsigned int hex;
+    char name[8];
+    scan_push_init(&ps, "%d,%x:%7w", &id, &hex, name);
+    size_t mismatches = 0;
+    size_t pushed = 0;
+    size_t pos = 0;
+    for (;;) {
+        while ((status = scan_push_next(&ps)) == SCAN_PUSH_RECORD) {
+            if (pushed >= ROWS || id != ids[pushed] || hex != hexes[pushed] ||
+                strcmp(name, names[pushed]) != 0) {
+                mismatches++;
+            }
+            pushed++;
+        }
+        if (status != SCAN_PUSH_NEED_MORE) {
+            break;
+        }
+        if (pos == len) {
+            scan_push_finish(&ps);
+            continue;
+        }
+        seed = seed * 1103515245u + 12345u;
+        size_t piece = 1 + (seed >> 16) % 23;
+        if (piece > len - pos) {
+            piece = len - pos;
+        }
+        scan_push_feed(&ps, data + pos, piece);
+        pos += piece;
+    }
+    scan_push_destroy(&ps);
+    free(data);
+    if (status == SCAN_PUSH_END && pushed == batch_rows && batch_rows == ROWS && mismatches == 0) {
+        printf("PASS (%zu records from random fragments match scan_batch)\n", pushed);
+    } else {
+        printf("FAIL (%zu pushed, %zu batch, %zu mismatches, status %d)\n", pushed, batch_rows,
+               mismatches, (int)status);
+    }
+
+    // A malformed record is reported with its offset
+    const char *bad = "1,2\n x";
+    scan_push_init(&ps, "%d,%d", &id, &roman);
+    scan_push_feed(&ps, bad, strlen(bad));
+    enum scan_push_status first = scan_push_next(&ps);
+    status = scan_push_next(&ps);
+    if (first == SCAN_PUSH_RECORD && status == SCAN_PUSH_ERROR && scan_push_offset(&ps) == 5) {
+        printf("PASS (malformed record reported at offset %zu)\n", scan_push_offset(&ps));
+    } else {
+        printf("FAIL (statuses %d %d, offset %zu)\n", (int)first, (int)status, scan_push_offset(&ps));
+    }
+
+    // Then the rest of its line is dropped, even when it arrives later, and
+    // scanning goes on with the next line
+    id = roman = 0;
+    enum scan_push_status waiting = scan_push_next(&ps);
+    scan_push_feed(&ps, ",3\n6,7\n", 7);
+    enum scan_push_status after = scan_push_next(&ps);
+    int after_id = id;
+    int after_value = roman;
+    scan_push_finish(&ps);
+    status = scan_push_next(&ps);
+    if (waiting == SCAN_PUSH_NEED_MORE && after == SCAN_PUSH_RECORD && after_id == 6 &&
+        after_value == 7 && status == SCAN_PUSH_END) {
+        printf("PASS (scanning resumes on the line after a malformed one)\n");
+    } else {
+        printf("FAIL (statuses %d %d %d, next record %d,%d)\n", (int)waiting, (int)after, (int)status,
+               after_id, after_value);
+    }
+    scan_push_destroy(&ps);
+    printf("\n");
+}
+
+// Every destination any generated test parser writes, so both sides of a
+// differential run can be compared with one memcmp
+typedef struct codegen_out {
+    int i[2];
+    unsigned int u;
+    double d;
+    char s[2][32];
+    char chars[4];
+    unsigned long long ull;
+    unsigned short us;
+    signed char hh;
+    intmax_t j;
+    size_t z;
+    long double ld;
+    float f;
+    long l;
+    scan_view v;
+    scan_number n;
+} codegen_out;
+
+// Runs generated parser `which` (same order as formats.txt) on sc
+int run_generated(int which, scanner *sc, codegen_out *o) {
+    switch (which) {
+        case 0: return scan_point(sc, &o->i[0], &o->i[1]);
+        case 1: return scan_record(sc, &o->i[0], &o->d, o->s[0]);
+        case 2: return scan_dump_line(sc, &o->ull, o->chars, &o->us);
+        case 3: return scan_csv_row(sc, o->s[0], o->s[1], &o->hh);
+        case 4: return scan_tagged(sc, &o->u, o->s[0], &o->d);
+        case 5: return scan_roman_entry(sc, &o->i[0], &o->u, &o->v);
+        case 6: return scan_mixed_lengths(sc, &o->j, &o->z, &o->ld, &o->f, &o->l);
+        case 7: return scan_id_value(sc, &o->i[0], &o->d);
+        case 8: return scan_measurement(sc, o->s[0], &o->n);
+        default: return scan_picked_columns(sc, &o->i[0], &o->d);
+    }
+}
+
+// Runs the interpreter on the same format and destinations
+int run_interpreted(int which, scanner *sc, const char *format, codegen_out *o) {
+    switch (which) {
+        case 0: return scanner_scanf(sc, format, &o->i[0], &o->i[1]);
+        case 1: return scanner_scanf(sc, format, &o->i[0], &o->d, o->s[0]);
+        case 2: return scanner_scanf(sc, format, &o->ull, o->chars, &o->us);
+        case 3: return scanner_scanf(sc, format, o->s[0], o->s[1], &o->hh);
+        case 4: return scanner_scanf(sc, format, &o->u, o->s[0], &o->d);
+        case 5: return scanner_scanf(sc, format, &o->i[0], &o->u, &o->v);
+        case 6: return scanner_scanf(sc, format, &o->j, &o->z, &o->ld, &o->f, &o->l);
+        case 7: return scanner_scanf(sc, format, &o->i[0], &o->d);
+        case 8: return scanner_scanf(sc, format, o->s[0], &o->n);
+        default: return scanner_scanf(sc, format, &o->i[0], &o->d);
+    }
+}
+
+void test_codegen() {
+    printf("Testing generated parsers against the interpreter\n");
+
+    // Formats in formats.txt order, each with good, truncated and malformed inputs
+    const char *formats[] = {
+        "(%d, %d)", "%d,%f %15s", "%llx: %4c|%hu", "%31[^,],%31[^,],%hhd",
+        "id=%u name=%15w score=%lf%%", "%r-%b %v", "%jd %zu %Lf %hf %ld\n", "%d,%f",
+        "%15w=%N", "%*d,%*f,%d,%*[^,],%*x %*r %*s %lf"
+    };
+    const char *inputs[][6] = {
+        {"(3, -4)", "(3,-4) tail", " (3, 4)", "(3; 4)", "(99999999999, 1", "("},
+        {"17,2.5 name", "-1,1e300  a_very_long_string_value", "5,x y", "5 ,1 z", "5,", ""},
+        {"DEADbeef: abcd|65535", "0x1f:xy z|70000", "ff:\tab", "1f: ab|x", "zz", "ff: abcd|-1"},
+        {"alpha,beta,127", " alpha,beta,300", ",beta,1", "a,b", "a,,1", "x,y,-129\n"},
+        {"id=7 name=ab_c score=99.5%", "id=7name=x score=1%", "id=7 nam=x", "id=x", "id=1 name=w score=2 %",
+         "id=1 name=abcdefghijklmnopqrs score=1%"},
+        {"MCMXCIV-0b101 view", "XIV-11", "IV-2 v", "-1 v", "MMM-0b102 tail", "X-1\n"},
+        {"-9223372036854775808 18446744073709551615 1.5 2.5 -7\n\n", "1 2 3 4", "1 -2 3 4 5", "x", "1 2 0x1p-1074 inf 9", ""},
+        {"12,3.25\n", "-7,1e-400", "2147483648,1", "3,,4", "3,nan", " 4 , 5"},
+        {"width=0x1F", "rate=39e-5", "mask=0b1011 ", "bad=zz", "id=-017", "x=54ed,"},
+        {"99999999999999999999,1e999,7,a b,0xFF MCM x 2.5", "1,2,3,c,0b1 X y 0x1p-3",
+         "-1,inf,-4,,ff V z 1", "1,nanx,2,d,1 I s 3", "1,.,2", "1,0x.8p1,5,e,g I t .5e1"}
+    };
+    int formats_count = (int)(sizeof(formats) / sizeof(formats[0]));
+    int inputs_per_format = (int)(sizeof(inputs[0]) / sizeof(inputs[0][0]));
+
+    int runs = 0;
+    int mismatches = 0;
+    for (int f = 0; f < formats_count; f++) {
+        for (int k = 0; k < inputs_per_format; k++) {
+            const char *input = inputs[f][k];
+            size_t len = strlen(input);
+
+            // Both over memory, and both over a 4-byte FILE buffer so tokens straddle refills
+            for (int over_file = 0; over_file < 2; over_file++) {
+                codegen_out generated;
+                codegen_out interpreted;
+                memset(&generated, 0x5a, sizeof(generated));
+                memset(&interpreted, 0x5a, sizeof(interpreted));
+
+                scanner a;
+                scanner b;
+                FILE *fa = NULL;
+                FILE *fb = NULL;
+                if (over_file) {
+                    fa = fmemopen((void *)input, len > 0 ? len : 1, "r");
+                    fb = fmemopen((void *)input, len > 0 ? len : 1, "r");
+                    scanner_init_file(&a, fa, 4);
+                    scanner_init_file(&b, fb, 4);
+                } else {
+                    scanner_init_memory(&a, input, len);
+                    scanner_init_memory(&b, input, len);
+                }
+
+                errno = 0;
+                int ret_generated = run_generated(f, &a, &generated);
+                int errno_generated = errno;
+                errno = 0;
+                int ret_interpreted = run_interpreted(f, &b, formats[f], &interpreted);
+                int same = ret_generated == ret_interpreted && errno_generated == errno &&
+                           scanner_offset(&a) == scanner_offset(&b);
+
+                // Views point into each scanner's own buffer; compare them by offset
+                if (generated.v.ptr != interpreted.v.ptr && generated.v.len == interpreted.v.len &&
+                    over_file) {
+                    generated.v.ptr = interpreted.v.ptr;
+                }
+                same = same && memcmp(&generated, &interpreted, sizeof(generated)) == 0;
+                if (!same) {
+                    mismatches++;
+                    printf("FAIL (format %d input %d%s: generated %d, interpreted %d)\n", f, k,
+                           over_file ? " over FILE" : "", ret_generated, ret_interpreted);
+                }
+                runs++;
+
+                scanner_destroy(&a);
+                scanner_destroy(&b);
+                if (over_file) {
+                    fclose(fa);
+                    fclose(fb);
+                }
+            }
+        }
+    }
+    if (mismatches == 0) {
+        printf("PASS (%d runs: same counts, values, errno and bytes consumed)\n", runs);
+    }
+
+    printf("\n");
+}
+
+void test_checkpoints() {
+    printf("Testing checkpoints and all-or-nothing scans\n");
+
+    // %x eats "0xz" before failing; a rollback puts all three bytes back
+    scanner sc;
+    scanner_init_memory(&sc, "0xz 12", 6);
+    unsigned int hex;
+    char word[16];
+    scanner_checkpoint cp = scanner_mark(&sc);
+    int failed = scanner_scanf(&sc, "%x", &hex) == 0 && scanner_offset(&sc) == 3;
+    scanner_rollback(&sc, cp);
+    if (failed && scanner_offset(&sc) == 0 && scanner_scanf(&sc, "%15w", word) == 1 &&
+        strcmp(word, "0xz") == 0) {
+        printf("PASS (rollback after a failed %%x, reread '%s')\n", word);
+    } else {
+        printf("FAIL (rollback did not restore the position)\n");
+    }
+
+    // Nested checkpoints: roll back the inner one, commit the outer one
+    scanner_init_memory(&sc, "1 2 3", 5);
+    int a = 0;
+    int b = 0;
+    scanner_checkpoint outer = scanner_mark(&sc);
+    scanner_scanf(&sc, "%d", &a);
+    scanner_checkpoint inner = scanner_mark(&sc);
+    scanner_scanf(&sc, "%d", &b);
+    scanner_rollback(&sc, inner);
+    scanner_commit(&sc, outer);
+    if (scanner_scanf(&sc, "%d", &b) == 1 && a == 1 && b == 2 && sc.pin == SCANNER_NO_PIN) {
+        printf("PASS (nested checkpoints: inner rolled back, outer committed)\n");
+    } else {
+        printf("FAIL (nested checkpoints left a=%d b=%d)\n", a, b);
+    }
+
+    // A speculative scan spanning many refills of an 8-byte buffer rolls back
+    // completely, because pinned bytes are kept and the buffer grows
+    FILE *stream = tmpfile();
+    fputs("1 2 3 4 5 6 7 8 9 10 11 12 x 13", stream);
+    rewind(stream);
+    scanner_init_file(&sc, stream, 8);
+    int v[13];
+    int tried = scanner_try_scanf(&sc, "%d %d %d %d %d %d %d %d %d %d %d %d %d", &v[0], &v[1],
+                                  &v[2], &v[3], &v[4], &v[5], &v[6], &v[7], &v[8], &v[9], &v[10],
+                                  &v[11], &v[12]);
+    int first = 0;
+    int ok = tried == 0 && scanner_offset(&sc) == 0 && scanner_scanf(&sc, "%d", &first) == 1 &&
+             first == 1;
+    if (ok) {
+        printf("PASS (failed 13-field try rolled back across refills, buffer grew to %zu)\n",
+               sc.cap);
+    } else {
+        printf("FAIL (try returned %d, offset %zu)\n", tried, scanner_offset(&sc));
+    }
+    scanner_destroy(&sc);
+
+    // Alternative formats on a FILE: the first guess leaves the stream untouched
+    rewind(stream);
+    ok = my_try_fscanf(stream, "%d:%d", &a, &b) == 0 && ftell(stream) == 0 &&
+         my_try_fscanf(stream, "%d %d", &a, &b) == 2 && a == 1 && b == 2;
+    if (ok) {
+        printf("PASS (my_try_fscanf: '%%d:%%d' rejected, '%%d %%d' read %d %d)\n", a, b);
+    } else {
+        printf("FAIL (my_try_fscanf left the stream at %ld)\n", ftell(stream));
+    }
+    fclose(stream);
+    printf("\n");
+}
+
+void test_numbers() {
+    printf("Testing %%N numeric auto-detection\n");
+
+    // Token, expected kind, expected integer (or float text), byte left unread
+    struct {
+        const char *input;
+        enum scan_number_kind kind;
+        long long value;
+        const char *float_text;
+        char next;
+    } cases[] = {
+        {"1010 ", SCAN_NUMBER_DECIMAL, 1010, NULL, ' '},
+        {"0b111,", SCAN_NUMBER_BINARY, 7, NULL, ','},
+        {"0B111", SCAN_NUMBER_BINARY, 7, NULL, '\0'},
+        {"x10 ", SCAN_NUMBER_HEX, 16, NULL, ' '},
+        {"BEEF;", SCAN_NUMBER_HEX, 0xBEEF, NULL, ';'},
+        {"54ed", SCAN_NUMBER_HEX, 0x54ed, NULL, '\0'},
+        {"-0x1F)", SCAN_NUMBER_HEX, -31, NULL, ')'},
+        {"017 ", SCAN_NUMBER_OCTAL, 15, NULL, ' '},
+        {"089 ", SCAN_NUMBER_DECIMAL, 89, NULL, ' '},
+        {"7/4", SCAN_NUMBER_DECIMAL, 7, NULL, '/'},
+        {"0x ", SCAN_NUMBER_DECIMAL, 0, NULL, 'x'},
+        {"1e+ ", SCAN_NUMBER_HEX, 0x1e, NULL, '+'},
+        {"39e-5 ", SCAN_NUMBER_FLOAT, 0, "39e-5", ' '},
+        {"2e10", SCAN_NUMBER_FLOAT, 0, "2e10", '\0'},
+        {"-1.41421356,", SCAN_NUMBER_FLOAT, 0, "-1.41421356", ','},
+        {".5x", SCAN_NUMBER_FLOAT, 0, ".5", 'x'},
+        {"3.", SCAN_NUMBER_FLOAT, 0, "3.", '\0'},
+        {"99999999999999999999 ", SCAN_NUMBER_DECIMAL, LLONG_MAX, NULL, ' '},
+        {"-0b1000000000000000000000000000000000000000000000000000000000000000",
+         SCAN_NUMBER_BINARY, LLONG_MIN, NULL, '\0'},
+    };
+    int count = (int)(sizeof(cases) / sizeof(cases[0]));
+    int failures = 0;
+    for (int i = 0; i < count; i++) {
+        scan_number number;
+        scanner sc;
+        scanner_init_memory(&sc, cases[i].input, strlen(cases[i].input));
+        int ok = scanner_scanf(&sc, "%N", &number) == 1 && number.kind == cases[i].kind;
+        if (ok && cases[i].float_text != NULL) {
+            ok = number.f == strtod(cases[i].float_text, NULL);
+        } else if (ok) {
+            ok = number.i == cases[i].value;
+        }
+        int next = (sc.cur < sc.end) ? *sc.cur : '\0';
+        if (!ok || next != cases[i].next) {
+            printf("FAIL ('%s' read as kind %d, next '%c')\n", cases[i].input, (int)number.kind, next);
+            failures++;
+        }
+    }
+    if (failures == 0) {
+        printf("PASS (%d tokens classified, valued and ended correctly)\n", count);
+    }
+
+    // Nothing numeric: fails without consuming anything
+    scanner sc;
+    scan_number number;
+    scanner_init_memory(&sc, "-zz", 3);
+    if (scanner_scanf(&sc, "%N", &number) == 0 && scanner_offset(&sc) == 0) {
+        printf("PASS (non-number rejected with nothing consumed)\n");
+    } else {
+        printf("FAIL (non-number consumed %zu bytes)\n", scanner_offset(&sc));
+    }
+
+    // The mixed column of lzbop.txt in one pass: every %N token agrees with the
+    // specifier a caller would otherwise have had to guess
+    const char *mixed = "1010 0b111 x10 BEEF 39e-5 1A 2e10 0.543 54ed";
+    scanner_init_memory(&sc, mixed, strlen(mixed));
+    int kinds[5] = {0};
+    int tokens = 0;
+    while (scanner_scanf(&sc, "%N", &number) == 1) {
+        kinds[number.kind]++;
+        tokens++;
+    }
+    if (tokens == 9 && kinds[SCAN_NUMBER_DECIMAL] == 1 && kinds[SCAN_NUMBER_BINARY] == 1 &&
+        kinds[SCAN_NUMBER_HEX] == 4 && kinds[SCAN_NUMBER_FLOAT] == 3) {
+        printf("PASS (mixed column: 1 decimal, 1 binary, 4 hex, 3 float)\n");
+    } else {
+        printf("FAIL (mixed column read %d tokens)\n", tokens);
+    }
+    printf("\n");
+}
+
+void test_arena() {
+    printf("Testing allocating conversions and scan arenas\n");
+
+    // Many words through a small-block arena: each string is intact and the
+    // arena spilled over into several blocks
+    char text[4096];
+    size_t text_len = 0;
+    for (int i = 0; i < 300; i++) {
+        text_len += (size_t)sprintf(text + text_len, "word%d ", i);
+    }
+    scan_arena arena;
+    scan_arena_init(&arena, 64);
+    scanner sc;
+    scanner_init_memory(&sc, text, text_len);
+    scanner_set_arena(&sc, &arena);
+    char *words[300];
+    int good = 0;
+    for (int i = 0; i < 300; i++) {
+        good += scanner_scanf(&sc, "%mw", &words[i]) == 1;
+    }
+    // Check only after the arena has spilled into its later blocks
+    for (int i = 0; i < 300; i++) {
+        char expected[16];
+        sprintf(expected, "word%d", i);
+        good -= strcmp(words[i], expected) != 0;
+    }
+    if (good == 300 && arena.used == text_len) {
+        printf("PASS (300 words, %zu bytes in 64-byte blocks)\n", arena.used);
+    } else {
+        printf("FAIL (%d words correct, %zu bytes used)\n", good, arena.used);
+    }
+
+    // Widths, scansets, and a string bigger than the block size
+    char big[200];
+    memset(big, 'q', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    char line[256];
+    sprintf(line, "abcdefgh key one,%s", big);
+    scan_arena_reset(&arena);
+    scanner_init_memory(&sc, line, strlen(line));
+    scanner_set_arena(&sc, &arena);
+    char *first = NULL;
+    char *rest = NULL;
+    char *field = NULL;
+    char *huge = NULL;
+    int count = scanner_scanf(&sc, "%5ms%ms %m[^,],%ms", &first, &rest, &field, &huge);
+    if (count == 4 && strcmp(first, "abcde") == 0 && strcmp(rest, "fgh") == 0 &&
+        strcmp(field, "key one") == 0 && strcmp(huge, big) == 0) {
+        printf("PASS (\"%s\" \"%s\" \"%s\" and a %zu-byte string)\n", first, rest, field,
+               strlen(huge));
+    } else {
+        printf("FAIL (count %d)\n", count);
+    }
+    scan_arena_destroy(&arena);
+
+    // Without an arena each string is malloc'd for the caller, as with POSIX %ms
+    char *owned = NULL;
+    char *untouched = (char *)"sentinel";
+    count = my_sscanf("hello   ", "%ms%ms", &owned, &untouched);
+    if (count == 1 && strcmp(owned, "hello") == 0 && strcmp(untouched, "sentinel") == 0) {
+        printf("PASS (malloc'd \"%s\", failed conversion left its pointer alone)\n", owned);
+    } else {
+        printf("FAIL (count %d)\n", count);
+    }
+    free(owned);
+
+    // A long token read through a 4-byte FILE window is copied once, whole
+    const char *stream_text = "a_token_much_longer_than_the_window,tail";
+    FILE *stream = fmemopen((void *)stream_text, strlen(stream_text), "r");
+    char file_buffer[4];
+    scanner_attach_stream(&sc, stream, file_buffer, sizeof(file_buffer));
+    char *token = NULL;
+    char *tail = NULL;
+    count = scanner_scanf(&sc, "%m[^,],%mw", &token, &tail);
+    if (count == 2 && strcmp(token, "a_token_much_longer_than_the_window") == 0 &&
+        strcmp(tail, "tail") == 0) {
+        printf("PASS (\"%s\" across refills)\n", token);
+    } else {
+        printf("FAIL (count %d)\n", count);
+    }
+    free(token);
+    free(tail);
+    if (sc.owns_buf) {
+        free(sc.buf);
+    }
+    fclose(stream);
+
+    // Batch columns of strings, and the same format as a generated parser
+    const char *rows = "k1=alpha\nkey2=beta\nk3=gamma\n";
+    scan_arena_init(&arena, 0);
+    scanner_init_memory(&sc, rows, strlen(rows));
+    scanner_set_arena(&sc, &arena);
+    char *keys[3];
+    char *values[3];
+    scan_column columns[] = {{keys, sizeof(char *)}, {values, sizeof(char *)}};
+    size_t error_offset;
+    size_t loaded = scanner_batch(&sc, "%m[^=]=%mw\n", columns, 3, &error_offset);
+    scanner gen;
+    scanner_init_memory(&gen, rows, strlen(rows));
+    scanner_set_arena(&gen, &arena);
+    char *gen_key = NULL;
+    char *gen_value = NULL;
+    int gen_count = scan_key_value(&gen, &gen_key, &gen_value);
+    if (loaded == 3 && strcmp(keys[1], "key2") == 0 && strcmp(values[2], "gamma") == 0 &&
+        gen_count == 2 && strcmp(gen_key, "k1") == 0 && strcmp(gen_value, "alpha") == 0) {
+        printf("PASS (batch %s=%s, generated %s=%s)\n", keys[1], values[1], gen_key, gen_value);
+    } else {
+        printf("FAIL (loaded %zu, generated %d)\n", loaded, gen_count);
+    }
+    scan_arena_destroy(&arena);
+
+    // 'm' only applies to string conversions
+    int number = 0;
+    count = my_sscanf("12", "%md", &number);
+    if (count == 0 && number == 0) {
+        printf("PASS (%%md rejected)\n");
+    } else {
+        printf("FAIL (%%md returned %d)\n", count);
+    }
+    printf("\n");
+}
+
+void test_intern() {
+    printf("Testing %%W identifier interning\n");
+
+    // Repeated words get the same ID and the same canonical pointer
+    scan_intern table;
+    scan_intern_init(&table, 0);
+    const char *log_line = "else_should if else_should then if";
+    scanner sc;
+    scanner_init_memory(&sc, log_line, strlen(log_line));
+    scanner_set_intern(&sc, &table);
+    unsigned int ids[5];
+    int count = scanner_scanf(&sc, "%W %W %W %W %W", &ids[0], &ids[1], &ids[2], &ids[3], &ids[4]);
+    const char *first = scan_intern_string(&table, ids[0]);
+    if (count == 5 && ids[0] == 0 && ids[1] == 1 && ids[2] == 0 && ids[3] == 2 && ids[4] == 1 &&
+        table.count == 3 && strcmp(first, "else_should") == 0 &&
+        scan_intern_string(&table, ids[2]) == first && scan_intern_string(&table, 3) == NULL) {
+        printf("PASS (IDs %u %u %u %u %u, \"%s\")\n", ids[0], ids[1], ids[2], ids[3], ids[4], first);
+    } else {
+        printf("FAIL (count %d, %u distinct)\n", count, table.count);
+    }
+
+    // Enough distinct words to grow the index several times, read twice
+    static char text[131072];
+    size_t text_len = 0;
+    for (int i = 0; i < 5000; i++) {
+        text_len += (size_t)sprintf(text + text_len, "ident_%d ", i * 7919);
+    }
+    int stable = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        scanner_init_memory(&sc, text, text_len);
+        scanner_set_intern(&sc, &table);
+        for (unsigned int i = 0; i < 5000; i++) {
+            unsigned int id;
+            char expected[32];
+            sprintf(expected, "ident_%u", i * 7919);
+            stable += scanner_scanf(&sc, "%W", &id) == 1 && id == i + 3 &&
+                      strcmp(scan_intern_string(&table, id), expected) == 0;
+        }
+    }
+    if (stable == 10000 && table.count == 5003) {
+        printf("PASS (5000 words, IDs stable across passes, %zu slots)\n", table.mask + 1);
+    } else {
+        printf("FAIL (%d of 10000 lookups right, %u distinct)\n", stable, table.count);
+    }
+
+    // Widths, and words longer than a 4-byte FILE window
+    const char *stream_text = "abcdef a_word_spanning_many_refills,a_word_spanning_many_refills";
+    FILE *stream = fmemopen((void *)stream_text, strlen(stream_text), "r");
+    scanner_init_file(&sc, stream, 4);
+    scanner_set_intern(&sc, &table);
+    unsigned int a, b, c, d;
+    count = scanner_scanf(&sc, "%3W%W %W,%W", &a, &b, &c, &d);
+    if (count == 4 && strcmp(scan_intern_string(&table, a), "abc") == 0 &&
+        strcmp(scan_intern_string(&table, b), "def") == 0 && c == d &&
+        strcmp(scan_intern_string(&table, c), "a_word_spanning_many_refills") == 0) {
+        printf("PASS (\"abc\" \"def\", long word %u twice)\n", c);
+    } else {
+        printf("FAIL (count %d)\n", count);
+    }
+    scanner_destroy(&sc);
+    fclose(stream);
+
+    // Generated parser against the interpreter
+    const char *pair = "key_name:value_1 rest";
+    scanner gen;
+    scanner_init_memory(&gen, pair, strlen(pair));
+    scanner_set_intern(&gen, &table);
+    scanner_init_memory(&sc, pair, strlen(pair));
+    scanner_set_intern(&sc, &table);
+    unsigned int gen_ids[2], int_ids[2];
+    int gen_count = scan_symbol_pair(&gen, &gen_ids[0], &gen_ids[1]);
+    count = scanner_scanf(&sc, "%31W:%W", &int_ids[0], &int_ids[1]);
+    if (gen_count == 2 && count == 2 && gen_ids[0] == int_ids[0] && gen_ids[1] == int_ids[1] &&
+        scanner_offset(&gen) == scanner_offset(&sc)) {
+        printf("PASS (generated and interpreted IDs %u %u)\n", gen_ids[0], gen_ids[1]);
+    } else {
+        printf("FAIL (generated %d, interpreted %d)\n", gen_count, count);
+    }
+    scan_intern_destroy(&table);
+
+    // Without a table %W fails without consuming the word
+    unsigned int id = 77;
+    scanner_init_memory(&sc, "  word", 6);
+    count = scanner_scanf(&sc, "%W", &id);
+    scan_push ps;
+    int push_refused = scan_push_init(&ps, "%W", &id) == -1;
+    if (count == 0 && id == 77 && scanner_offset(&sc) == 2 && push_refused) {
+        printf("PASS (no table: nothing read, push scanner refuses %%W)\n");
+    } else {
+        printf("FAIL (count %d, offset %zu)\n", count, scanner_offset(&sc));
+    }
+    printf("\n");
+}
+
+void test_suppress() {
+    printf("Testing %%* assignment suppression\n");
+
+    // Every suppressed conversion must stop exactly where the real one does,
+    // succeed or fail alike, and leave errno alone
+    const char *specs[][2] = {
+        {"%*d", "%d"}, {"%*u", "%u"}, {"%*x", "%x"}, {"%*b", "%b"}, {"%*r", "%r"},
+        {"%*f", "%f"}, {"%*s", "%s"}, {"%*3s", "%3s"}, {"%*w", "%w"}, {"%*c", "%c"},
+        {"%*3c", "%3c"}, {"%*[a-z]", "%[a-z]"}, {"%*N", "%N"}, {"%*lld", "%lld"}, {"%*Lf", "%Lf"}
+    };
+    const char *inputs[] = {
+        "12345", "  -0017x", "+", "-x", "99999999999999999999999 ", "0x1Fg", "0X", "0b1012",
+        "0b", "0", "0q", "MCMXCIV!", "ivx", "3.25e-7,", "1e", "1e+", ".5", ".", "-.e1", "0x1.8p3",
+        "0x.p1", "inf", "infinity", "infinit", "nan(", "NaN", "1e99999", "abc_def ghi", "hello, world",
+        "\t\n", "", "x", "1234567890123456789012345678901234567890.5e3 tail", "0b1111111111111111111111111111111111111111111111111111111111111111111"
+    };
+    int specs_count = (int)(sizeof(specs) / sizeof(specs[0]));
+    int inputs_count = (int)(sizeof(inputs) / sizeof(inputs[0]));
+    int agree = 0;
+    int total = 0;
+    for (int s = 0; s < specs_count; s++) {
+        scan_program *skip = scan_compile(specs[s][0]);
+        scan_program *convert = scan_compile(specs[s][1]);
+        for (int k = 0; k < inputs_count; k++) {
+            for (int over_file = 0; over_file < 2; over_file++) {
+                size_t len = strlen(inputs[k]);
+                scanner a;
+                scanner b;
+                FILE *fa = NULL;
+                FILE *fb = NULL;
+                if (over_file) {
+                    fa = fmemopen((void *)inputs[k], len > 0 ? len : 1, "r");
+                    fb = fmemopen((void *)inputs[k], len > 0 ? len : 1, "r");
+                    scanner_init_file(&a, fa, 4);
+                    scanner_init_file(&b, fb, 4);
+                } else {
+                    scanner_init_memory(&a, inputs[k], len);
+                    scanner_init_memory(&b, inputs[k], len);
+                }
+
+                // Run the single op directly to see whether it succeeded
+                char sink[256];
+                errno = 0;
+                int skipped = scan_exec_op(&a, skip, &skip->ops[0], NULL);
+                int skip_errno = errno;
+                int converted = scan_exec_op(&b, convert, &convert->ops[0], sink);
+                if (skipped == converted && skip_errno == 0 &&
+                    scanner_offset(&a) == scanner_offset(&b)) {
+                    agree++;
+                } else if (total - agree < 5) {
+                    printf("  %s on \"%s\"%s: %d at %zu, %s gives %d at %zu\n", specs[s][0],
+                           inputs[k], over_file ? " (file)" : "", skipped, scanner_offset(&a),
+                           specs[s][1], converted, scanner_offset(&b));
+                }
+                total++;
+                if (over_file) {
+                    scanner_destroy(&a);
+                    scanner_destroy(&b);
+                    fclose(fa);
+                    fclose(fb);
+                }
+            }
+        }
+        scan_program_free(skip);
+        scan_program_free(convert);
+    }
+    if (agree == total) {
+        printf("PASS (%d skip paths stop where their conversions do)\n", total);
+    } else {
+        printf("FAIL (%d of %d disagree)\n", total - agree, total);
+    }
+
+    // Suppressed fields take no argument and do not count
+    int id = 0;
+    double value = 0;
+    char name[16] = "";
+    int count = my_sscanf("17,2.5,skip me,42,MMXXIV,9.75 zed", "%*d,%*f,%*[^,],%d,%*r,%lf %15s",
+                          &id, &value, name);
+    if (count == 3 && id == 42 && value == 9.75 && strcmp(name, "zed") == 0) {
+        printf("PASS (3 of 6 fields assigned: %d %.2f %s)\n", id, value, name);
+    } else {
+        printf("FAIL (count %d)\n", count);
+    }
+
+    // A suppressed mismatch still stops the scan
+    id = -1;
+    count = my_sscanf("x 5", "%*d %d", &id);
+    if (count == 0 && id == -1) {
+        printf("PASS (failed %%*d stops the scan)\n");
+    } else {
+        printf("FAIL (count %d, id %d)\n", count, id);
+    }
+
+    // Batch columns and push records only see the kept fields
+    const char *rows = "1,a,1.5,x\n2,b,2.5,y\n3,c,3.5,z\n";
+    int ids[3];
+    double values[3];
+    scan_column columns[] = {{ids, sizeof(int)}, {values, sizeof(double)}};
+    scanner sc;
+    scanner_init_memory(&sc, rows, strlen(rows));
+    size_t error_offset;
+    size_t loaded = scanner_batch(&sc, "%d,%*w,%lf,%*c\n", columns, 3, &error_offset);
+    scan_push ps;
+    int push_id = 0;
+    double push_value = 0;
+    int records = 0;
+    double push_sum = 0;
+    scan_push_init(&ps, "%d,%*w,%lf,%*c\n", &push_id, &push_value);
+    for (size_t i = 0; rows[i] != '\0'; i++) {
+        scan_push_feed(&ps, rows + i, 1);
+        while (scan_push_next(&ps) == SCAN_PUSH_RECORD) {
+            records++;
+            push_sum += push_id + push_value;
+        }
+    }
+    scan_push_destroy(&ps);
+    if (loaded == 3 && ids[2] == 3 && values[1] == 2.5 && records == 3 && push_sum == 13.5) {
+        printf("PASS (batch %zu rows, push %d records)\n", loaded, records);
+    } else {
+        printf("FAIL (batch %zu rows, push %d records, sum %.1f)\n", loaded, records, push_sum);
+    }
+    printf("\n");
+}
+
+void test_lines() {
+    printf("Testing the line-record iterator\n");
+
+    // The newline kernels agree with memchr at every level, length and position
+    char buf[200];
+    int kernel_errors = 0;
+    for (int level = SCAN_SIMD_SCALAR; level <= SCAN_SIMD_AVX2; level++) {
+        scan_simd_force((enum scan_simd_level)level);
+        for (int len = 0; len <= 160; len++) {
+            for (int at = -1; at < len; at++) {
+                memset(buf, 'a', sizeof(buf));
+                buf[len] = '\n'; // Just past the end, must not be found
+                if (at >= 0) {
+                    buf[at] = '\n';
+                    buf[at + 1 + (at + 1 < len) * ((len - at) / 2)] = '\n';
+                }
+                const char *want = memchr(buf, '\n', (size_t)len);
+                if (find_newline(buf, buf + len) != (want != NULL ? want : buf + len)) {
+                    kernel_errors++;
+                }
+            }
+        }
+    }
+    scan_simd_force(SCAN_SIMD_AVX2);
+    if (kernel_errors == 0) {
+        printf("PASS (find_newline matches memchr at every level)\n");
+    } else {
+        printf("FAIL (%d find_newline mismatches)\n", kernel_errors);
+    }
+
+    // lzbop.txt through a 16-byte buffer, so most lines grow it: every line
+    // gets the verdict my_sscanf gives that line on its own
+    FILE *fp = fopen("lzbop.txt", "r");
+    scanner sc;
+    scanner_init_file(&sc, fp, 16);
+    int value = 0;
+    scan_lines it;
+    scan_lines_init(&it, &sc, "%d", &value);
+    char text[4096];
+    size_t text_len = 0;
+    int disagree = 0;
+    enum scan_line_status status;
+    while ((status = scan_lines_next(&it)) != SCAN_LINE_END && status != SCAN_LINE_ERROR) {
+        char line[1024];
+        memcpy(line, it.line, it.len);
+        line[it.len] = '\0';
+        int expect = 0;
+        scanner one;
+        scanner_init_memory(&one, line, it.len);
+        int converted = (scanner_scanf(&one, "%d", &expect) == 1);
+        int ok = converted && find_non_whitespace(one.cur, one.end) == one.end;
+        if (ok != (status == SCAN_LINE_OK) || (converted && expect != value) ||
+            it.fields != converted) {
+            disagree++;
+        }
+    }
+    size_t file_accepted = it.accepted;
+    size_t file_rejected = it.rejected;
+    size_t file_lines = it.number;
+    scan_lines_destroy(&it);
+    scanner_destroy(&sc);
+    rewind(fp);
+    text_len = fread(text, 1, sizeof(text), fp);
+    fclose(fp);
+
+    scanner_init_memory(&sc, text, text_len);
+    scan_lines_init(&it, &sc, "%d", &value);
+    while (scan_lines_next(&it) != SCAN_LINE_END) {
+    }
+    if (status == SCAN_LINE_END && disagree == 0 && file_accepted + file_rejected > 10 &&
+        it.accepted == file_accepted && it.rejected == file_rejected && it.number == file_lines) {
+        printf("PASS (lzbop.txt: %zu lines, %zu accepted, %zu rejected)\n", file_lines,
+               file_accepted, file_rejected);
+    } else {
+        printf("FAIL (%d disagree, file %zu/%zu, memory %zu/%zu)\n", disagree, file_accepted,
+               file_rejected, it.accepted, it.rejected);
+    }
+    scan_lines_destroy(&it);
+
+    // Bad rows are counted and skipped, blank lines ignored, and the last
+    // line needs no newline
+    const char *rows = "1,2.5\n2,oops\n\n3,4.5\r\nPSYCH!\n4,5.5";
+    int id = 0;
+    double amount = 0;
+    scanner_init_memory(&sc, rows, strlen(rows));
+    scan_lines_init(&it, &sc, "%d,%lf", &id, &amount);
+    int id_sum = 0;
+    double amount_sum = 0;
+    size_t bad_lines[4] = {0};
+    int bad_fields[4] = {0};
+    int bad = 0;
+    while ((status = scan_lines_next(&it)) != SCAN_LINE_END) {
+        if (status == SCAN_LINE_OK) {
+            id_sum += id;
+            amount_sum += amount;
+        } else if (bad < 4) {
+            bad_lines[bad] = it.number;
+            bad_fields[bad++] = it.fields;
+        }
+    }
+    if (it.accepted == 3 && it.rejected == 2 && id_sum == 8 && amount_sum == 12.5 &&
+        bad_lines[0] == 2 && bad_fields[0] == 1 && bad_lines[1] == 5 && bad_fields[1] == 0 &&
+        it.number == 6) {
+        printf("PASS (3 accepted, rejected lines %zu and %zu)\n", bad_lines[0], bad_lines[1]);
+    } else {
+        printf("FAIL (%zu accepted, %zu rejected, sums %d %.1f)\n", it.accepted, it.rejected,
+               id_sum, amount_sum);
+    }
+    scan_lines_destroy(&it);
+
+    // A short line cannot borrow fields from the next one
+    int a = 0;
+    int b = 0;
+    scanner_init_memory(&sc, "1\n2 3\n", 6);
+    scan_lines_init(&it, &sc, "%d %d", &a, &b);
+    enum scan_line_status first = scan_lines_next(&it);
+    int first_fields = it.fields;
+    enum scan_line_status second = scan_lines_next(&it);
+    if (first == SCAN_LINE_REJECTED && first_fields == 1 && second == SCAN_LINE_OK && a == 2 &&
+        b == 3 && scan_lines_next(&it) == SCAN_LINE_END) {
+        printf("PASS (\"1\" is rejected, \"2 3\" still reads 2 and 3)\n");
+    } else {
+        printf("FAIL (%d then %d: %d %d)\n", first, second, a, b);
+    }
+    scan_lines_destroy(&it);
+
+    // Text after the last field makes the line a reject, fields still counted
+    scanner_init_memory(&sc, "1 2 junk\n3 4 \n", 15);
+    scan_lines_init(&it, &sc, "%d %d", &a, &b);
+    enum scan_line_status trailing = scan_lines_next(&it);
+    int trailing_fields = it.fields;
+    enum scan_line_status clean = scan_lines_next(&it);
+    if (trailing == SCAN_LINE_REJECTED && trailing_fields == 2 && clean == SCAN_LINE_OK &&
+        a == 3 && b == 4 && it.accepted == 1 && it.rejected == 1) {
+        printf("PASS (\"1 2 junk\" is rejected with 2 fields, \"3 4 \" accepted)\n");
+    } else {
+        printf("FAIL (trailing text: %d with %d fields, then %d)\n", trailing, trailing_fields,
+               clean);
+    }
+    scan_lines_destroy(&it);
+    printf("\n");
+}
+
+typedef struct pipe_writer {
+    int fd;
+    const char *text;
+    size_t len;
+} pipe_writer;
+
+// Writes the text in uneven pieces, then closes the pipe
+void *write_pipe_pieces(void *arg) {
+    pipe_writer *writer = arg;
+    size_t pos = 0;
+    size_t piece = 1;
+    while (pos < writer->len) {
+        size_t n = (piece < writer->len - pos) ? piece : writer->len - pos;
+        ssize_t put = write(writer->fd, writer->text + pos, n);
+        if (put <= 0) {
+            break;
+        }
+        pos += (size_t)put;
+        piece = piece * 7 % 997 + 1;
+    }
+    close(writer->fd);
+    return NULL;
+}
+
+void test_readahead() {
+    printf("Testing background read-ahead\n");
+
+    enum { LINES = 100000 };
+    char *text = malloc((size_t)LINES * 24);
+    size_t len = 0;
+    long long expected = 0;
+    for (int i = 0; i < LINES; i++) {
+        len += (size_t)sprintf(text + len, "%d,%x\n", i, (unsigned)i * 2654435761u);
+        expected += i + ((unsigned)i * 2654435761u & 0xFF);
+    }
+
+    // A regular file, from the defaults down to chunks smaller than a line
+    FILE *file = tmpfile();
+    fwrite(text, 1, len, file);
+    fflush(file);
+    int fd = fileno(file);
+    const size_t chunk_sizes[] = {0, 4096, 61, 7};
+    const int chunk_counts[] = {0, 2, 3, 2};
+    int ok = 1;
+    for (int k = 0; k < 4; k++) {
+        lseek(fd, 0, SEEK_SET);
+        scanner sc;
+        if (scanner_init_readahead(&sc, fd, chunk_sizes[k], chunk_counts[k]) != 0) {
+            ok = 0;
+            break;
+        }
+        int a;
+        unsigned int b;
+        int count = 0;
+        long long sum = 0;
+        while (scanner_scanf(&sc, "%d,%x", &a, &b) == 2) {
+            sum += a + (b & 0xFF);
+            count++;
+        }
+        if (count != LINES || sum != expected || scanner_offset(&sc) != len) {
+            printf("  chunks of %zu: %d lines, offset %zu\n", chunk_sizes[k], count,
+                   scanner_offset(&sc));
+            ok = 0;
+        }
+        scanner_destroy(&sc);
+    }
+    if (ok) {
+        printf("PASS (%d lines from a file with 4 chunk sizes)\n", LINES);
+    } else {
+        printf("FAIL (read-ahead file scan)\n");
+    }
+
+    // A pipe fed in uneven pieces by another thread
+    int fds[2];
+    ok = 0;
+    if (pipe(fds) == 0) {
+        pipe_writer writer = {fds[1], text, len};
+        pthread_t thread;
+        pthread_create(&thread, NULL, write_pipe_pieces, &writer);
+        scanner sc;
+        scanner_init_readahead(&sc, fds[0], 512, 3);
+        int a;
+        unsigned int b;
+        int count = 0;
+        long long sum = 0;
+        while (scanner_scanf(&sc, "%d,%x", &a, &b) == 2) {
+            sum += a + (b & 0xFF);
+            count++;
+        }
+        scanner_destroy(&sc);
+        pthread_join(thread, NULL);
+        close(fds[0]);
+        ok = (count == LINES && sum == expected);
+    }
+    if (ok) {
+        printf("PASS (%d lines from a pipe written in uneven pieces)\n", LINES);
+    } else {
+        printf("FAIL (read-ahead pipe scan)\n");
+    }
+
+    // A token far longer than a chunk grows the scanner's buffer
+    FILE *long_file = tmpfile();
+    for (int i = 0; i < 5000; i++) {
+        fputc('a' + i % 26, long_file);
+    }
+    fputs(" 42\n", long_file);
+    fflush(long_file);
+    lseek(fileno(long_file), 0, SEEK_SET);
+    scanner sc;
+    scanner_init_readahead(&sc, fileno(long_file), 64, 2);
+    char *token = NULL;
+    int tail = 0;
+    int got = scanner_scanf(&sc, "%ms %d", &token, &tail);
+    scanner_destroy(&sc);
+    fclose(long_file);
+    if (got == 2 && token != NULL && strlen(token) == 5000 && token[4999] == 'a' + 4999 % 26 &&
+        tail == 42) {
+        printf("PASS (5000-byte token through 64-byte chunks)\n");
+    } else {
+        printf("FAIL (long token: %d)\n", got);
+    }
+    free(token);
+
+    // Stopping early: the reader may be waiting for a free chunk or blocked
+    // in read() on a pipe that stays silent
+    lseek(fd, 0, SEEK_SET);
+    scanner_init_readahead(&sc, fd, 4096, 2);
+    int first = -1;
+    int early = scanner_scanf(&sc, "%d", &first);
+    scanner_destroy(&sc);
+    ok = (early == 1 && first == 0);
+    if (pipe(fds) == 0) {
+        scanner_init_readahead(&sc, fds[0], 0, 0);
+        scanner_destroy(&sc);
+        close(fds[0]);
+        close(fds[1]);
+    }
+    if (ok) {
+        printf("PASS (destroy stops a waiting and a blocked reader)\n");
+    } else {
+        printf("FAIL (early stop read %d)\n", first);
+    }
+    fclose(file);
+    free(text);
+    printf("\n");
+}
+
+void test_index() {
+    printf("Testing the record-offset index\n");
+
+    // Records "n,recn", with blank lines and leading spaces mixed in
+    enum { RECORDS = 10000, STRIDE = 64 };
+    char path[] = "/tmp/scan_index_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        printf("FAIL (could not create a temporary file)\n\n");
+        return;
+    }
+    FILE *file = fdopen(fd, "w+");
+    for (int i = 0; i < RECORDS; i++) {
+        fprintf(file, "%s%s%d,rec%d\n", (i % 13 == 5) ? "\n \n" : "", (i % 17 == 3) ? "   " : "",
+                i, i);
+    }
+    fflush(file);
+    char index_path[64];
+    snprintf(index_path, sizeof(index_path), "%s.idx", path);
+
+    scan_index index;
+    int built = scan_index_open(&index, path, NULL, STRIDE);
+    if (built == 1 && index.records == RECORDS && index.entries == (RECORDS + STRIDE - 1) / STRIDE) {
+        printf("PASS (indexed %zu records in %zu entries)\n", index.records, index.entries);
+    } else {
+        printf("FAIL (open returned %d, %zu records)\n", built, index.records);
+    }
+
+    // Random records through a mapped, a descriptor and a FILE scanner
+    int wrong = 0;
+    for (int kind = 0; kind < 3; kind++) {
+        scanner sc;
+        if (kind == 0) {
+            scanner_map_file(&sc, path);
+        } else if (kind == 1) {
+            scanner_init_fd(&sc, fd, 64);
+        } else {
+            scanner_init_file(&sc, file, 64);
+        }
+        unsigned long long seed = 99;
+        for (int k = 0; k < 300; k++) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            size_t record = (k == 0) ? 0 : (k == 1) ? RECORDS - 1 : (size_t)(seed >> 33) % RECORDS;
+            int a = -1;
+            int b = -1;
+            if (scan_index_seek(&index, &sc, record) != 0 ||
+                scanner_scanf(&sc, "%d,rec%d", &a, &b) != 2 || a != (int)record || b != a) {
+                wrong++;
+            }
+        }
+        if (scan_index_seek(&index, &sc, RECORDS) == 0) {
+            wrong++;
+        }
+        scanner_destroy(&sc);
+    }
+    if (wrong == 0) {
+        printf("PASS (900 random seeks land on their records)\n");
+    } else {
+        printf("FAIL (%d seeks went wrong)\n", wrong);
+    }
+    scan_index_destroy(&index);
+
+    // A second run reuses the saved index
+    int reused = scan_index_open(&index, path, NULL, STRIDE);
+    size_t records = index.records;
+    scan_index_destroy(&index);
+
+    // An edit that keeps the size and mtime is caught by the check hash
+    struct stat st;
+    fstat(fd, &st);
+    pwrite(fd, "9", 1, 0);
+    struct timespec times[2] = {st.st_atim, st.st_mtim};
+    futimens(fd, times);
+    int stale_open = scan_index_open(&index, path, NULL, STRIDE);
+    scanner sc;
+    scanner_map_file(&sc, path);
+    int stale_seek = scan_index_seek(&index, &sc, 0);
+    int other_seek = scan_index_seek(&index, &sc, STRIDE);
+    scanner_destroy(&sc);
+    scan_index_destroy(&index);
+
+    // Appending changes the size, and a damaged index file is rebuilt
+    pwrite(fd, "0", 1, 0);
+    fseek(file, 0, SEEK_END);
+    fprintf(file, "%d,rec%d\n", RECORDS, RECORDS);
+    fflush(file);
+    int grown = scan_index_open(&index, path, NULL, STRIDE);
+    size_t grown_records = index.records;
+    scan_index_destroy(&index);
+    FILE *damage = fopen(index_path, "r+b");
+    fseek(damage, -3, SEEK_END);
+    fputc('X', damage);
+    fclose(damage);
+    int repaired = scan_index_open(&index, path, NULL, STRIDE);
+    scan_index_destroy(&index);
+
+    if (reused == 0 && records == RECORDS && stale_open == 0 && stale_seek == -1 &&
+        other_seek == 0 && grown == 1 && grown_records == RECORDS + 1 && repaired == 1) {
+        printf("PASS (reused when unchanged, rebuilt after growth or damage, edits caught on seek)\n");
+    } else {
+        printf("FAIL (reused %d, stale %d/%d/%d, grown %d with %zu, repaired %d)\n", reused,
+               stale_open, stale_seek, other_seek, grown, grown_records, repaired);
+    }
+
+    fclose(file);
+    remove(path);
+    remove(index_path);
+    printf("\n");
+}
+
+// %{ipv4}: a dotted quad, stored as a uint32_t in host order
+int convert_ipv4(scanner *sc, const scan_program *prog, const scan_op *op, void *dst) {
+    (void)prog;
+    (void)op;
+    uint32_t addr = 0;
+    for (int part = 0; part < 4; part++) {
+        if (part > 0 && scanner_getc(sc) != '.') {
+            return 0;
+        }
+        unsigned int octet = 0;
+        int digits = 0;
+        while (digits < 3 && is_digit(scanner_peek(sc))) {
+            octet = octet * 10 + (unsigned int)(scanner_getc(sc) - '0');
+            digits++;
+        }
+        if (digits == 0 || octet > 255) {
+            return 0;
+        }
+        addr = (addr << 8) | octet;
+    }
+    *(uint32_t *)dst = addr;
+    return 1;
+}
+
+size_t ipv4_batch_calls = 0;
+
+// Bulk form of %{ipv4}: a failed field is rolled back to its first byte
+size_t batch_ipv4(scanner *sc, const scan_op *op, char *dst, size_t stride, size_t rows) {
+    ipv4_batch_calls++;
+    for (size_t r = 0; r < rows; r++) {
+        skip_whitespace(sc);
+        scanner_checkpoint cp = scanner_mark(sc);
+        if (!convert_ipv4(sc, NULL, op, dst + r * stride)) {
+            scanner_rollback(sc, cp);
+            return r;
+        }
+        scanner_commit(sc, cp);
+    }
+    return rows;
+}
+
+// %q: a double-quoted string without its quotes, at most width - 1 bytes
+// kept (the rest is read and dropped), for a char buffer of width bytes
+int convert_quoted(scanner *sc, const scan_program *prog, const scan_op *op, void *dst) {
+    (void)prog;
+    if (scanner_getc(sc) != '"') {
+        return 0;
+    }
+    char *out = dst;
+    size_t len = 0;
+    int c;
+    while ((c = scanner_getc(sc)) != '"') {
+        if (c == EOF) {
+            return 0;
+        }
+        if (out != NULL && len + 1 < op->width) {
+            out[len++] = (char)c;
+        }
+    }
+    if (out != NULL) {
+        out[len] = '\0';
+    }
+    return 1;
+}
+
+int skip_quoted(scanner *sc, const scan_program *prog, const scan_op *op) {
+    return convert_quoted(sc, prog, op, NULL);
+}
+
+void test_registry() {
+    printf("Testing registered conversions\n");
+
+    // Step 1: Register, and refuse what would clash with the format syntax
+    scan_converter ipv4 = {convert_ipv4, NULL, batch_ipv4, sizeof(uint32_t), 0};
+    scan_converter ipv4_rows = {convert_ipv4, NULL, NULL, sizeof(uint32_t), 0};
+    scan_converter quoted = {convert_quoted, skip_quoted, NULL, 1, SCAN_CONV_WIDTH};
+    scan_converter huge = {convert_ipv4, NULL, NULL, SCAN_CONV_SCRATCH + 1, 0};
+    int registered = scan_register_name("ipv4", &ipv4) == 0 &&
+                     scan_register_name("ipv4_rows", &ipv4_rows) == 0 &&
+                     scan_register('q', &quoted) == 0;
+    int refused = scan_register('d', &quoted) == -1 && scan_register('q', &quoted) == -1 &&
+                  scan_register('%', &quoted) == -1 && scan_register('l', &quoted) == -1 &&
+                  scan_register(0x80, &quoted) == -1 && scan_register_name("ipv4", &ipv4) == -1 &&
+                  scan_register_name("ip v4", &ipv4) == -1 && scan_register_name("", &ipv4) == -1 &&
+                  scan_register_name("big", &huge) == -1;
+    const scan_converter *d = scan_converter_for('d');
+    const scan_converter *q = scan_converter_for('q');
+    int table = d != NULL && (d->flags & SCAN_CONV_BUILTIN) && q != NULL &&
+                !(q->flags & SCAN_CONV_BUILTIN) && scan_converter_for('Q') == NULL;
+    if (registered && refused && table) {
+        printf("PASS (registered %%{ipv4} and %%q, clashes refused)\n");
+    } else {
+        printf("FAIL (registered %d, refused %d, table %d)\n", registered, refused, table);
+    }
+
+    // Step 2: Mixed with built-ins, suppressed, and with bad modifiers
+    uint32_t a = 0;
+    uint32_t b = 0;
+    char c = 0;
+    char text[8];
+    int n = 0;
+    int mixed = my_sscanf("10.0.0.1 x\t192.168.1.254", "%{ipv4} %c %{ipv4}", &a, &c, &b);
+    int quote = my_sscanf("  \"hello world\" 7", "%8q %d", text, &n);
+    int skipped = my_sscanf("1.2.3.4 \"a b\" 5", "%*{ipv4} %*q %d", &n);
+    int bad_octet = my_sscanf("10.0.300.1", "%{ipv4}", &a);
+    int unknown = my_sscanf("1.2.3.4", "%{ipv6}", &a) + my_sscanf("1.2.3.4", "%{ipv4", &a) +
+                  my_sscanf("1.2.3.4", "%5{ipv4}", &a) + my_sscanf("1.2.3.4", "%l{ipv4}", &a);
+    if (mixed == 3 && b == 0xC0A801FE && c == 'x' && quote == 2 && strcmp(text, "hello w") == 0 &&
+        skipped == 1 && n == 5 && bad_octet == 0 && unknown == 0) {
+        printf("PASS (mixed with built-ins, %%* and widths work, unknown names stop)\n");
+    } else {
+        printf("FAIL (mixed %d %08x '%c', quote %d \"%s\", skipped %d n %d, bad %d, unknown %d)\n",
+               mixed, (unsigned int)b, c, quote, text, skipped, n, bad_octet, unknown);
+    }
+
+    // Step 3: The bulk form must agree with row-by-row parsing, error offset included
+    enum { ROWS = 2000, BAD = 1500 };
+    char *input = malloc(ROWS * 20);
+    size_t len = 0;
+    size_t bad_offset = 0;
+    for (int i = 0; i < ROWS; i++) {
+        if (i == BAD) {
+            bad_offset = len;
+            len += (size_t)sprintf(input + len, "10.1.%d\n", i % 256);
+        } else {
+            len += (size_t)sprintf(input + len, "%d.%d.%d.%d\n", i % 223, i % 256, i / 256, i % 7);
+        }
+    }
+    uint32_t *bulk = calloc(ROWS, sizeof(uint32_t));
+    uint32_t *rows = calloc(ROWS, sizeof(uint32_t));
+    size_t bulk_error;
+    size_t rows_error;
+    scanner sa;
+    scanner sb;
+    scanner_init_memory(&sa, input, len);
+    scanner_init_memory(&sb, input, len);
+    scan_column bulk_column = {bulk, sizeof(uint32_t)};
+    scan_column rows_column = {rows, sizeof(uint32_t)};
+    size_t calls = ipv4_batch_calls;
+    size_t bulk_rows = scanner_batch(&sa, "%{ipv4}\n", &bulk_column, ROWS, &bulk_error);
+    size_t row_rows = scanner_batch(&sb, "%{ipv4_rows}\n", &rows_column, ROWS, &rows_error);
+    int used_bulk = (ipv4_batch_calls > calls) == !scan_stats_enabled();
+    scanner_init_memory(&sa, input, bad_offset);
+    size_t clean_error;
+    size_t clean_rows = scanner_batch(&sa, "%{ipv4}\n", &bulk_column, ROWS, &clean_error);
+    if (bulk_rows == BAD && row_rows == BAD && memcmp(bulk, rows, BAD * sizeof(uint32_t)) == 0 &&
+        rows[7] == ((7u << 24) | (7u << 16)) && bulk_error == bad_offset &&
+        rows_error == bad_offset && clean_rows == BAD && clean_error == SCAN_NO_ERROR && used_bulk) {
+        printf("PASS (bulk form matches %zu rows and stops at the same bad row)\n", bulk_rows);
+    } else {
+        printf("FAIL (bulk %zu at %zu, rows %zu at %zu, bad row at %zu, clean %zu, used bulk %d)\n",
+               bulk_rows, bulk_error, row_rows, rows_error, bad_offset, clean_rows, used_bulk);
+    }
+    free(input);
+    free(bulk);
+    free(rows);
+
+    // Step 4: Push scanning cannot tell where a registered token ends
+    scan_push ps;
+    int push = scan_push_init(&ps, "%{ipv4}", &a);
+    if (push == -1) {
+        printf("PASS (scan_push refuses registered conversions)\n");
+    } else {
+        printf("FAIL (scan_push accepted %%{ipv4})\n");
+        scan_push_destroy(&ps);
+    }
+    printf("\n");
+}
@@ -0,0 +1,2582 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "my_scanf.h"
+#include "scan_simd.h"
+#include "scan_stats.h"
+
+// Size of the per-call window my_scanf uses over stdin
+#define STREAM_LINE_BUFFER 4096
+
+// Number of compiled formats remembered per thread
+#define PROGRAM_CACHE_SIZE 16
+
+// Named conversions (%{ipv4}) take the table slots from here up
+#define FIRST_NAMED_CONVERSION 128
+
+// Longest conversion name, without the braces
+#define MAX_CONVERSION_NAME 31
+
+// Characters that cannot be registered as conversions: they are part of the
+// % syntax (suppression, widths, modifiers, names) or cannot appear in it
+#define RESERVED_SPECS "%*{}0123456789mhljztL"
+
+static const scan_program *lookup_program(const char *format);
+static int run_program(scanner *sc, const scan_program *prog, va_list *args,
+                       const scan_column *columns, size_t row, int *complete);
+static int exec_op(scanner *sc, const scan_program *prog, const scan_op *op, void *dst);
+static int run_op(scanner *sc, const scan_program *prog, const scan_op *op, void **dst);
+static int convert(scanner *sc, const scan_program *prog, const scan_op *op, void *dst);
+static int skip_field(scanner *sc, const scan_program *prog, const scan_op *op);
+static int parse_width(const char *p, unsigned int *width);
+static int parse_length(const char *p, unsigned char *length);
+static int parse_scanset(const char *p, scan_set *set);
+static int refill_keeping(scanner *sc, const char *keep);
+static int grow_buffer(scanner *sc);
+static void scanner_init_fd_buffer(scanner *sc, int fd, char *buf, size_t capacity);
+static size_t fill_byte_from_fd(void *source, char *dst, size_t n);
+static int length_allowed(unsigned char conv, unsigned char length);
+static int parse_name(const char *p, unsigned char *conv);
+static int converter_valid(const scan_converter *conv);
+#ifndef MY_SCANF_STATS
+static const scan_converter *bulk_converter(const scan_program *prog);
+#endif
+static void store_signed(void *dst, unsigned char length, long long value);
+static void store_unsigned(void *dst, unsigned char length, unsigned long long value);
+static int convert_char(scanner *sc, const scan_program *prog, const scan_op *op, void *dst);
+static int convert_signed(scanner *sc, const scan_program *prog, const scan_op *op, void *dst);
+static int convert_unsigned(scanner *sc, const scan_program *prog, const scan_op *op, void *dst);
+static int convert_string(scanner *sc, const scan_program *prog, const scan_op *op, void *dst);
+static int convert_float(scanner *sc, const scan_program *prog, const scan_op *op, void *dst);
+static int convert_hex(scanner *sc, const scan_program *prog, const scan_op *op, void *dst);
+static int convert_binary(scanner *sc, const scan_program *prog, const scan_op *op, void *dst);
+static int convert_roman(scanner *sc, const scan_program *prog, const scan_op *op, void *dst);
+static int convert_word(scanner *sc, const scan_program *prog, const scan_op *op, void *dst);
+static int convert_intern(scanner *sc, const scan_program *prog, const scan_op *op, void *dst);
+static int convert_view(scanner *sc, const scan_program *prog, const scan_op *op, void *dst);
+static int convert_number(scanner *sc, const scan_program *prog, const scan_op *op, void *dst);
+static int convert_scanset(scanner *sc, const scan_program *prog, const scan_op *op, void *dst);
+static int skip_char_field(scanner *sc, const scan_program *prog, const scan_op *op);
+static int skip_decimal_field(scanner *sc, const scan_program *prog, const scan_op *op);
+static int skip_string_field(scanner *sc, const scan_program *prog, const scan_op *op);
+static int skip_float_field(scanner *sc, const scan_program *prog, const scan_op *op);
+static int skip_hex_field(scanner *sc, const scan_program *prog, const scan_op *op);
+static int skip_binary_field(scanner *sc, const scan_program *prog, const scan_op *op);
+static int skip_roman_field(scanner *sc, const scan_program *prog, const scan_op *op);
+static int skip_word_field(scanner *sc, const scan_program *prog, const scan_op *op);
+static int skip_number_field(scanner *sc, const scan_program *prog, const scan_op *op);
+static int skip_scanset_field(scanner *sc, const scan_program *prog, const scan_op *op);
+
+// Flags shared by the built-in conversions
+#define CONV_BUILTIN (SCAN_CONV_BUILTIN | SCAN_CONV_SKIPS_WS)
+#define CONV_BUILTIN_LENGTH (CONV_BUILTIN | SCAN_CONV_LENGTH)
+
+// The conversion table, indexed by scan_op.conv. Built-ins fill their own
+// characters; scan_register and scan_register_name add the rest.
+static scan_converter converters[256] = {
+    ['c'] = {convert_char, skip_char_field, NULL, sizeof(char),
+             SCAN_CONV_BUILTIN | SCAN_CONV_KEEP_WS | SCAN_CONV_WIDTH},
+    ['d'] = {convert_signed, skip_decimal_field, NULL, sizeof(int), CONV_BUILTIN_LENGTH},
+    ['u'] = {convert_unsigned, skip_decimal_field, NULL, sizeof(unsigned int), CONV_BUILTIN_LENGTH},
+    ['s'] = {convert_string, skip_string_field, NULL, sizeof(char),
+             CONV_BUILTIN | SCAN_CONV_WIDTH | SCAN_CONV_ALLOC},
+    ['f'] = {convert_float, skip_float_field, NULL, sizeof(double), CONV_BUILTIN_LENGTH},
+    ['F'] = {convert_float, skip_float_field, NULL, sizeof(double), CONV_BUILTIN_LENGTH},
+    ['e'] = {convert_float, skip_float_field, NULL, sizeof(double), CONV_BUILTIN_LENGTH},
+    ['E'] = {convert_float, skip_float_field, NULL, sizeof(double), CONV_BUILTIN_LENGTH},
+    ['g'] = {convert_float, skip_float_field, NULL, sizeof(double), CONV_BUILTIN_LENGTH},
+    ['G'] = {convert_float, skip_float_field, NULL, sizeof(double), CONV_BUILTIN_LENGTH},
+    ['a'] = {convert_float, skip_float_field, NULL, sizeof(double), CONV_BUILTIN_LENGTH},
+    ['A'] = {convert_float, skip_float_field, NULL, sizeof(double), CONV_BUILTIN_LENGTH},
+    ['x'] = {convert_hex, skip_hex_field, NULL, sizeof(unsigned int), CONV_BUILTIN_LENGTH},
+    // Custom extensions
+    ['b'] = {convert_binary, skip_binary_field, NULL, sizeof(unsigned int), CONV_BUILTIN_LENGTH},
+    ['r'] = {convert_roman, skip_roman_field, NULL, sizeof(int), CONV_BUILTIN},
+    ['w'] = {convert_word, skip_word_field, NULL, sizeof(char),
+             CONV_BUILTIN | SCAN_CONV_WIDTH | SCAN_CONV_ALLOC},
+    ['W'] = {convert_intern, skip_word_field, NULL, sizeof(unsigned int), CONV_BUILTIN | SCAN_CONV_WIDTH},
+    ['v'] = {convert_view, skip_string_field, NULL, sizeof(scan_view), CONV_BUILTIN | SCAN_CONV_WIDTH},
+    ['N'] = {convert_number, skip_number_field, NULL, sizeof(scan_number), CONV_BUILTIN},
+    ['['] = {convert_scanset, skip_scanset_field, NULL, sizeof(char),
+             SCAN_CONV_BUILTIN | SCAN_CONV_KEEP_WS | SCAN_CONV_WIDTH | SCAN_CONV_ALLOC},
+};
+
+// Names of the slots from FIRST_NAMED_CONVERSION up, in registration order
+static char *conversion_names[256 - FIRST_NAMED_CONVERSION];
+static int named_conversions;
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int my_scanf(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int count = my_vfscanf(stdin, format, args);
+    va_end(args);
+    return count;
+}
+
+int my_fscanf(FILE *stream, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int count = my_vfscanf(stream, format, args);
+    va_end(args);
+    return count;
+}
+
+int my_sscanf(const char *str, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int count = my_vsscanf(str, format, args);
+    va_end(args);
+    return count;
+}
+
+int my_dscanf(int fd, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int count = my_vdscanf(fd, format, args);
+    va_end(args);
+    return count;
+}
+
+int my_vscanf(const char *format, va_list args) {
+    return my_vfscanf(stdin, format, args);
+}
+
+int my_vfscanf(FILE *stream, const char *format, va_list args) {
+    // Scan the stream through a stack window. The stream lock is taken once for
+    // the whole call instead of once per character, and whatever the window
+    // read past the last conversion is handed back to the stream afterwards so
+    // plain stdio calls can be mixed freely with my_fscanf.
+    char buf[STREAM_LINE_BUFFER];
+    scanner sc;
+    scanner_attach_stream(&sc, stream, buf, sizeof(buf));
+
+    flockfile(stream);
+    int count = scanner_vscanf(&sc, format, args);
+    scanner_sync(&sc);
+    funlockfile(stream);
+    if (sc.owns_buf) {
+        free(sc.buf); // A checkpoint (e.g. %ms) outgrew the stack window
+    }
+    return count;
+}
+
+// All-or-nothing my_scanf: returns the number of conversions if the whole
+// format matched, or 0 with stdin left exactly where it was
+int my_try_scanf(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int count = my_vtry_fscanf(stdin, format, args);
+    va_end(args);
+    return count;
+}
+
+int my_try_fscanf(FILE *stream, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int count = my_vtry_fscanf(stream, format, args);
+    va_end(args);
+    return count;
+}
+
+int my_vtry_fscanf(FILE *stream, const char *format, va_list args) {
+    char buf[STREAM_LINE_BUFFER];
+    scanner sc;
+    scanner_attach_stream(&sc, stream, buf, sizeof(buf));
+
+    flockfile(stream);
+    int count = scanner_vtry_scanf(&sc, format, args);
+    scanner_sync(&sc); // After a rollback this hands back everything read
+    funlockfile(stream);
+    if (sc.owns_buf) {
+        free(sc.buf);
+    }
+    return count;
+}
+
+int my_vsscanf(const char *str, const char *format, va_list args) {
+    scanner sc;
+    scanner_init_memory(&sc, str, strlen(str));
+    return scanner_vscanf(&sc, format, args);
+}
+
+int my_vdscanf(int fd, const char *format, va_list args) {
+    // A descriptor has no pushback, so bytes read past the last conversion can
+    // only be returned by seeking. Seekable files are read a window at a time
+    // and rewound afterwards; pipes and sockets are read a byte at a time, which
+    // leaves at most the one byte that ended the last field consumed. To scan a
+    // pipe or socket with many calls, keep a scanner_init_fd scanner instead.
+    char buf[STREAM_LINE_BUFFER];
+    scanner sc;
+    int saved_errno = errno;
+    int seekable = lseek(fd, 0, SEEK_CUR) >= 0;
+    errno = saved_errno;
+    scanner_init_fd_buffer(&sc, fd, buf, sizeof(buf));
+    if (!seekable) {
+        sc.fill = fill_byte_from_fd;
+    }
+
+    int count = scanner_vscanf(&sc, format, args);
+    scanner_sync(&sc);
+    if (sc.owns_buf) {
+        free(sc.buf);
+    }
+    return count;
+}
+
+// Scans from a memory or mapped-file scanner, leaving its cursor after the last
+// consumed byte. If consumed is not NULL it receives the bytes used by this call.
+int my_mscanf(scanner *sc, size_t *consumed, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+
+    const char *start = sc->cur;
+    int count = scanner_vscanf(sc, format, args);
+    if (consumed != NULL) {
+        *consumed = (size_t)(sc->cur - start);
+    }
+
+    va_end(args);
+    return count;
+}
+
+int scanner_scanf(scanner *sc, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int count = scanner_vscanf(sc, format, args);
+    va_end(args);
+    return count;
+}
+
+int scanner_vscanf(scanner *sc, const char *format, va_list args) {
+    const scan_program *prog = lookup_program(format);
+    if (prog == NULL) {
+        return 0; // Out of memory compiling the format
+    }
+    return scan_vexec(sc, prog, args);
+}
+
+int scanner_try_scanf(scanner *sc, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int count = scanner_vtry_scanf(sc, format, args);
+    va_end(args);
+    return count;
+}
+
+// Scans the whole format or nothing. On a mismatch the scanner is rolled back
+// to where the call started and 0 is returned, so another format can be tried
+// on the same bytes. Destinations of conversions that ran before the mismatch
+// may have been written.
+int scanner_vtry_scanf(scanner *sc, const char *format, va_list args) {
+    const scan_program *prog = lookup_program(format);
+    if (prog == NULL) {
+        return 0;
+    }
+
+    scanner_checkpoint cp = scanner_mark(sc);
+    va_list ap;
+    va_copy(ap, args);
+    int complete;
+    int count = run_program(sc, prog, &ap, NULL, 0, &complete);
+    va_end(ap);
+
+    if (!complete) {
+        scanner_rollback(sc, cp);
+        return 0;
+    }
+    scanner_commit(sc, cp);
+    return count;
+}
+
+// FORMAT PROGRAMS //
+
+// Cache of compiled formats, keyed by format pointer. On a pointer hit the
+// format text is still compared with the copy kept in the program, so a reused
+// buffer holding a different format, or a literal at an address reused after
+// dlclose, is caught. Each thread has its own cache, so lookups never take a
+// lock.
+typedef struct program_cache_entry {
+    const char *format;
+    scan_program *prog;
+} program_cache_entry;
+
+static _Thread_local program_cache_entry program_cache[PROGRAM_CACHE_SIZE];
+
+// Frees a thread's cached programs when the thread exits. The key's value is
+// the thread's cache, set the first time the thread compiles a format.
+static pthread_key_t program_cache_key;
+static pthread_once_t program_cache_once = PTHREAD_ONCE_INIT;
+
+static void free_program_cache(void *cache) {
+    program_cache_entry *entries = cache;
+    for (int i = 0; i < PROGRAM_CACHE_SIZE; i++) {
+        scan_program_free(entries[i].prog);
+        entries[i].prog = NULL;
+        entries[i].format = NULL;
+    }
+}
+
+static void create_program_cache_key(void) {
+    pthread_key_create(&program_cache_key, free_program_cache);
+}
+
+static const scan_program *lookup_program(const char *format) {
+    size_t slot = ((uintptr_t)format >> 3) % PROGRAM_CACHE_SIZE;
+    program_cache_entry *entry = &program_cache[slot];
+
+    if (entry->format == format && strcmp(entry->prog->format, format) == 0) {
+        return entry->prog; // Hit
+    }
+
+    // Miss: compile and replace whatever was in this slot
+    scan_program *prog = scan_compile(format);
+    if (prog == NULL) {
+        return NULL;
+    }
+    pthread_once(&program_cache_once, create_program_cache_key);
+    if (pthread_getspecific(program_cache_key) == NULL) {
+        pthread_setspecific(program_cache_key, program_cache);
+    }
+    scan_program_free(entry->prog);
+    entry->format = format;
+    entry->prog = prog;
+    return prog;
+}
+
+// Parses an optional decimal field width and returns how many characters it
+// used. Widths too large to matter are clamped.
+static int parse_width(const char *p, unsigned int *width) {
+    int n = 0;
+    *width = 0;
+    while (is_digit(p[n])) {
+        if (*width < UINT_MAX / 10) {
+            *width = *width * 10 + (unsigned int)(p[n] - '0');
+        }
+        n++;
+    }
+    return n;
+}
+
+// Parses an optional length modifier (hh, h, l, ll, j, z, t, L) and returns
+// how many characters it used
+static int parse_length(const char *p, unsigned char *length) {
+    switch (p[0]) {
+        case 'h':
+            if (p[1] == 'h') {
+                *length = SCAN_LEN_HH;
+                return 2;
+            }
+            *length = SCAN_LEN_H;
+            return 1;
+        case 'l':
+            if (p[1] == 'l') {
+                *length = SCAN_LEN_LL;
+                return 2;
+            }
+            *length = SCAN_LEN_L;
+            return 1;
+        case 'j': *length = SCAN_LEN_J; return 1;
+        case 'z': *length = SCAN_LEN_Z; return 1;
+        case 't': *length = SCAN_LEN_T; return 1;
+        case 'L': *length = SCAN_LEN_BIG_L; return 1;
+        default:
+            *length = SCAN_LEN_NONE;
+            return 0;
+    }
+}
+
+// Parses the body of a %[...] scanset, starting after the '['. A leading '^'
+// negates the set, a ']' right after "[" or "[^" is a member, and "a-z" is a
+// range unless the '-' is first or last. Returns how many characters were
+// used including the closing ']', or -1 if there is none.
+static int parse_scanset(const char *p, scan_set *set) {
+    int n = 0;
+    int negate = 0;
+    memset(set->bitmap, 0, sizeof(set->bitmap));
+
+    if (p[n] == '^') {
+        negate = 1;
+        n++;
+    }
+    int first = n;
+    while (p[n] != ']' || n == first) {
+        if (p[n] == '\0') {
+            return -1; // Unterminated set
+        }
+        unsigned char lo = (unsigned char)p[n];
+        unsigned char hi = lo;
+        if (p[n + 1] == '-' && p[n + 2] != ']' && p[n + 2] != '\0' &&
+            (unsigned char)p[n + 2] >= lo) {
+            hi = (unsigned char)p[n + 2];
+            n += 2;
+        }
+        for (int c = lo; c <= hi; c++) {
+            set->bitmap[c >> 3] |= (unsigned char)(1u << (c & 7));
+        }
+        n++;
+    }
+
+    if (negate) {
+        for (int k = 0; k < 32; k++) {
+            set->bitmap[k] = (unsigned char)~set->bitmap[k];
+        }
+    }
+    scan_set_prepare(set);
+    return n + 1;
+}
+
+// Which length modifiers each conversion understands. Registered conversions
+// take any of them if they ask for SCAN_CONV_LENGTH, and none otherwise.
+static int length_allowed(unsigned char conv, unsigned char length) {
+    switch (conv) {
+        case 'd':
+        case 'u':
+        case 'x':
+        case 'b':
+            return length != SCAN_LEN_BIG_L;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            return length == SCAN_LEN_NONE || length == SCAN_LEN_H ||
+                   length == SCAN_LEN_L || length == SCAN_LEN_BIG_L;
+        default:
+            return length == SCAN_LEN_NONE || (converters[conv].flags & SCAN_CONV_LENGTH);
+    }
+}
+
+// Parses the name of a %{name} conversion, after the '{', and returns how
+// many characters it used including the '}', or -1 if it is not registered
+static int parse_name(const char *p, unsigned char *conv) {
+    int n = 0;
+    while (p[n] != '}' && p[n] != '\0' && n <= MAX_CONVERSION_NAME) {
+        n++;
+    }
+    if (p[n] != '}') {
+        return -1;
+    }
+    int named = __atomic_load_n(&named_conversions, __ATOMIC_ACQUIRE);
+    for (int k = 0; k < named; k++) {
+        if (strncmp(conversion_names[k], p, (size_t)n) == 0 && conversion_names[k][n] == '\0') {
+            *conv = (unsigned char)(FIRST_NAMED_CONVERSION + k);
+            return n + 1;
+        }
+    }
+    return -1;
+}
+
+// Appends an op to the program being built, growing the op array as needed
+static scan_op *push_op(scan_op **ops, int *count, int *capacity) {
+    if (*count == *capacity) {
+        int new_capacity = *capacity * 2;
+        scan_op *grown = realloc(*ops, (size_t)new_capacity * sizeof(scan_op));
+        if (grown == NULL) {
+            return NULL;
+        }
+        *ops = grown;
+        *capacity = new_capacity;
+    }
+    scan_op *op = &(*ops)[(*count)++];
+    memset(op, 0, sizeof(*op));
+    return op;
+}
+
+// Turns a format string into an op array. Runs of literal characters become a
+// single LITERAL op, and whitespace directives are folded into the op that
+// follows them (or dropped when that op skips whitespace on its own anyway).
+scan_program *scan_compile(const char *format) {
+    size_t format_len = strlen(format);
+    int capacity = 8;
+    int count = 0;
+    scan_op *ops = malloc((size_t)capacity * sizeof(scan_op));
+    // Literal bytes never outnumber format bytes, so one pool of that size suffices
+    char *literals = malloc(format_len + 1);
+    if (ops == NULL || literals == NULL) {
+        free(ops);
+        free(literals);
+        return NULL;
+    }
+
+    scan_set *sets = NULL; // Compiled %[...] sets, referenced by index
+    int set_count = 0;
+    size_t lit_len = 0;  // Bytes used in the literal pool
+    int pending_ws = 0;  // Saw a whitespace directive not yet attached to an op
+    scan_op *literal = NULL; // Literal op that further characters can extend
+    int i = 0;
+
+    while (format[i] != '\0') {
+        if (is_whitespace(format[i])) {
+            pending_ws = 1;
+            literal = NULL;
+            i++;
+            continue;
+        }
+
+        char c = format[i];
+        int literal_skips_ws = pending_ws;
+        if (c == '%') {
+            char spec = format[i + 1];
+            if (spec == '%') {
+                // "%%" matches '%' after skipping whitespace, so it is a literal
+                // that always skips whitespace first
+                literal_skips_ws = 1;
+                i++;
+            } else {
+                scan_op *op = push_op(&ops, &count, &capacity);
+                if (op == NULL) {
+                    goto fail;
+                }
+                unsigned int width;
+                unsigned char length;
+                int j = i + 1;
+                int suppress = (format[j] == '*');
+                j += suppress;
+                int width_len = parse_width(format + j, &width);
+                j += width_len;
+                int alloc = (format[j] == 'm');
+                j += alloc;
+                j += parse_length(format + j, &length);
+                spec = format[j];
+                unsigned char conv = (unsigned char)spec;
+                int name_len = 0;
+                if (spec == '{') {
+                    name_len = parse_name(format + j + 1, &conv);
+                }
+                const scan_converter *entry = &converters[conv];
+                if (entry->convert == NULL || name_len < 0 || !length_allowed(conv, length) ||
+                    (alloc && !(entry->flags & SCAN_CONV_ALLOC)) ||
+                    (width_len > 0 && (width == 0 || !(entry->flags & SCAN_CONV_WIDTH)))) {
+                    // Unknown format specifier - execution stops here
+                    op->kind = SCAN_OP_STOP;
+                    break;
+                }
+                j += name_len;
+                if (spec == '[') {
+                    scan_set *grown = realloc(sets, (size_t)(set_count + 1) * sizeof(scan_set));
+                    if (grown == NULL) {
+                        goto fail;
+                    }
+                    sets = grown;
+                    int set_len = parse_scanset(format + j + 1, &sets[set_count]);
+                    if (set_len < 0) {
+                        op->kind = SCAN_OP_STOP; // No closing ']'
+                        break;
+                    }
+                    op->lit_off = (size_t)set_count++;
+                    j += set_len;
+                }
+                op->kind = suppress ? SCAN_OP_SKIP_FIELD : SCAN_OP_CONVERT;
+                op->conv = conv;
+                op->length = length;
+                op->width = width;
+                op->alloc = (unsigned char)alloc;
+                // Only %c and %[ read whitespace, and the built-ins skip it
+                // themselves; registered conversions get it skipped for them
+                if (entry->flags & SCAN_CONV_KEEP_WS) {
+                    op->skip_ws = (unsigned char)pending_ws;
+                } else {
+                    op->skip_ws = !(entry->flags & SCAN_CONV_SKIPS_WS);
+                }
+                pending_ws = 0;
+                literal = NULL;
+                i = j + 1;
+                continue;
+            }
+        }
+
+        // Literal character: extend the current run unless whitespace must be
+        // skipped in between
+        if (literal == NULL || literal_skips_ws) {
+            literal = push_op(&ops, &count, &capacity);
+            if (literal == NULL) {
+                goto fail;
+            }
+            literal->kind = SCAN_OP_LITERAL;
+            literal->skip_ws = (unsigned char)literal_skips_ws;
+            literal->lit_off = lit_len;
+        }
+        literals[lit_len++] = c;
+        literal->len++;
+        pending_ws = 0;
+        i++;
+    }
+
+    if (pending_ws) {
+        // Trailing whitespace still consumes whitespace from the input
+        scan_op *op = push_op(&ops, &count, &capacity);
+        if (op == NULL) {
+            goto fail;
+        }
+        op->kind = SCAN_OP_SKIP_WS;
+    }
+
+    // Pack everything into one allocation: header, ops, sets, literal pool, format copy
+    size_t ops_size = (size_t)count * sizeof(scan_op);
+    size_t sets_size = (size_t)set_count * sizeof(scan_set);
+    scan_program *prog = malloc(sizeof(scan_program) + ops_size + sets_size + lit_len + format_len + 1);
+    if (prog == NULL) {
+        goto fail;
+    }
+    prog->ops = (scan_op *)(prog + 1);
+    prog->count = count;
+    prog->sets = (scan_set *)((char *)prog->ops + ops_size);
+    if (set_count > 0) {
+        memcpy(prog->sets, sets, sets_size);
+    }
+    char *pool = (char *)prog->sets + sets_size;
+    memcpy(pool, literals, lit_len);
+    prog->literals = pool;
+    prog->format = pool + lit_len;
+    memcpy(prog->format, format, format_len + 1);
+    memcpy(prog->ops, ops, ops_size);
+
+    free(ops);
+    free(sets);
+    free(literals);
+    return prog;
+
+fail:
+    free(ops);
+    free(sets);
+    free(literals);
+    return NULL;
+}
+
+void scan_program_free(scan_program *prog) {
+    free(prog);
+}
+
+int scan_exec(scanner *sc, const scan_program *prog, ...) {
+    va_list args;
+    va_start(args, prog);
+    int count = scan_vexec(sc, prog, args);
+    va_end(args);
+    return count;
+}
+
+// Matches a literal run byte for byte. Like the original getc loop, a mismatching
+// byte is consumed; bytes before it are consumed as well.
+static int match_literal(scanner *sc, const char *lit, size_t len) {
+    if ((size_t)(sc->end - sc->cur) >= len) {
+        // Whole run is buffered: compare in one go
+        if (memcmp(sc->cur, lit, len) == 0) {
+            scanner_advance(sc, len);
+            return 1;
+        }
+        size_t k = 0;
+        while (sc->cur[k] == lit[k]) {
+            k++;
+        }
+        scanner_advance(sc, k + 1);
+        return 0;
+    }
+
+    for (size_t k = 0; k < len; k++) {
+        if (scanner_getc(sc) != (unsigned char)lit[k]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Runs a compiled format against a scanner. Returns the number of assignments.
+int scan_vexec(scanner *sc, const scan_program *prog, va_list args) {
+    // Work on a copy so it can be passed down by pointer
+    va_list ap;
+    va_copy(ap, args);
+    int count = run_program(sc, prog, &ap, NULL, 0, NULL);
+    va_end(ap);
+    return count;
+}
+
+// Parses up to rows records with a compiled format, storing conversion i of
+// row r at columns[i].base + r * columns[i].stride. Returns the number of
+// complete rows. *error_offset (if not NULL) is the offset of the first byte
+// of the first malformed row, or SCAN_NO_ERROR when parsing stopped at the
+// row limit or the end of input.
+size_t scan_batch(scanner *sc, const scan_program *prog, const scan_column *columns,
+                  size_t rows, size_t *error_offset) {
+    if (error_offset != NULL) {
+        *error_offset = SCAN_NO_ERROR;
+    }
+
+    // Whitespace the first op skips anyway is not counted as part of a row.
+    // Conversions that read it as data (%c, %[ and KEEP_WS ones) keep it.
+    const scan_op *first = (prog->count > 0) ? &prog->ops[0] : NULL;
+    int lead_ws = first != NULL && (first->skip_ws || first->kind == SCAN_OP_SKIP_WS ||
+                                    ((first->kind == SCAN_OP_CONVERT ||
+                                      first->kind == SCAN_OP_SKIP_FIELD) &&
+                                     !(converters[first->conv].flags & SCAN_CONV_KEEP_WS)));
+
+#ifndef MY_SCANF_STATS
+    // Rows of a single field go to the converter's bulk form when it has one
+    // (statistics builds run every op so that each one is counted)
+    const scan_converter *bulk = bulk_converter(prog);
+    if (bulk != NULL) {
+        size_t done = bulk->batch(sc, &prog->ops[0], columns[0].base, columns[0].stride, rows);
+        if (done < rows) {
+            if (scanner_peek(sc) != EOF && error_offset != NULL) {
+                *error_offset = scanner_offset(sc);
+            }
+        } else if (prog->count == 2) {
+            skip_whitespace(sc); // The last row's trailing whitespace
+        }
+        return done;
+    }
+#endif
+
+    for (size_t row = 0; row < rows; row++) {
+        if (lead_ws) {
+            skip_whitespace(sc);
+        }
+        size_t start = scanner_offset(sc);
+        int complete;
+        int count = run_program(sc, prog, NULL, columns, row, &complete);
+        if (complete) {
+            continue;
+        }
+
+        // Nothing assigned and nothing left is a clean end of input
+        if (!(count == 0 && scanner_peek(sc) == EOF) && error_offset != NULL) {
+            *error_offset = start;
+        }
+        return row;
+    }
+    return rows;
+}
+
+#ifndef MY_SCANF_STATS
+// The converter of a program that is one conversion (not suppressed),
+// optionally followed by trailing whitespace, if that converter has a bulk
+// form and does not read whitespace as data
+static const scan_converter *bulk_converter(const scan_program *prog) {
+    if (prog->count < 1 || prog->count > 2 || prog->ops[0].kind != SCAN_OP_CONVERT ||
+        (prog->count == 2 && prog->ops[1].kind != SCAN_OP_SKIP_WS)) {
+        return NULL;
+    }
+    const scan_converter *entry = &converters[prog->ops[0].conv];
+    return (entry->batch != NULL && !(entry->flags & SCAN_CONV_KEEP_WS)) ? entry : NULL;
+}
+#endif
+
+// Runs prog once, storing conversion i at columns[i].base + row * columns[i].stride.
+// Returns the number of conversions stored; *complete is set if every op matched.
+int scan_exec_row(scanner *sc, const scan_program *prog, const scan_column *columns, size_t row,
+                  int *complete) {
+    return run_program(sc, prog, NULL, columns, row, complete);
+}
+
+size_t scanner_batch(scanner *sc, const char *format, const scan_column *columns,
+                     size_t rows, size_t *error_offset) {
+    const scan_program *prog = lookup_program(format);
+    if (prog == NULL) {
+        if (error_offset != NULL) {
+            *error_offset = scanner_offset(sc);
+        }
+        return 0;
+    }
+    return scan_batch(sc, prog, columns, rows, error_offset);
+}
+
+#ifdef MY_SCANF_STATS
+// Statistics kind of a compiled op
+static enum scan_stat_kind op_stat_kind(const scan_op *op) {
+    if (op->kind == SCAN_OP_LITERAL) {
+        return SCAN_STAT_LITERAL;
+    }
+    if (op->kind == SCAN_OP_STOP) {
+        return SCAN_STAT_UNKNOWN;
+    }
+    switch (op->conv) {
+        case 'c': return SCAN_STAT_CHAR;
+        case 'd': return SCAN_STAT_INT;
+        case 'u': return SCAN_STAT_UNSIGNED;
+        case 's': return SCAN_STAT_STRING;
+        case 'x': return SCAN_STAT_HEX;
+        case 'b': return SCAN_STAT_BINARY;
+        case 'r': return SCAN_STAT_ROMAN;
+        case 'w': return SCAN_STAT_WORD;
+        case 'W': return SCAN_STAT_INTERN;
+        case 'v': return SCAN_STAT_VIEW;
+        case 'N': return SCAN_STAT_NUMBER;
+        case '[': return SCAN_STAT_SCANSET;
+        default:
+            // Floats, or a registered conversion
+            return (converters[op->conv].flags & SCAN_CONV_BUILTIN) ? SCAN_STAT_FLOAT
+                                                                     : SCAN_STAT_CUSTOM;
+    }
+}
+
+// Records one op. A failure with the buffer drained at EOF ran out of input;
+// this never refills, so it cannot block on a terminal.
+static void record_op_stats(const scanner *sc, const scan_op *op, int ok, size_t bytes,
+                            uint64_t cycles) {
+    if (op->kind == SCAN_OP_SKIP_WS) {
+        return; // Trailing whitespace is not worth a row of its own
+    }
+    enum scan_fail_reason reason = SCAN_FAIL_MISMATCH;
+    if (op->kind == SCAN_OP_STOP) {
+        reason = SCAN_FAIL_UNSUPPORTED;
+    } else if (sc->cur == sc->end && (sc->eof || sc->fill == NULL)) {
+        reason = SCAN_FAIL_EOF;
+    }
+    scan_stats_record(op_stat_kind(op), ok, reason, bytes, cycles);
+}
+#endif
+
+// Shared op loop. Destinations come from args, or from row `row` of columns
+// when args is NULL. *complete (if not NULL) is set when every op succeeded.
+static int run_program(scanner *sc, const scan_program *prog, va_list *args,
+                       const scan_column *columns, size_t row, int *complete) {
+    int count = 0; // Number of successful assignments
+
+    if (complete != NULL) {
+        *complete = 0;
+    }
+#ifdef MY_SCANF_STATS
+    scan_stats_scan_begin();
+#endif
+
+    for (int i = 0; i < prog->count; i++) {
+        const scan_op *op = &prog->ops[i];
+
+        // Every conversion stores through a pointer argument
+        void *dst = NULL;
+        if (op->kind == SCAN_OP_CONVERT) {
+            if (args != NULL) {
+                dst = va_arg(*args, void*);
+            } else {
+                dst = (char *)columns[count].base + row * columns[count].stride;
+            }
+        }
+
+        int ok = exec_op(sc, prog, op, dst);
+        if (!ok) {
+            return count; // Mismatch or unknown specifier - return early
+        }
+        count += (op->kind == SCAN_OP_CONVERT);
+    }
+
+    if (complete != NULL) {
+        *complete = 1;
+    }
+    return count;
+}
+
+// Runs one op, skipping whitespace first if the op asks for it, and records
+// it when statistics are compiled in. Returns 1 on success.
+static inline int exec_op(scanner *sc, const scan_program *prog, const scan_op *op, void *dst) {
+    if (op->skip_ws) {
+        skip_whitespace(sc);
+    }
+#ifdef MY_SCANF_STATS
+    uint64_t start_cycles = scan_stats_clock();
+    size_t start_offset = scanner_offset(sc);
+    int ok = run_op(sc, prog, op, &dst);
+    record_op_stats(sc, op, ok, scanner_offset(sc) - start_offset,
+                    scan_stats_clock() - start_cycles);
+    return ok;
+#else
+    return run_op(sc, prog, op, &dst);
+#endif
+}
+
+// Runs a single op of a compiled program, for callers that drive the op loop
+// themselves (scan_push.c, scan_lines.c). dst is the destination of a conversion.
+int scan_exec_op(scanner *sc, const scan_program *prog, const scan_op *op, void *dst) {
+    return exec_op(sc, prog, op, dst);
+}
+
+// Runs one op. Returns 1 on success.
+static inline int run_op(scanner *sc, const scan_program *prog, const scan_op *op, void **dst) {
+    switch (op->kind) {
+        case SCAN_OP_LITERAL:
+            return match_literal(sc, prog->literals + op->lit_off, op->len);
+        case SCAN_OP_SKIP_WS:
+            skip_whitespace(sc);
+            return 1;
+        case SCAN_OP_CONVERT:
+            return convert(sc, prog, op, *dst);
+        case SCAN_OP_SKIP_FIELD:
+            return skip_field(sc, prog, op);
+        default:
+            // Unknown format specifier - stop processing
+            // This handles cases like %p, %n, %o, etc. that we haven't implemented
+            return 0;
+    }
+}
+
+// Stores a converted integer through dst, narrowed to the type named by the
+// length modifier (as a cast, like glibc)
+static void store_signed(void *dst, unsigned char length, long long value) {
+    switch (length) {
+        case SCAN_LEN_HH: *(signed char*)dst = (signed char)value; break;
+        case SCAN_LEN_H:  *(short*)dst = (short)value; break;
+        case SCAN_LEN_L:  *(long*)dst = (long)value; break;
+        case SCAN_LEN_LL: *(long long*)dst = value; break;
+        case SCAN_LEN_J:  *(intmax_t*)dst = (intmax_t)value; break;
+        case SCAN_LEN_Z:  *(ssize_t*)dst = (ssize_t)value; break;
+        case SCAN_LEN_T:  *(ptrdiff_t*)dst = (ptrdiff_t)value; break;
+        default:          *(int*)dst = (int)value; break;
+    }
+}
+
+static void store_unsigned(void *dst, unsigned char length, unsigned long long value) {
+    switch (length) {
+        case SCAN_LEN_HH: *(unsigned char*)dst = (unsigned char)value; break;
+        case SCAN_LEN_H:  *(unsigned short*)dst = (unsigned short)value; break;
+        case SCAN_LEN_L:  *(unsigned long*)dst = (unsigned long)value; break;
+        case SCAN_LEN_LL: *(unsigned long long*)dst = value; break;
+        case SCAN_LEN_J:  *(uintmax_t*)dst = (uintmax_t)value; break;
+        case SCAN_LEN_Z:  *(size_t*)dst = (size_t)value; break;
+        case SCAN_LEN_T:  *(ptrdiff_t*)dst = (ptrdiff_t)value; break;
+        default:          *(unsigned int*)dst = (unsigned int)value; break;
+    }
+}
+
+// Performs one conversion, storing through dst. Returns 1 on success.
+static inline int convert(scanner *sc, const scan_program *prog, const scan_op *op, void *dst) {
+    return converters[op->conv].convert(sc, prog, op, dst);
+}
+
+// CONVERSION TABLE //
+
+// Registers a conversion under a single character, e.g. 'q' for %q. The
+// character must be printable ASCII, not already taken (built-ins cannot be
+// replaced) and not part of the % syntax. Returns 0, or -1 if it cannot be used.
+int scan_register(int spec, const scan_converter *conv) {
+    if (spec <= ' ' || spec >= 127 || strchr(RESERVED_SPECS, spec) != NULL ||
+        !converter_valid(conv)) {
+        return -1;
+    }
+    pthread_mutex_lock(&registry_lock);
+    int ok = (converters[spec].convert == NULL);
+    if (ok) {
+        converters[spec] = *conv;
+        converters[spec].flags &= ~(unsigned int)SCAN_CONV_BUILTIN;
+    }
+    pthread_mutex_unlock(&registry_lock);
+    return ok ? 0 : -1;
+}
+
+// Registers a conversion used as %{name}. Names are up to 31 characters
+// without '}' or whitespace, and up to 128 of them can be registered.
+// Returns 0, or -1 if the name is taken or invalid or the table is full.
+int scan_register_name(const char *name, const scan_converter *conv) {
+    size_t len = strlen(name);
+    if (len == 0 || len > MAX_CONVERSION_NAME || strchr(name, '}') != NULL ||
+        find_whitespace(name, name + len) != name + len || !converter_valid(conv)) {
+        return -1;
+    }
+    pthread_mutex_lock(&registry_lock);
+    int ok = (named_conversions < 256 - FIRST_NAMED_CONVERSION);
+    for (int k = 0; ok && k < named_conversions; k++) {
+        ok = (strcmp(conversion_names[k], name) != 0);
+    }
+    char *copy = ok ? strdup(name) : NULL;
+    if (copy != NULL) {
+        int slot = FIRST_NAMED_CONVERSION + named_conversions;
+        converters[slot] = *conv;
+        converters[slot].flags &= ~(unsigned int)SCAN_CONV_BUILTIN;
+        conversion_names[named_conversions] = copy;
+        // parse_name reads the count without the lock, so publish it last
+        __atomic_store_n(&named_conversions, named_conversions + 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&registry_lock);
+    return (copy != NULL) ? 0 : -1;
+}
+
+// The table entry of a compiled op's conversion, or NULL for an empty slot
+const scan_converter *scan_converter_for(unsigned char conv) {
+    return (converters[conv].convert != NULL) ? &converters[conv] : NULL;
+}
+
+// A converter needs a convert function, consistent whitespace flags, and a
+// skip function unless its %* form can convert into scratch space (%*m would
+// leak the string it allocates there)
+static int converter_valid(const scan_converter *conv) {
+    if (conv->convert == NULL ||
+        ((conv->flags & SCAN_CONV_SKIPS_WS) && (conv->flags & SCAN_CONV_KEEP_WS))) {
+        return 0;
+    }
+    return conv->skip != NULL ||
+           (conv->size <= SCAN_CONV_SCRATCH && !(conv->flags & SCAN_CONV_ALLOC));
+}
+
+// Built-in conversions. All of them skip leading whitespace themselves
+// except %c and %[.
+
+static int convert_char(scanner *sc, const scan_program *prog, const scan_op *op, void *dst) {
+    (void)prog;
+    if (op->width > 1) {
+        return read_chars(sc, dst, op->width);
+    }
+    return read_char(sc, dst);
+}
+
+static int convert_signed(scanner *sc, const scan_program *prog, const scan_op *op, void *dst) {
+    (void)prog;
+    long long value;
+    if (!read_signed(sc, op->length, &value)) {
+        return 0;
+    }
+    store_signed(dst, op->length, value);
+    return 1;
+}
+
+static int convert_unsigned(scanner *sc, const scan_program *prog, const scan_op *op, void *dst) {
+    (void)prog;
+    unsigned long long value;
+    if (!read_unsigned(sc, op->length, &value)) {
+        return 0;
+    }
+    store_unsigned(dst, op->length, value);
+    return 1;
+}
+
+static int convert_string(scanner *sc, const scan_program *prog, const scan_op *op, void *dst) {
+    (void)prog;
+    if (op->alloc) {
+        return read_string_alloc(sc, dst, op->width);
+    }
+    return read_string_bounded(sc, dst, op->width);
+}
+
+// %f %F %e %E %g %G %a %A
+static int convert_float(scanner *sc, const scan_program *prog, const scan_op *op, void *dst) {
+    (void)prog;
+    // %f is a double here (like %lf); %hf is a float and %Lf a long double
+    if (op->length == SCAN_LEN_H) {
+        return read_float(sc, dst);
+    }
+    if (op->length == SCAN_LEN_BIG_L) {
+        return read_long_double(sc, dst);
+    }
+    return read_double(sc, dst);
+}
+
+static int convert_hex(scanner *sc, const scan_program *prog, const scan_op *op, void *dst) {
+    (void)prog;
+    unsigned long long value;
+    if (!read_hex_unsigned(sc, op->length, &value)) {
+        return 0;
+    }
+    store_unsigned(dst, op->length, value);
+    return 1;
+}
+
+// Custom extensions
+
+static int convert_binary(scanner *sc, const scan_program *prog, const scan_op *op, void *dst) {
+    (void)prog;
+    unsigned long long value;
+    if (!read_binary_unsigned(sc, op->length, &value)) {
+        return 0;
+    }
+    store_unsigned(dst, op->length, value);
+    return 1;
+}
+
+static int convert_roman(scanner *sc, const scan_program *prog, const scan_op *op, void *dst) {
+    (void)prog;
+    (void)op;
+    return read_roman(sc, dst);
+}
+
+static int convert_word(scanner *sc, const scan_program *prog, const scan_op *op, void *dst) {
+    (void)prog;
+    if (op->alloc) {
+        return read_word_alloc(sc, dst, op->width);
+    }
+    return read_word_bounded(sc, dst, op->width);
+}
+
+static int convert_intern(scanner *sc, const scan_program *prog, const scan_op *op, void *dst) {
+    (void)prog;
+    return read_word_intern(sc, dst, op->width);
+}
+
+static int convert_view(scanner *sc, const scan_program *prog, const scan_op *op, void *dst) {
+    (void)prog;
+    return read_view(sc, dst, op->width);
+}
+
+static int convert_number(scanner *sc, const scan_program *prog, const scan_op *op, void *dst) {
+    (void)prog;
+    (void)op;
+    return read_number(sc, dst);
+}
+
+static int convert_scanset(scanner *sc, const scan_program *prog, const scan_op *op, void *dst) {
+    if (op->alloc) {
+        return read_scanset_alloc(sc, dst, &prog->sets[op->lit_off], op->width);
+    }
+    return read_scanset(sc, dst, &prog->sets[op->lit_off], op->width);
+}
+
+// SCANNER SETUP //
+
+// Bulk refill used by scanners that own their buffer
+static size_t fill_from_stream(void *source, char *dst, size_t n) {
+    return fread(dst, 1, n, (FILE *)source);
+}
+
+// Refill used by my_scanf: reads at most one line so that little needs to be
+// handed back to the stream afterwards. The caller holds the stream lock.
+static size_t fill_line_from_stream(void *source, char *dst, size_t n) {
+    FILE *stream = source;
+    size_t len = 0;
+    while (len < n) {
+        int c = getc_unlocked(stream);
+        if (c == EOF) {
+            break;
+        }
+        dst[len++] = (char)c;
+        if (c == '\n') {
+            break;
+        }
+    }
+    return len;
+}
+
+// Refill straight from a descriptor with read(2), retrying interrupted reads.
+// A read error ends the input like EOF does.
+static size_t fill_from_fd(void *source, char *dst, size_t n) {
+    int fd = (int)(intptr_t)source;
+    for (;;) {
+        ssize_t got = read(fd, dst, n);
+        if (got >= 0) {
+            return (size_t)got;
+        }
+        if (errno != EINTR) {
+            return 0;
+        }
+    }
+}
+
+// Refill used by my_dscanf on pipes and sockets: one byte per read(2), so
+// nothing is read that the scan does not look at
+static size_t fill_byte_from_fd(void *source, char *dst, size_t n) {
+    (void)n;
+    return fill_from_fd(source, dst, 1);
+}
+
+// Creates a scanner with its own buffer of the given capacity (0 = default)
+int scanner_init_file(scanner *sc, FILE *stream, size_t capacity) {
+    if (capacity == 0) {
+        capacity = SCANNER_DEFAULT_CAPACITY;
+    }
+    char *buf = malloc(capacity);
+    if (buf == NULL) {
+        return -1;
+    }
+
+    sc->buf = buf;
+    sc->cap = capacity;
+    sc->cur = buf;
+    sc->end = buf;
+    sc->fill = fill_from_stream;
+    sc->source = stream;
+    sc->stream = stream;
+    sc->fd = -1;
+    sc->eof = 0;
+    sc->owns_buf = 1;
+    sc->map = NULL;
+    sc->map_len = 0;
+    sc->origin = buf;
+    sc->base = 0;
+    sc->pin = SCANNER_NO_PIN;
+    sc->arena = NULL;
+    sc->intern = NULL;
+    sc->release = NULL;
+    return 0;
+}
+
+// Line-at-a-time adapter over a stream using a caller-provided buffer
+void scanner_attach_stream(scanner *sc, FILE *stream, char *buf, size_t capacity) {
+    sc->buf = buf;
+    sc->cap = capacity;
+    sc->cur = buf;
+    sc->end = buf;
+    sc->fill = fill_line_from_stream;
+    sc->source = stream;
+    sc->stream = stream;
+    sc->fd = -1;
+    sc->eof = 0;
+    sc->owns_buf = 0;
+    sc->map = NULL;
+    sc->map_len = 0;
+    sc->origin = buf;
+    sc->base = 0;
+    sc->pin = SCANNER_NO_PIN;
+    sc->arena = NULL;
+    sc->intern = NULL;
+    sc->release = NULL;
+}
+
+// Creates a scanner that reads a descriptor (file, pipe or socket) with
+// read(2) into its own buffer of the given capacity (0 = default). The
+// descriptor stays open and owned by the caller. Returns 0 on success.
+int scanner_init_fd(scanner *sc, int fd, size_t capacity) {
+    if (capacity == 0) {
+        capacity = SCANNER_DEFAULT_CAPACITY;
+    }
+    char *buf = malloc(capacity);
+    if (buf == NULL) {
+        return -1;
+    }
+    scanner_init_fd_buffer(sc, fd, buf, capacity);
+    sc->owns_buf = 1;
+    return 0;
+}
+
+// Descriptor scanner over a caller-provided buffer
+static void scanner_init_fd_buffer(scanner *sc, int fd, char *buf, size_t capacity) {
+    sc->buf = buf;
+    sc->cap = capacity;
+    sc->cur = buf;
+    sc->end = buf;
+    sc->fill = fill_from_fd;
+    sc->source = (void *)(intptr_t)fd;
+    sc->stream = NULL;
+    sc->fd = fd;
+    sc->eof = 0;
+    sc->owns_buf = 0;
+    sc->map = NULL;
+    sc->map_len = 0;
+    sc->origin = buf;
+    sc->base = 0;
+    sc->pin = SCANNER_NO_PIN;
+    sc->arena = NULL;
+    sc->intern = NULL;
+    sc->release = NULL;
+}
+
+// Scans caller memory in place. Nothing is copied and the memory must outlive the scanner.
+void scanner_init_memory(scanner *sc, const char *data, size_t len) {
+    sc->buf = NULL;
+    sc->cap = 0;
+    sc->cur = data;
+    sc->end = data + len;
+    sc->fill = NULL;
+    sc->source = NULL;
+    sc->stream = NULL;
+    sc->fd = -1;
+    sc->eof = 1;
+    sc->owns_buf = 0;
+    sc->map = NULL;
+    sc->map_len = 0;
+    sc->origin = data;
+    sc->base = 0;
+    sc->pin = SCANNER_NO_PIN;
+    sc->arena = NULL;
+    sc->intern = NULL;
+    sc->release = NULL;
+}
+
+// Maps a whole file read-only and scans it in place. Returns 0 on success.
+int scanner_map_file(scanner *sc, const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    size_t len = (size_t)st.st_size;
+    if (len == 0) {
+        // mmap rejects empty mappings, but an empty file is still valid input
+        close(fd);
+        scanner_init_memory(sc, "", 0);
+        return 0;
+    }
+
+    void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping keeps the file alive
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+
+    // Hints only: the file is read front to back once, and large pages cut TLB misses
+    madvise(map, len, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+    madvise(map, len, MADV_HUGEPAGE);
+#endif
+
+    scanner_init_memory(sc, map, len);
+    sc->map = map;
+    sc->map_len = len;
+    return 0;
+}
+
+// Bytes consumed since the scanner was set up
+size_t scanner_offset(const scanner *sc) {
+    return sc->base + (size_t)(sc->cur - sc->origin);
+}
+
+// Hands buffered-but-unread bytes back to the underlying stream or descriptor
+// so that it is positioned exactly after the last consumed byte. A descriptor
+// can only be rewound by seeking, so on a pipe or socket the bytes stay
+// buffered and -1 is returned. Returns 0 on success. A failed seek leaves
+// errno as it was, so an ERANGE from the conversions survives.
+int scanner_sync(scanner *sc) {
+    size_t unread = (size_t)(sc->end - sc->cur);
+    if ((sc->stream == NULL && sc->fd < 0) || unread == 0) {
+        return 0;
+    }
+
+    int saved_errno = errno;
+    if (sc->stream == NULL) {
+        if (lseek(sc->fd, -(off_t)unread, SEEK_CUR) < 0) {
+            errno = saved_errno;
+            return -1;
+        }
+    } else if (fseek(sc->stream, -(long)unread, SEEK_CUR) != 0) {
+        // Not seekable (pipe or terminal), so push the bytes back in reverse order
+        errno = saved_errno;
+        while (sc->end > sc->cur) {
+            sc->end--;
+            if (ungetc((unsigned char)*sc->end, sc->stream) == EOF) {
+                return -1;
+            }
+        }
+    }
+
+    sc->end = sc->cur;
+    sc->eof = 0;
+    return 0;
+}
+
+// Moves to byte `offset` of the input, counted from the start of the file
+// (or of the memory), so scanner_offset() reports it afterwards. Memory and
+// mapped scanners just move cur; descriptor and FILE scanners seek and drop
+// their buffer. Returns 0, or -1 if the source cannot seek, the offset is
+// past the end of memory, or a checkpoint is active.
+int scanner_seek(scanner *sc, size_t offset) {
+    if (sc->pin != SCANNER_NO_PIN) {
+        return -1;
+    }
+    if (sc->fill == NULL) {
+        if (offset > (size_t)(sc->end - sc->origin)) {
+            return -1;
+        }
+        sc->cur = sc->origin + offset;
+        return 0;
+    }
+
+    if (sc->stream != NULL) {
+        if (fseeko(sc->stream, (off_t)offset, SEEK_SET) != 0) {
+            return -1;
+        }
+    } else if (sc->fd < 0 || lseek(sc->fd, (off_t)offset, SEEK_SET) < 0) {
+        return -1;
+    }
+    sc->cur = sc->buf;
+    sc->end = sc->buf;
+    sc->origin = sc->buf;
+    sc->base = offset;
+    sc->eof = 0;
+    return 0;
+}
+
+void scanner_destroy(scanner *sc) {
+    scanner_sync(sc);
+    if (sc->owns_buf) {
+        free(sc->buf);
+    }
+    if (sc->map != NULL) {
+        munmap(sc->map, sc->map_len);
+        sc->map = NULL;
+    }
+    if (sc->release != NULL) {
+        sc->release(sc->source);
+        sc->release = NULL;
+    }
+    sc->buf = NULL;
+    sc->cur = NULL;
+    sc->end = NULL;
+}
+
+// Slides the unread bytes to the front of the buffer and asks the source for
+// more. Returns nonzero if at least one unread byte is available afterwards.
+int scanner_refill(scanner *sc) {
+    if (sc->eof || sc->fill == NULL) {
+        return sc->cur < sc->end;
+    }
+
+    // Keep one byte behind cur so scanner_ungetc stays valid across a refill
+    return refill_keeping(sc, (sc->cur > sc->buf) ? sc->cur - 1 : sc->cur);
+}
+
+// Refill that keeps every buffered byte from keep (at or before cur) onwards,
+// and everything from a checkpoint's pin. When those bytes already fill the
+// buffer nothing new can be read, unless a checkpoint is active: then the
+// buffer grows so speculative scans never see a false end of input.
+static int refill_keeping(scanner *sc, const char *keep) {
+    if (sc->eof || sc->fill == NULL) {
+        return sc->cur < sc->end;
+    }
+
+    if (sc->pin != SCANNER_NO_PIN) {
+        const char *pinned = sc->origin + (sc->pin - sc->base);
+        if (pinned < keep) {
+            keep = pinned;
+        }
+    }
+
+    size_t lookback = (size_t)(sc->cur - keep);
+    size_t kept = (size_t)(sc->end - keep);
+    sc->base += (size_t)(keep - sc->buf); // Bytes dropped from the front
+    memmove(sc->buf, keep, kept);
+    sc->cur = sc->buf + lookback;
+    sc->end = sc->buf + kept;
+
+    if (kept == sc->cap && sc->pin != SCANNER_NO_PIN && grow_buffer(sc) != 0) {
+        return sc->cur < sc->end;
+    }
+    if (kept < sc->cap) {
+        size_t got = sc->fill(sc->source, sc->buf + kept, sc->cap - kept);
+        if (got == 0) {
+            sc->eof = 1;
+        }
+        sc->end += got;
+    }
+
+    return sc->cur < sc->end;
+}
+
+// Doubles the refill buffer, moving a caller-provided buffer to the heap.
+// Returns 0 on success.
+static int grow_buffer(scanner *sc) {
+    size_t cap = sc->cap * 2;
+    char *buf = sc->owns_buf ? realloc(sc->buf, cap) : malloc(cap);
+    if (buf == NULL) {
+        return -1;
+    }
+    if (!sc->owns_buf) {
+        memcpy(buf, sc->buf, sc->cap);
+    }
+    sc->cur = buf + (sc->cur - sc->buf);
+    sc->end = buf + (sc->end - sc->buf);
+    sc->buf = buf;
+    sc->origin = buf;
+    sc->cap = cap;
+    sc->owns_buf = 1;
+    return 0;
+}
+
+// CHECKPOINTS //
+
+// Remembers the current position. Until the checkpoint is committed or rolled
+// back, refills keep every byte from here on, so rolling back is just moving
+// the cursor. Checkpoints nest and must be released in reverse order.
+scanner_checkpoint scanner_mark(scanner *sc) {
+    scanner_checkpoint cp = {scanner_offset(sc), sc->pin};
+    if (sc->pin == SCANNER_NO_PIN) {
+        sc->pin = cp.offset; // An outer checkpoint already pins older bytes
+    }
+    return cp;
+}
+
+// Keeps everything consumed since the checkpoint and releases it
+void scanner_commit(scanner *sc, scanner_checkpoint cp) {
+    sc->pin = cp.prev_pin;
+}
+
+// Returns to the checkpoint's position and releases it
+void scanner_rollback(scanner *sc, scanner_checkpoint cp) {
+    sc->cur = sc->origin + (cp.offset - sc->base);
+    sc->pin = cp.prev_pin;
+}
+
+// CORE HELPER FUNCTIONS //
+
+int read_char(scanner *sc, char *c) {
+    const int ch = scanner_getc(sc);
+    if (ch == EOF) {
+        return 0; // Failure - no character available
+    }
+    *c = (char)ch; // Store the characters at the pointer location
+    return 1; // Success
+}
+
+int read_int(scanner *sc, int *value) {
+    long long result;
+    if (!read_signed(sc, SCAN_LEN_NONE, &result)) {
+        return 0; // Failure - no valid integer inputted
+    }
+    *value = (int)result;
+    return 1; // Success
+}
+
+// Reads an optional sign and a run of decimal digits. The magnitude saturates
+// at UINT64_MAX with *overflow set. With no digit, the character that should
+// have been one is consumed and 0 is returned.
+static int read_decimal(scanner *sc, uint64_t *magnitude, int *negative, int *overflow) {
+    // Step 1: Skip leading whitespace
+    skip_whitespace(sc);
+    int c = scanner_getc(sc);
+
+    // Step 2: Check for optional sign
+    *negative = 0;
+    if (c == '-') {
+        *negative = 1;
+        c = scanner_getc(sc);
+    } else if (c == '+') {
+        c = scanner_getc(sc);
+    }
+
+    // Step 3: Need at least one digit
+    if (!is_digit(c)) {
+        return 0;
+    }
+
+    uint64_t result = (uint64_t)(c - '0');
+    int digits = 1; // Digits so far, leading zeros included, so result < 10^digits
+    *overflow = 0;
+
+    for (;;) {
+        // Step 4: Eight buffered digits per step while 10^(digits + 8) still fits in 64 bits
+        while (digits <= 11 && sc->end - sc->cur >= 8) {
+            uint64_t chunk = load_eight_bytes(sc->cur);
+            if (!is_eight_digits(chunk)) {
+                break;
+            }
+            result = result * 100000000 + parse_eight_digits(chunk);
+            sc->cur += 8;
+            digits += 8;
+        }
+
+        // Step 5: One digit at a time for the tail, with an overflow check
+        c = scanner_peek(sc);
+        if (!is_digit(c)) {
+            break; // Leave the non digit unread
+        }
+        scanner_advance(sc, 1);
+        digits++;
+
+        unsigned digit = (unsigned)(c - '0');
+        if (*overflow || result > (UINT64_MAX - digit) / 10) {
+            *overflow = 1; // Keep consuming digits, the value is pinned
+            result = UINT64_MAX;
+        } else {
+            result = result * 10 + digit;
+        }
+    }
+
+    *magnitude = result;
+    return 1;
+}
+
+// Signed decimal with strtol semantics: out of range values saturate to the
+// range of long (long long for ll/j) and set errno to ERANGE
+int read_signed(scanner *sc, int length, long long *value) {
+    uint64_t magnitude;
+    int negative;
+    int overflow;
+    if (!read_decimal(sc, &magnitude, &negative, &overflow)) {
+        return 0;
+    }
+
+    int wide = (length == SCAN_LEN_LL || length == SCAN_LEN_J);
+    uint64_t max = wide ? (uint64_t)LLONG_MAX : (uint64_t)LONG_MAX;
+    if (overflow || magnitude > max + negative) {
+        errno = ERANGE;
+        *value = negative ? (wide ? LLONG_MIN : LONG_MIN) : (long long)max;
+    } else if (negative) {
+        *value = (long long)(0 - magnitude); // Two's complement, also right for the minimum
+    } else {
+        *value = (long long)magnitude;
+    }
+    return 1;
+}
+
+// Unsigned decimal with strtoul semantics: a leading '-' negates modulo 2^N,
+// and magnitudes that do not fit saturate to the maximum with ERANGE
+int read_unsigned(scanner *sc, int length, unsigned long long *value) {
+    uint64_t magnitude;
+    int negative;
+    int overflow;
+    if (!read_decimal(sc, &magnitude, &negative, &overflow)) {
+        return 0;
+    }
+
+    int wide = (length == SCAN_LEN_LL || length == SCAN_LEN_J);
+    uint64_t max = wide ? (uint64_t)ULLONG_MAX : (uint64_t)ULONG_MAX;
+    if (overflow || magnitude > max) {
+        errno = ERANGE;
+        *value = max;
+    } else {
+        *value = negative ? (unsigned long long)((0 - magnitude) & max) : magnitude;
+    }
+    return 1;
+}
+
+// Copies the run of buffered bytes up to the first byte find_stop stops at,
+// refilling until the run ends inside the buffer, at EOF, or after width
+// bytes (0 = no limit). Returns how many bytes were copied.
+static size_t copy_run(scanner *sc, char *dst, size_t width,
+                       const char *(*find_stop)(const char *p, const char *end)) {
+    size_t index = 0;
+    for (;;) {
+        const char *limit = sc->end;
+        if (width != 0 && (size_t)(limit - sc->cur) > width - index) {
+            limit = sc->cur + (width - index);
+        }
+        const char *stop = find_stop(sc->cur, limit);
+        size_t len = (size_t)(stop - sc->cur);
+        memcpy(dst + index, sc->cur, len);
+        index += len;
+        sc->cur = stop;
+        if (stop < sc->end || (width != 0 && index == width) || !scanner_refill(sc)) {
+            return index; // Stop byte left unread, width reached, or EOF
+        }
+    }
+}
+
+int read_string(scanner *sc, char *str) {
+    return read_string_bounded(sc, str, 0);
+}
+
+// %s with a field width: at most width bytes (0 = no limit) plus the
+// terminator are written, so %63s needs a 64-byte buffer
+int read_string_bounded(scanner *sc, char *str, size_t width) {
+    // Step 1: Skip leading whitespace
+    skip_whitespace(sc);
+
+    // Step 2: Check for EOF before reading anything
+    if (scanner_peek(sc) == EOF) {
+        return 0; // Failure - no string to read
+    }
+
+    // Step 3: Copy buffered characters up to the next whitespace
+    size_t index = copy_run(sc, str, width, find_whitespace);
+
+    // Step 4: Null-terminate the string
+    str[index] = '\0';
+
+    // Step 5: Check if we read at least one character
+    if (index == 0) {
+        return 0; // Failure - no characters read
+    }
+
+    return 1; // Success
+}
+
+// %Nc: reads exactly width bytes (fewer only at EOF) with no terminator
+int read_chars(scanner *sc, char *str, size_t width) {
+    if (scanner_peek(sc) == EOF) {
+        return 0; // Failure - no character available
+    }
+
+    size_t index = 0;
+    while (index < width && (sc->cur < sc->end || scanner_refill(sc))) {
+        size_t len = (size_t)(sc->end - sc->cur);
+        if (len > width - index) {
+            len = width - index;
+        }
+        memcpy(str + index, sc->cur, len);
+        sc->cur += len;
+        index += len;
+    }
+    return 1; // Success
+}
+
+// %v: the next whitespace-delimited token (at most width bytes, 0 = no limit)
+// as a pointer and length into the scanner's buffer, without copying. For
+// memory and mapped scanners the view lives as long as the input; for buffered
+// FILE scanners only until the next refill, and a token longer than the
+// buffer fails. Line-mode stream scanners (my_scanf) hand their bytes back to
+// the stream, so they cannot give views.
+int read_view(scanner *sc, scan_view *view, size_t width) {
+    // Step 1: Skip leading whitespace
+    skip_whitespace(sc);
+    // Per-call windows (my_scanf, my_fscanf, my_dscanf) vanish when the call returns
+    if ((sc->fill != NULL && !sc->owns_buf) || scanner_peek(sc) == EOF) {
+        return 0; // Failure - no token, or no buffer to point into
+    }
+
+    // Step 2: Find the end of the token, refilling without dropping its start
+    const char *start = sc->cur;
+    for (;;) {
+        const char *limit = sc->end;
+        if (width != 0 && (size_t)(limit - start) > width) {
+            limit = start + width;
+        }
+        sc->cur = find_whitespace(sc->cur, limit);
+        if (sc->cur < sc->end || (size_t)(sc->cur - start) == width) {
+            break; // Whitespace (left unread) or width reached
+        }
+
+        size_t offset = (size_t)(sc->cur - start);
+        size_t before = (size_t)(sc->end - start);
+        refill_keeping(sc, start);
+        start = sc->cur - offset;
+        if ((size_t)(sc->end - start) == before) {
+            if (!sc->eof) {
+                return 0; // Failure - token longer than the buffer
+            }
+            break; // Token runs to EOF
+        }
+    }
+
+    // Step 3: Point at the token
+    view->ptr = start;
+    view->len = (size_t)(sc->cur - start);
+    return 1; // Success
+}
+
+// %[...]: the longest run of bytes in the set (at most width, 0 = no limit),
+// copied and null-terminated. Leading whitespace is not skipped.
+int read_scanset(scanner *sc, char *str, const scan_set *set, size_t width) {
+    size_t index = 0;
+    for (;;) {
+        if (sc->cur == sc->end && !scanner_refill(sc)) {
+            break; // EOF
+        }
+        const char *limit = sc->end;
+        if (width != 0 && (size_t)(limit - sc->cur) > width - index) {
+            limit = sc->cur + (width - index);
+        }
+        const char *stop = find_not_in_set(set, sc->cur, limit);
+        size_t len = (size_t)(stop - sc->cur);
+        memcpy(str + index, sc->cur, len);
+        index += len;
+        sc->cur = stop;
+        if (stop < sc->end || (width != 0 && index == width)) {
+            break; // First byte outside the set left unread, or width reached
+        }
+    }
+
+    if (index == 0) {
+        return 0; // Failure - no byte matched
+    }
+    str[index] = '\0';
+    return 1; // Success
+}
+
+// Reads a run of hex (bits = 4) or binary (bits = 1) digits after an
+// optional "0x"/"0b" prefix. The value saturates at UINT64_MAX with *overflow
+// set. With no digit, the character that should have been one is consumed and
+// 0 is returned.
+static int read_radix(scanner *sc, int bits, uint64_t *magnitude, int *overflow) {
+    int prefix = (bits == 4) ? 'x' : 'b';
+    size_t window = (bits == 4) ? 16 : 64; // Bytes each kernel call looks at
+    int digit_found = 0;
+
+    // Step 1: Skip leading whitespace
+    skip_whitespace(sc);
+    int c = scanner_getc(sc);
+
+    // Step 2: Optional "0x"/"0X" or "0b"/"0B" prefix
+    if (c == '0') {
+        int next = scanner_getc(sc);
+        if (next == prefix || next == prefix - 'a' + 'A') {
+            // Valid prefix, move to next character
+            c = scanner_getc(sc);
+        } else {
+            // Just a '0', which is a valid digit
+            digit_found = 1;
+            c = next; // Process the character after '0'
+        }
+    }
+
+    // Step 3: Need at least one digit (a bare "0" counts)
+    int is_digit_c = (bits == 4) ? is_hex_digit(c) : is_binary_digit(c);
+    if (!is_digit_c) {
+        if (!digit_found) {
+            return 0; // Failure - no valid number
+        }
+        scanner_ungetc(sc, c);
+        *magnitude = 0;
+        *overflow = 0;
+        return 1;
+    }
+    scanner_ungetc(sc, c);
+
+    uint64_t result = 0;
+    *overflow = 0;
+    for (;;) {
+        // Step 4: A whole window of digits per kernel call while it is buffered,
+        // one peeked digit at a time near the end of the buffer
+        uint64_t chunk;
+        int n;
+        if ((size_t)(sc->end - sc->cur) >= window) {
+            n = (bits == 4) ? hex_prefix16(sc->cur, &chunk) : binary_prefix64(sc->cur, &chunk);
+        } else {
+            c = scanner_peek(sc);
+            int d = (bits == 4) ? (is_hex_digit(c) ? hex_to_int(c) : -1)
+                                : (is_binary_digit(c) ? c - '0' : -1);
+            n = (d < 0) ? 0 : 1;
+            chunk = (uint64_t)(d < 0 ? 0 : d);
+        }
+        if (n == 0) {
+            break; // Leave the non digit unread
+        }
+        scanner_advance(sc, (size_t)n);
+
+        // Step 5: Append the chunk; leading zeros never overflow
+        int shift = bits * n;
+        if (result == 0) {
+            result = chunk;
+        } else if (shift == 64 || (result >> (64 - shift)) != 0) {
+            *overflow = 1; // Keep consuming digits, the value is pinned
+            result = UINT64_MAX;
+        } else {
+            result = (result << shift) | chunk;
+        }
+
+        if (n > 1 && (size_t)n < window) {
+            break; // The kernel saw the run end
+        }
+    }
+
+    *magnitude = result;
+    return 1;
+}
+
+// Hex or binary digits with strtoul semantics: values that do not fit
+// unsigned long (unsigned long long for ll/j) saturate with ERANGE
+static int read_radix_unsigned(scanner *sc, int bits, int length, unsigned long long *value) {
+    uint64_t magnitude;
+    int overflow;
+    if (!read_radix(sc, bits, &magnitude, &overflow)) {
+        return 0;
+    }
+
+    int wide = (length == SCAN_LEN_LL || length == SCAN_LEN_J);
+    uint64_t max = wide ? (uint64_t)ULLONG_MAX : (uint64_t)ULONG_MAX;
+    if (overflow || magnitude > max) {
+        errno = ERANGE;
+        *value = max;
+    } else {
+        *value = magnitude;
+    }
+    return 1;
+}
+
+int read_hex_unsigned(scanner *sc, int length, unsigned long long *value) {
+    return read_radix_unsigned(sc, 4, length, value);
+}
+
+int read_binary_unsigned(scanner *sc, int length, unsigned long long *value) {
+    return read_radix_unsigned(sc, 1, length, value);
+}
+
+int read_hex(scanner *sc, unsigned int *value) {
+    unsigned long long result;
+    if (!read_hex_unsigned(sc, SCAN_LEN_NONE, &result)) {
+        return 0; // Failure - no valid hex number
+    }
+    *value = (unsigned int)result;
+    return 1; // Success
+}
+
+int read_binary(scanner *sc, unsigned int *value) {
+    unsigned long long result;
+    if (!read_binary_unsigned(sc, SCAN_LEN_NONE, &result)) {
+        return 0;
+    }
+    *value = (unsigned int)result;
+    return 1;
+}
+
+int read_roman(scanner *sc, int *value) {
+    long long result = 0;
+    int digit_found = 0;
+    int pending = 0; // Digit not yet added, waiting to see whether the next one is larger
+
+    // Skip leading whitespace
+    skip_whitespace(sc);
+    int c = scanner_getc(sc);
+
+    // Convert while reading, so a numeral of any length needs no buffer
+    while (is_roman_digit(c)) {
+        digit_found = 1;
+        int current = roman_to_int(c);
+        if (pending == 0) {
+            pending = current;
+        } else if (pending < current) {
+            // Subtractive pair (IV, IX, XL, etc.)
+            result += current - pending;
+            pending = 0;
+        } else {
+            // Normal case: just add the value
+            result += pending;
+            pending = current;
+        }
+        if (result > INT_MAX) {
+            result = INT_MAX + 1LL; // Saturates anyway; stop it growing
+        }
+        c = scanner_getc(sc);
+    }
+
+    if (!digit_found) {
+        return 0;
+    }
+    result += pending;
+
+    if (c != EOF) {
+        scanner_ungetc(sc, c);
+    }
+
+    // Values too large for an int saturate, like %d
+    if (result > INT_MAX) {
+        errno = ERANGE;
+        result = INT_MAX;
+    }
+    *value = (int)result;
+    return 1;
+}
+
+int read_word(scanner *sc, char *str) {
+    return read_word_bounded(sc, str, 0);
+}
+
+// %w with a field width, bounded like read_string_bounded
+int read_word_bounded(scanner *sc, char *str, size_t width) {
+    // Skip leading whitespace
+    skip_whitespace(sc);
+
+    if (scanner_peek(sc) == EOF) {
+        return 0;
+    }
+
+    // Copy word characters, leaving the first other character unread
+    size_t index = copy_run(sc, str, width, find_non_word);
+
+    // Null terminate
+    str[index] = '\0';
+
+    if (index == 0) {
+        return 0;
+    }
+
+    return 1; // Success
+}
+
+// Measures the run that find_stop (or set, for scansets) allows, up to width
+// bytes, and returns its length with the scanner still at its start. A
+// checkpoint keeps the whole run buffered while it is measured, so afterwards
+// it lies in one piece at sc->cur even when it spanned refills.
+static size_t measure_run(scanner *sc, size_t width, const scan_set *set,
+                          const char *(*find_stop)(const char *p, const char *end)) {
+    scanner_checkpoint cp = scanner_mark(sc);
+    size_t len = 0;
+    for (;;) {
+        if (sc->cur == sc->end && !scanner_refill(sc)) {
+            break; // EOF
+        }
+        const char *limit = sc->end;
+        if (width != 0 && (size_t)(limit - sc->cur) > width - len) {
+            limit = sc->cur + (width - len);
+        }
+        const char *stop = (set != NULL) ? find_not_in_set(set, sc->cur, limit)
+                                         : find_stop(sc->cur, limit);
+        len += (size_t)(stop - sc->cur);
+        sc->cur = stop;
+        if (stop < sc->end || (width != 0 && len == width)) {
+            break; // Stop byte left unread, or width reached
+        }
+    }
+    scanner_rollback(sc, cp);
+    return len;
+}
+
+// Copies the measured run once into a string from the scanner's arena, or
+// from malloc without one
+static int alloc_run(scanner *sc, char **str, size_t width, const scan_set *set,
+                     const char *(*find_stop)(const char *p, const char *end)) {
+    size_t len = measure_run(sc, width, set, find_stop);
+    if (len == 0) {
+        return 0; // Failure - nothing to store
+    }
+    char *copy = (sc->arena != NULL) ? scan_arena_alloc(sc->arena, len + 1) : malloc(len + 1);
+    if (copy == NULL) {
+        return 0; // Out of memory
+    }
+    memcpy(copy, sc->cur, len);
+    copy[len] = '\0';
+    scanner_advance(sc, len);
+    *str = copy;
+    return 1;
+}
+
+// %ms: like %s, but stores a pointer to a new string
+int read_string_alloc(scanner *sc, char **str, size_t width) {
+    skip_whitespace(sc);
+    return alloc_run(sc, str, width, NULL, find_whitespace);
+}
+
+// %mw
+int read_word_alloc(scanner *sc, char **str, size_t width) {
+    skip_whitespace(sc);
+    return alloc_run(sc, str, width, NULL, find_non_word);
+}
+
+// %m[...]
+int read_scanset_alloc(scanner *sc, char **str, const scan_set *set, size_t width) {
+    return alloc_run(sc, str, width, set, NULL);
+}
+
+// %W: a word like %w, stored as its ID in the scanner's intern table
+// instead of as bytes. The word is hashed in place in the buffer and never
+// copied unless it is new. Fails, consuming nothing, without a word or a table.
+int read_word_intern(scanner *sc, unsigned int *id, size_t width) {
+    skip_whitespace(sc);
+    if (sc->intern == NULL) {
+        return 0;
+    }
+
+    // The word usually ends inside the buffer; only one that reaches its end
+    // needs a checkpoint to stay in one piece across refills
+    const char *limit = sc->end;
+    if (width != 0 && (size_t)(limit - sc->cur) > width) {
+        limit = sc->cur + width;
+    }
+    const char *stop = find_non_word(sc->cur, limit);
+    size_t len = (size_t)(stop - sc->cur);
+    if (stop == sc->end && sc->fill != NULL && len != width) {
+        len = measure_run(sc, width, NULL, find_non_word);
+    }
+    if (len == 0 || !scan_intern_add(sc->intern, sc->cur, len, id)) {
+        return 0;
+    }
+    scanner_advance(sc, len);
+    return 1;
+}
+
+// Lexical forms %N tracks in lockstep, in the order they win when several
+// accept the same token: "2e10" is a float rather than bare hex, "0b11" is
+// binary rather than bare hex, "017" is octal rather than decimal
+enum number_form {
+    FORM_FLOAT,
+    FORM_BINARY,
+    FORM_PREFIXED_HEX,
+    FORM_OCTAL,
+    FORM_DECIMAL,
+    FORM_BARE_HEX,
+    FORM_COUNT
+};
+
+// Float states: 0 start, 1 integer digits, 2 '.' without digits, 3 digits
+// and '.', 4 after e/E, 5 exponent sign, 6 exponent digits
+#define FLOAT_ACCEPTS(state) ((state) == 3 || (state) == 6)
+
+// Accumulates one digit in the given base, pinning at UINT64_MAX on overflow
+static inline void accumulate(uint64_t *value, int *overflow, unsigned bits, unsigned digit) {
+    if (bits == 0) {
+        // Decimal
+        if (*value > (UINT64_MAX - digit) / 10) {
+            *overflow = 1;
+        }
+        *value = *value * 10 + digit;
+    } else {
+        if (*value >> (64 - bits)) {
+            *overflow = 1;
+        }
+        *value = (*value << bits) | digit;
+    }
+}
+
+// Reads any number and reports what it was: decimal, octal (017), hex (0x1F,
+// x10 or bare BEEF), binary (0b101) or floating point (39e-5, .5, 1.). Every
+// form runs in lockstep over the token, so its bytes are scanned once. The
+// longest prefix some form accepts wins, with ties broken as in enum
+// number_form. Integers follow strtoll (saturating with ERANGE); floats are
+// parsed from the token by the correctly rounded float reader. On failure
+// nothing is consumed.
+int read_number(scanner *sc, scan_number *number) {
+    // Step 1: Skip leading whitespace and take an optional sign
+    skip_whitespace(sc);
+    scanner_checkpoint cp = scanner_mark(sc);
+    int negative = 0;
+    size_t sign_len = 0;
+    int c = scanner_peek(sc);
+    if (c == '-' || c == '+') {
+        negative = (c == '-');
+        sign_len = 1;
+        scanner_advance(sc, 1);
+    }
+
+    // Step 2: Feed each byte to every live form until none can continue
+    unsigned alive = (1u << FORM_COUNT) - 1;
+    int float_state = 0;
+    int hex_prefix_state = 0; // 0 start, 1 "0", 2 "0x" or "x", 3 hex digits
+    int bare_hex_letter = 0;
+    uint64_t values[FORM_COUNT] = {0};
+    int overflows[FORM_COUNT] = {0};
+    size_t len = 0;
+    size_t accept_len = 0;
+    int accept_form = -1;
+    uint64_t accept_value = 0;
+    int accept_overflow = 0;
+
+    for (;;) {
+        c = scanner_peek(sc);
+        int hex = is_hex_digit(c) ? hex_to_int(c) : -1;
+        int lower = c | 0x20;
+
+        if (alive & (1u << FORM_DECIMAL)) {
+            if (is_digit(c)) {
+                accumulate(&values[FORM_DECIMAL], &overflows[FORM_DECIMAL], 0, (unsigned)(c - '0'));
+            } else {
+                alive &= ~(1u << FORM_DECIMAL);
+            }
+        }
+        if (alive & (1u << FORM_OCTAL)) {
+            if ((len == 0) ? c == '0' : (c >= '0' && c <= '7')) {
+                accumulate(&values[FORM_OCTAL], &overflows[FORM_OCTAL], 3, (unsigned)(c - '0'));
+            } else {
+                alive &= ~(1u << FORM_OCTAL);
+            }
+        }
+        if (alive & (1u << FORM_BINARY)) {
+            if (len == 0 ? c == '0' : len == 1 ? lower == 'b' : is_binary_digit(c)) {
+                if (len >= 2) {
+                    accumulate(&values[FORM_BINARY], &overflows[FORM_BINARY], 1, (unsigned)(c - '0'));
+                }
+            } else {
+                alive &= ~(1u << FORM_BINARY);
+            }
+        }
+        if (alive & (1u << FORM_PREFIXED_HEX)) {
+            if (hex_prefix_state == 0 && c == '0') {
+                hex_prefix_state = 1;
+            } else if (hex_prefix_state <= 1 && lower == 'x') {
+                hex_prefix_state = 2;
+            } else if (hex_prefix_state >= 2 && hex >= 0) {
+                hex_prefix_state = 3;
+                accumulate(&values[FORM_PREFIXED_HEX], &overflows[FORM_PREFIXED_HEX], 4,
+                           (unsigned)hex);
+            } else {
+                alive &= ~(1u << FORM_PREFIXED_HEX);
+            }
+        }
+        if (alive & (1u << FORM_BARE_HEX)) {
+            if (hex >= 0) {
+                bare_hex_letter |= !is_digit(c);
+                accumulate(&values[FORM_BARE_HEX], &overflows[FORM_BARE_HEX], 4, (unsigned)hex);
+            } else {
+                alive &= ~(1u << FORM_BARE_HEX);
+            }
+        }
+        if (alive & (1u << FORM_FLOAT)) {
+            int next = -1;
+            if (is_digit(c)) {
+                static const signed char on_digit[7] = {1, 1, 3, 3, 6, 6, 6};
+                next = on_digit[float_state];
+            } else if (c == '.' && (float_state == 0 || float_state == 1)) {
+                next = (float_state == 0) ? 2 : 3;
+            } else if (lower == 'e' && (float_state == 1 || float_state == 3)) {
+                next = 4;
+            } else if ((c == '+' || c == '-') && float_state == 4) {
+                next = 5;
+            }
+            if (next < 0) {
+                alive &= ~(1u << FORM_FLOAT);
+            } else {
+                float_state = next;
+            }
+        }
+
+        if (alive == 0) {
+            break; // c ends the token and stays unread
+        }
+        scanner_advance(sc, 1);
+        len++;
+
+        // Step 3: Remember the best form that accepts the token so far
+        int form = -1;
+        if ((alive & (1u << FORM_FLOAT)) && FLOAT_ACCEPTS(float_state)) {
+            form = FORM_FLOAT;
+        } else if ((alive & (1u << FORM_BINARY)) && len >= 3) {
+            form = FORM_BINARY;
+        } else if ((alive & (1u << FORM_PREFIXED_HEX)) && hex_prefix_state == 3) {
+            form = FORM_PREFIXED_HEX;
+        } else if ((alive & (1u << FORM_OCTAL)) && len >= 2) {
+            form = FORM_OCTAL;
+        } else if (alive & (1u << FORM_DECIMAL)) {
+            form = FORM_DECIMAL;
+        } else if ((alive & (1u << FORM_BARE_HEX)) && bare_hex_letter) {
+            form = FORM_BARE_HEX;
+        }
+        if (form >= 0) {
+            accept_len = len;
+            accept_form = form;
+            accept_value = values[form];
+            accept_overflow = overflows[form];
+        }
+    }
+
+    // Step 4: Back to the sign, then past the accepted prefix only. The token
+    // was pinned by the checkpoint, so it is all still buffered.
+    scanner_rollback(sc, cp);
+    if (accept_form < 0) {
+        return 0; // Failure - no number here
+    }
+    const char *token = sc->cur;
+    size_t token_len = sign_len + accept_len;
+    scanner_advance(sc, token_len);
+
+    // Step 5: Fill in the tagged result
+    if (accept_form == FORM_FLOAT) {
+        scanner token_scanner;
+        scanner_init_memory(&token_scanner, token, token_len);
+        number->kind = SCAN_NUMBER_FLOAT;
+        return read_double(&token_scanner, &number->f);
+    }
+
+    static const enum scan_number_kind kinds[FORM_COUNT] = {
+        SCAN_NUMBER_FLOAT, SCAN_NUMBER_BINARY, SCAN_NUMBER_HEX,
+        SCAN_NUMBER_OCTAL, SCAN_NUMBER_DECIMAL, SCAN_NUMBER_HEX
+    };
+    number->kind = kinds[accept_form];
+    uint64_t limit = negative ? (uint64_t)LLONG_MAX + 1 : (uint64_t)LLONG_MAX;
+    if (accept_overflow || accept_value > limit) {
+        errno = ERANGE;
+        number->i = negative ? LLONG_MIN : LLONG_MAX;
+    } else {
+        number->i = negative ? (long long)(0 - accept_value) : (long long)accept_value;
+    }
+    return 1;
+}
+
+// SUPPRESSED FIELDS //
+// %*d and friends only find where their field ends. Each skip_* accepts
+// exactly the input its read_* does and stops at the same byte, but computes
+// no value, so it never overflows, rounds or sets errno. Strings, words and
+// scansets are crossed with the SIMD kernels.
+
+// Consumes up to width bytes (0 = no limit) up to the first byte find_stop
+// (or set, for scansets) stops at, refilling as needed. Returns the count.
+static size_t skip_run(scanner *sc, size_t width, const scan_set *set,
+                       const char *(*find_stop)(const char *p, const char *end)) {
+    size_t len = 0;
+    for (;;) {
+        if (sc->cur == sc->end && !scanner_refill(sc)) {
+            return len; // EOF
+        }
+        const char *limit = sc->end;
+        if (width != 0 && (size_t)(limit - sc->cur) > width - len) {
+            limit = sc->cur + (width - len);
+        }
+        const char *stop = (set != NULL) ? find_not_in_set(set, sc->cur, limit)
+                                         : find_stop(sc->cur, limit);
+        len += (size_t)(stop - sc->cur);
+        sc->cur = stop;
+        if (stop < sc->end || (width != 0 && len == width)) {
+            return len; // Stop byte left unread, or width reached
+        }
+    }
+}
+
+// Whether c is a digit in radix 2, 10 or 16, or a roman digit for radix 0.
+// Inlined range tests: this runs once per byte of every skipped number.
+static inline int is_radix_digit(int radix, unsigned char c) {
+    switch (radix) {
+        case 2:  return (unsigned char)(c - '0') < 2;
+        case 10: return (unsigned char)(c - '0') < 10;
+        case 16: return (unsigned char)(c - '0') < 10 || (unsigned char)((c | 0x20) - 'a') < 6;
+        default: return is_roman_digit(c);
+    }
+}
+
+// Body of skip_digits, specialized per radix by the calls below
+static inline __attribute__((always_inline)) size_t skip_digit_run(scanner *sc, int radix) {
+    size_t n = 0;
+    for (;;) {
+        const char *p = sc->cur;
+        if (radix == 10) {
+            while (sc->end - p >= 8 && is_eight_digits(load_eight_bytes(p))) {
+                p += 8;
+            }
+        }
+        while (p < sc->end && is_radix_digit(radix, (unsigned char)*p)) {
+            p++;
+        }
+        n += (size_t)(p - sc->cur);
+        sc->cur = p;
+        if (p < sc->end || !scanner_refill(sc)) {
+            return n; // Non digit left unread, or EOF
+        }
+    }
+}
+
+// Consumes a run of digits in radix 2, 10 or 16 (0 = roman digits) and
+// returns how many. Decimal runs go eight digits per SWAR test; numeric
+// tokens are short, so that beats a SIMD kernel call.
+size_t skip_digits(scanner *sc, int radix) {
+    switch (radix) {
+        case 2:  return skip_digit_run(sc, 2);
+        case 10: return skip_digit_run(sc, 10);
+        case 16: return skip_digit_run(sc, 16);
+        default: return skip_digit_run(sc, 0);
+    }
+}
+
+// %*d and %*u
+int skip_decimal(scanner *sc) {
+    skip_whitespace(sc);
+    int c = scanner_getc(sc);
+    if (c == '-' || c == '+') {
+        c = scanner_getc(sc);
+    }
+    if (!is_digit(c)) {
+        return 0; // The offending character is consumed, as by read_decimal
+    }
+    skip_digits(sc, 10);
+    return 1;
+}
+
+// %*x (bits = 4) and %*b (bits = 1), with read_radix's prefix rules
+static int skip_radix(scanner *sc, int bits) {
+    int prefix = (bits == 4) ? 'x' : 'b';
+    int digit_found = 0;
+    skip_whitespace(sc);
+    int c = scanner_getc(sc);
+    if (c == '0') {
+        int next = scanner_getc(sc);
+        if (next == prefix || next == prefix - 'a' + 'A') {
+            c = scanner_getc(sc);
+        } else {
+            digit_found = 1;
+            c = next;
+        }
+    }
+    if (!((bits == 4) ? is_hex_digit(c) : is_binary_digit(c))) {
+        if (!digit_found) {
+            return 0;
+        }
+        scanner_ungetc(sc, c);
+        return 1;
+    }
+    skip_digits(sc, (bits == 4) ? 16 : 2);
+    return 1;
+}
+
+int skip_hex(scanner *sc) {
+    return skip_radix(sc, 4);
+}
+
+int skip_binary(scanner *sc) {
+    return skip_radix(sc, 1);
+}
+
+// %*r
+int skip_roman(scanner *sc) {
+    skip_whitespace(sc);
+    if (!is_roman_digit(scanner_getc(sc))) {
+        return 0;
+    }
+    skip_digits(sc, 0);
+    return 1;
+}
+
+// %*c and %*Nc: width bytes (at least one), fewer only at EOF
+int skip_chars(scanner *sc, size_t width) {
+    if (scanner_peek(sc) == EOF) {
+        return 0;
+    }
+    size_t left = (width > 1) ? width : 1;
+    while (left > 0 && (sc->cur < sc->end || scanner_refill(sc))) {
+        size_t len = (size_t)(sc->end - sc->cur);
+        if (len > left) {
+            len = left;
+        }
+        sc->cur += len;
+        left -= len;
+    }
+    return 1;
+}
+
+// %*s and %*v
+int skip_string(scanner *sc, size_t width) {
+    skip_whitespace(sc);
+    return skip_run(sc, width, NULL, find_whitespace) > 0;
+}
+
+// %*w and %*W (which needs no intern table)
+int skip_word(scanner *sc, size_t width) {
+    skip_whitespace(sc);
+    return skip_run(sc, width, NULL, find_non_word) > 0;
+}
+
+// %*[...]
+int skip_scanset(scanner *sc, const scan_set *set, size_t width) {
+    return skip_run(sc, width, set, NULL) > 0;
+}
+
+// %*N: the %N automaton already reads the token once, so the value is
+// computed and dropped, without touching errno
+int skip_number(scanner *sc) {
+    int saved_errno = errno;
+    scan_number unused;
+    int ok = read_number(sc, &unused);
+    errno = saved_errno;
+    return ok;
+}
+
+// Runs the skip path of a suppressed conversion. Registered conversions
+// without one convert into scratch space that is then dropped.
+static int skip_field(scanner *sc, const scan_program *prog, const scan_op *op) {
+    const scan_converter *entry = &converters[op->conv];
+    if (entry->skip != NULL) {
+        return entry->skip(sc, prog, op);
+    }
+    union {
+        max_align_t align;
+        unsigned char bytes[SCAN_CONV_SCRATCH];
+    } scratch;
+    return entry->convert(sc, prog, op, &scratch);
+}
+
+// Skip paths of the built-in conversions, in the shape of the table
+
+static int skip_char_field(scanner *sc, const scan_program *prog, const scan_op *op) {
+    (void)prog;
+    return skip_chars(sc, op->width);
+}
+
+// %*d and %*u
+static int skip_decimal_field(scanner *sc, const scan_program *prog, const scan_op *op) {
+    (void)prog;
+    (void)op;
+    return skip_decimal(sc);
+}
+
+// %*s and %*v
+static int skip_string_field(scanner *sc, const scan_program *prog, const scan_op *op) {
+    (void)prog;
+    return skip_string(sc, op->width);
+}
+
+static int skip_float_field(scanner *sc, const scan_program *prog, const scan_op *op) {
+    (void)prog;
+    (void)op;
+    return skip_float(sc);
+}
+
+static int skip_hex_field(scanner *sc, const scan_program *prog, const scan_op *op) {
+    (void)prog;
+    (void)op;
+    return skip_hex(sc);
+}
+
+static int skip_binary_field(scanner *sc, const scan_program *prog, const scan_op *op) {
+    (void)prog;
+    (void)op;
+    return skip_binary(sc);
+}
+
+static int skip_roman_field(scanner *sc, const scan_program *prog, const scan_op *op) {
+    (void)prog;
+    (void)op;
+    return skip_roman(sc);
+}
+
+// %*w and %*W
+static int skip_word_field(scanner *sc, const scan_program *prog, const scan_op *op) {
+    (void)prog;
+    return skip_word(sc, op->width);
+}
+
+static int skip_number_field(scanner *sc, const scan_program *prog, const scan_op *op) {
+    (void)prog;
+    (void)op;
+    return skip_number(sc);
+}
+
+static int skip_scanset_field(scanner *sc, const scan_program *prog, const scan_op *op) {
+    return skip_scanset(sc, &prog->sets[op->lit_off], op->width);
+}
+
+// ANCILLARY HELPER FUNCTIONS //
+
+int is_whitespace(int c) {
+    return (c == ' ' || c == '\n' || c == '\t' \
+        || c == '\r' || c == '\f' || c == '\v');
+}
+
+void skip_whitespace(scanner *sc) {
+    for (;;) {
+        // Jump over the buffered whitespace many bytes at a time
+        sc->cur = find_non_whitespace(sc->cur, sc->end);
+        if (sc->cur < sc->end || !scanner_refill(sc)) {
+            return; // Stopped on a non whitespace character (or EOF)
+        }
+    }
+}
+
+int is_digit(int c) {
+    return (c >= '0' && c <= '9');
+}
+
+int is_hex_digit(int c) {
+    return (c >= '0' && c <= '9') || \
+           (c >= 'a' && c <= 'f') || \
+           (c >= 'A' && c <= 'F');
+}
+
+int hex_to_int(int c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10; // 'a' = 10, 'b' = 11, etc.
+    } else if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10; // 'A' = 10, 'B' = 11, etc.
+    }
+    return 0;
+}
+
+int is_binary_digit(int c) {
+    return (c == '0' || c == '1');
+}
+
+int roman_to_int(char c) {
+    switch (c) {
+        case 'I': return 1;
+        case 'V': return 5;
+        case 'X': return 10;
+        case 'L': return 50;
+        case 'C': return 100;
+        case 'D': return 500;
+        case 'M': return 1000;
+        default: return 0;
+    }
+}
+
+int is_roman_digit(int c) {
+    return (c == 'I' || c == 'V' || c == 'X' || c == 'L' || c == 'C' || c == 'D' || c == 'M');
+}
+
+// Only considers alphanumeric & underscore characters
+int is_word_char(int c) {
+    return (c >= 'a' && c <= 'z') || \
+           (c >= 'A' && c <= 'Z') || \
+           (c >= '0' && c <= '9') || \
+           (c == '_');
+}
+
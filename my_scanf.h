@@ -0,0 +1,445 @@
+#ifndef MY_SCANF_H
+#define MY_SCANF_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "scan_simd.h"
+
+// Default refill buffer size for scanners that own their buffer
+#define SCANNER_DEFAULT_CAPACITY (1 << 20)
+
+// Bump-pointer arena for strings from %ms, %mw and %m[...] (scan_arena.c)
+#define SCAN_ARENA_DEFAULT_BLOCK (1 << 20)
+
+typedef struct scan_arena_block scan_arena_block;
+
+typedef struct scan_arena {
+    scan_arena_block *blocks; // Newest first; the first one is being filled
+    char *next;               // Next free byte of the current block
+    char *limit;              // End of the current block
+    size_t block_size;        // Size of regular blocks
+    size_t used;              // Bytes handed out since the last reset
+} scan_arena;
+
+// Intern table for %W identifiers (scan_intern.c), defined below
+typedef struct scan_intern scan_intern;
+
+// Copies up to n bytes of input into dst and returns how many were copied (0 means EOF)
+typedef size_t (*scanner_fill_fn)(void *source, char *dst, size_t n);
+// Frees a source when its scanner is destroyed
+typedef void (*scanner_release_fn)(void *source);
+
+// A scanner owns a window [cur, end) of buffered input. Reading, peeking and
+// advancing are pointer operations on that window; the source is only asked
+// for more bytes when the window runs dry.
+typedef struct scanner {
+    const char *cur;            // Next unread byte
+    const char *end;            // One past the last buffered byte
+    char *buf;                  // Refill buffer (NULL when scanning caller memory)
+    size_t cap;                 // Size of buf
+    scanner_fill_fn fill;       // Refills buf, or NULL when there is nothing more to read
+    void *source;               // Passed to fill
+    FILE *stream;               // Underlying stream for FILE sources, so unread bytes can be handed back
+    int fd;                     // Underlying descriptor for fd sources, or -1
+    int eof;                    // Set once fill has reported end of input
+    int owns_buf;               // buf was allocated by scanner_init_file
+    void *map;                  // Base of the file mapping for scanner_map_file
+    size_t map_len;             // Length of that mapping
+    const char *origin;         // Start of the input for memory sources, or buf, used for offsets
+    size_t base;                // Input offset of origin (grows as refills drop consumed bytes)
+    size_t pin;                 // Offset of the oldest active checkpoint, or SCANNER_NO_PIN
+    scan_arena *arena;          // Where allocating conversions put strings (NULL = malloc)
+    scan_intern *intern;        // Where %W looks up words (NULL = %W fails)
+    scanner_release_fn release; // Frees source on scanner_destroy (NULL = nothing to free)
+} scanner;
+
+// No checkpoint is active
+#define SCANNER_NO_PIN ((size_t)-1)
+
+// A position to roll back to (see scanner_mark)
+typedef struct scanner_checkpoint {
+    size_t offset;   // Input offset of the checkpoint
+    size_t prev_pin; // Pin of the enclosing checkpoint
+} scanner_checkpoint;
+
+// Every entry point keeps its state in the call or in the scanner it is
+// given, so threads can scan their own inputs concurrently without locks
+int my_scanf(const char *format, ...);
+int my_fscanf(FILE *stream, const char *format, ...);
+int my_sscanf(const char *str, const char *format, ...);
+int my_dscanf(int fd, const char *format, ...);
+int my_mscanf(scanner *sc, size_t *consumed, const char *format, ...);
+int my_vscanf(const char *format, va_list args);
+int my_vfscanf(FILE *stream, const char *format, va_list args);
+int my_vsscanf(const char *str, const char *format, va_list args);
+int my_vdscanf(int fd, const char *format, va_list args);
+
+// All-or-nothing variants: the whole format matches, or 0 is returned and the
+// input is left where it was
+int my_try_scanf(const char *format, ...);
+int my_try_fscanf(FILE *stream, const char *format, ...);
+int my_vtry_fscanf(FILE *stream, const char *format, va_list args);
+
+// Scanner setup
+int scanner_init_file(scanner *sc, FILE *stream, size_t capacity);
+void scanner_attach_stream(scanner *sc, FILE *stream, char *buf, size_t capacity);
+int scanner_init_fd(scanner *sc, int fd, size_t capacity);
+int scanner_init_readahead(scanner *sc, int fd, size_t chunk_size, int chunks);
+void scanner_init_memory(scanner *sc, const char *data, size_t len);
+int scanner_map_file(scanner *sc, const char *path);
+size_t scanner_offset(const scanner *sc);
+int scanner_sync(scanner *sc);
+int scanner_seek(scanner *sc, size_t offset);
+void scanner_destroy(scanner *sc);
+int scanner_refill(scanner *sc);
+
+// Arenas
+void scan_arena_init(scan_arena *arena, size_t block_size);
+char *scan_arena_alloc(scan_arena *arena, size_t n);
+void scan_arena_reset(scan_arena *arena);
+void scan_arena_destroy(scan_arena *arena);
+void scanner_set_arena(scanner *sc, scan_arena *arena);
+
+// Scanning from an explicit scanner
+int scanner_scanf(scanner *sc, const char *format, ...);
+int scanner_vscanf(scanner *sc, const char *format, va_list args);
+int scanner_try_scanf(scanner *sc, const char *format, ...);
+int scanner_vtry_scanf(scanner *sc, const char *format, va_list args);
+
+// Checkpoints: speculative scanning without rereading the source
+scanner_checkpoint scanner_mark(scanner *sc);
+void scanner_commit(scanner *sc, scanner_checkpoint cp);
+void scanner_rollback(scanner *sc, scanner_checkpoint cp);
+
+// A compiled format: the format string is parsed once into a flat op array
+enum scan_op_kind {
+    SCAN_OP_LITERAL,    // Match lit_off/len bytes of the literal pool
+    SCAN_OP_SKIP_WS,    // Skip whitespace (trailing whitespace in the format)
+    SCAN_OP_CONVERT,    // Run conversion conv and assign the next argument
+    SCAN_OP_SKIP_FIELD, // Suppressed conversion (%*d): consume the field, assign nothing
+    SCAN_OP_STOP        // Unknown conversion: stop scanning
+};
+
+// Length modifiers, e.g. the "ll" in %lld
+enum scan_length {
+    SCAN_LEN_NONE,
+    SCAN_LEN_HH,
+    SCAN_LEN_H,
+    SCAN_LEN_L,
+    SCAN_LEN_LL,
+    SCAN_LEN_J,
+    SCAN_LEN_Z,
+    SCAN_LEN_T,
+    SCAN_LEN_BIG_L
+};
+
+typedef struct scan_op {
+    unsigned char kind;    // enum scan_op_kind
+    unsigned char conv;    // Conversion character for SCAN_OP_CONVERT
+    unsigned char length;  // enum scan_length
+    unsigned char skip_ws; // Skip whitespace before running this op
+    unsigned char alloc;   // 'm' modifier: allocate the string and store a char *
+    unsigned int len;      // Literal length
+    unsigned int width;    // Maximum field width for conversions (0 = none)
+    size_t lit_off;        // Literal offset into the program's literal pool, or set index for %[
+} scan_op;
+
+typedef struct scan_program {
+    scan_op *ops;
+    int count;
+    scan_set *sets;       // Scansets referenced by %[ ops
+    const char *literals; // Merged literal bytes referenced by SCAN_OP_LITERAL
+    char *format;         // Copy of the source format
+} scan_program;
+
+scan_program *scan_compile(const char *format);
+void scan_program_free(scan_program *prog);
+int scan_exec(scanner *sc, const scan_program *prog, ...);
+int scan_vexec(scanner *sc, const scan_program *prog, va_list args);
+int scan_exec_op(scanner *sc, const scan_program *prog, const scan_op *op, void *dst);
+
+// Batch scanning: conversion i of row r is stored at base + r * stride.
+// Columnar (SoA) arrays use the element size as the stride; for an array of
+// structs (AoS) base points at the first record's field (offsetof) and the
+// stride is the struct size.
+typedef struct scan_column {
+    void *base;
+    size_t stride;
+} scan_column;
+
+// Error offset reported when a batch stopped without a malformed row
+#define SCAN_NO_ERROR ((size_t)-1)
+
+size_t scan_batch(scanner *sc, const scan_program *prog, const scan_column *columns,
+                  size_t rows, size_t *error_offset);
+size_t scanner_batch(scanner *sc, const char *format, const scan_column *columns,
+                     size_t rows, size_t *error_offset);
+int scan_exec_row(scanner *sc, const scan_program *prog, const scan_column *columns, size_t row,
+                  int *complete);
+
+// Conversion table: every conversion, built-in or registered, is one entry of
+// a 256-slot table indexed by scan_op.conv. A custom conversion is registered
+// under a spare character (%q) or a name (%{ipv4}); named ones get slots
+// 128-255. Register before the formats that use them are first scanned; a
+// format compiled earlier keeps treating the specifier as unknown.
+typedef int (*scan_convert_fn)(scanner *sc, const scan_program *prog, const scan_op *op, void *dst);
+typedef int (*scan_skip_fn)(scanner *sc, const scan_program *prog, const scan_op *op);
+// Converts up to rows consecutive fields, storing field r at dst + r * stride.
+// Returns how many it stored; on a field it cannot convert it stops with sc
+// on that field's first byte (after the whitespace before it).
+typedef size_t (*scan_batch_fn)(scanner *sc, const scan_op *op, char *dst, size_t stride,
+                                size_t rows);
+
+// Converter flags
+#define SCAN_CONV_WIDTH    0x01 // Takes a field width (op->width)
+#define SCAN_CONV_LENGTH   0x02 // Takes length modifiers (op->length)
+#define SCAN_CONV_ALLOC    0x04 // Takes the 'm' modifier (op->alloc)
+#define SCAN_CONV_SKIPS_WS 0x08 // Skips leading whitespace itself
+#define SCAN_CONV_KEEP_WS  0x10 // Reads leading whitespace as data, like %c
+#define SCAN_CONV_BUILTIN  0x20 // One of the library's own (set by the library)
+
+// Without SKIPS_WS or KEEP_WS, leading whitespace is skipped before convert runs
+typedef struct scan_converter {
+    scan_convert_fn convert; // Stores one field through dst, a pointer to `size` bytes
+    scan_skip_fn skip;       // %* form, or NULL to convert into scratch space
+    scan_batch_fn batch;     // Optional bulk form, used by scan_batch for one-field rows
+    size_t size;             // Size of the destination object (at most SCAN_CONV_SCRATCH without skip)
+    unsigned int flags;
+} scan_converter;
+
+// Largest destination a converter without a skip function may declare
+#define SCAN_CONV_SCRATCH 256
+
+int scan_register(int spec, const scan_converter *conv);
+int scan_register_name(const char *name, const scan_converter *conv);
+const scan_converter *scan_converter_for(unsigned char conv);
+
+// Parallel batch scanning of newline-delimited input, one record per line
+// (scan_parallel.c). Rows land in the columns in input order.
+int scan_parallel(const char *data, size_t len, const char *format, const scan_column *columns,
+                  size_t max_rows, int threads, size_t *rows, size_t *error_offset);
+int scan_parallel_file(const char *path, const char *format, const scan_column *columns,
+                       size_t max_rows, int threads, size_t *rows, size_t *error_offset);
+
+// Push-style scanning (scan_push.c) for input that arrives in fragments, e.g.
+// from a non-blocking socket. Bytes are fed as they come; scan_push_next
+// parses whole records into the destinations given at init and reports when
+// it needs more input. A field cut off mid-token waits until its end arrives,
+// and fields already parsed are never scanned again. After SCAN_PUSH_ERROR the
+// rest of the malformed line is skipped and scanning goes on with the next.
+enum scan_push_status {
+    SCAN_PUSH_RECORD,    // A full record was stored into the destinations
+    SCAN_PUSH_NEED_MORE, // Everything buffered was used; feed more bytes
+    SCAN_PUSH_END,       // Finished and no input left
+    SCAN_PUSH_ERROR      // Malformed record at scan_push_offset (or out of memory)
+};
+
+typedef struct scan_push {
+    scan_program *prog;
+    void **dsts;       // Destination of each conversion
+    char *buf;         // Bytes fed but not yet consumed start at pos
+    size_t len;        // Bytes in buf
+    size_t cap;        // Size of buf
+    size_t pos;        // Start of the next op's input
+    size_t probe;      // Bytes before this were already checked for the end of the next token
+    size_t base;       // Input offset of buf[0]
+    size_t record;     // Input offset where the current record started
+    int op;            // Next op of the current record
+    int stored;        // Conversions stored for the current record
+    int finished;      // scan_push_finish was called
+    int skipping;      // Dropping the rest of a malformed line
+} scan_push;
+
+int scan_push_init(scan_push *ps, const char *format, ...);
+int scan_push_feed(scan_push *ps, const char *data, size_t len);
+void scan_push_finish(scan_push *ps);
+enum scan_push_status scan_push_next(scan_push *ps);
+size_t scan_push_offset(const scan_push *ps);
+void scan_push_destroy(scan_push *ps);
+
+// Line-record iteration (scan_lines.c) for ingest that must keep going past
+// bad rows. Each line is located first with the vector newline search and
+// then scanned on its own, so a malformed line is counted, skipped without
+// rescanning, and cannot eat into the next one. Blank lines are skipped.
+enum scan_line_status {
+    SCAN_LINE_OK,       // The format matched the whole line
+    SCAN_LINE_REJECTED, // The line did not match or had text left over; fields holds the conversions stored
+    SCAN_LINE_END,      // No lines left
+    SCAN_LINE_ERROR     // A line outgrew the buffer and it could not grow
+};
+
+typedef struct scan_lines {
+    scanner *sc;
+    scan_program *prog;
+    scan_column *dsts; // Destination of each conversion (stride 0)
+    scanner view;      // Memory scanner over the current line
+    int conversions;   // Conversions in the format
+    int fields;        // Conversions stored for the last line
+    const char *line;  // Text of the last line, without its newline (valid until the next call)
+    size_t len;        // Length of that text
+    size_t offset;     // Input offset of the last line
+    size_t number;     // Line number of the last line, from 1, counting blank lines
+    size_t accepted;   // Lines that matched so far
+    size_t rejected;   // Lines that did not
+} scan_lines;
+
+int scan_lines_init(scan_lines *it, scanner *sc, const char *format, ...);
+enum scan_line_status scan_lines_next(scan_lines *it);
+void scan_lines_destroy(scan_lines *it);
+
+// Sparse record-offset index (scan_index.c) for random access into large
+// newline-delimited files. Records are the non-blank lines, numbered from 0
+// like the rows of scan_parallel. Every stride-th record's offset is kept with
+// a hash of its first bytes; the index is saved to disk and reused while the
+// file's size, mtime and inode are unchanged.
+#define SCAN_INDEX_DEFAULT_STRIDE 1024
+
+typedef struct scan_index {
+    uint64_t *offsets;   // offsets[i]: offset of record i * stride (its first non-whitespace byte)
+    uint32_t *checks;    // Hash of the first bytes of each of those records
+    size_t entries;      // Entries in both arrays
+    size_t records;      // Records in the file
+    unsigned int stride; // Records per entry
+    uint64_t file_size;  // Identity of the indexed file
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint64_t inode;
+} scan_index;
+
+int scan_index_build(scan_index *index, const char *path, unsigned int stride);
+int scan_index_save(const scan_index *index, const char *index_path);
+int scan_index_load(scan_index *index, const char *index_path, const char *path);
+int scan_index_open(scan_index *index, const char *path, const char *index_path,
+                    unsigned int stride);
+int scan_index_seek(const scan_index *index, scanner *sc, size_t record);
+void scan_index_destroy(scan_index *index);
+
+// Result of the zero-copy %v conversion: a token inside the scanner's input
+typedef struct scan_view {
+    const char *ptr;
+    size_t len;
+} scan_view;
+
+// Result of the %N conversion: a number tagged with the form it was written in
+enum scan_number_kind {
+    SCAN_NUMBER_DECIMAL, // 1010, -42
+    SCAN_NUMBER_OCTAL,   // 017
+    SCAN_NUMBER_HEX,     // 0x1F, x10, BEEF
+    SCAN_NUMBER_BINARY,  // 0b101
+    SCAN_NUMBER_FLOAT    // 39e-5, 1.5, .5
+};
+
+typedef struct scan_number {
+    enum scan_number_kind kind;
+    union {
+        long long i; // Integer kinds
+        double f;    // SCAN_NUMBER_FLOAT
+    };
+} scan_number;
+
+// Intern table behind %W: every distinct word gets an ID, numbered from 0 in
+// order of first appearance, and one canonical null-terminated copy
+typedef struct scan_intern_slot {
+    uint32_t hash; // Low 32 bits of the word's hash
+    uint32_t id;   // Word ID + 1, or 0 for an empty slot
+} scan_intern_slot;
+
+struct scan_intern {
+    scan_intern_slot *slots; // Open-addressing index, at most half full
+    size_t mask;             // Slot count - 1 (a power of two minus one)
+    scan_view *words;        // Canonical copy of each word, indexed by ID
+    unsigned int count;      // Distinct words so far
+    unsigned int capacity;   // Entries allocated in words
+    scan_arena strings;      // Storage for the canonical copies
+};
+
+int scan_intern_init(scan_intern *table, size_t expected);
+int scan_intern_add(scan_intern *table, const char *p, size_t len, unsigned int *id);
+const char *scan_intern_string(const scan_intern *table, unsigned int id);
+void scan_intern_destroy(scan_intern *table);
+void scanner_set_intern(scanner *sc, scan_intern *table);
+uint64_t scan_hash(const char *p, size_t len);
+
+// Returns the next byte and consumes it, or EOF
+static inline int scanner_getc(scanner *sc) {
+    if (sc->cur == sc->end && !scanner_refill(sc)) {
+        return EOF;
+    }
+    return (unsigned char)*sc->cur++;
+}
+
+// Returns the next byte without consuming it, or EOF
+static inline int scanner_peek(scanner *sc) {
+    if (sc->cur == sc->end && !scanner_refill(sc)) {
+        return EOF;
+    }
+    return (unsigned char)*sc->cur;
+}
+
+// Consumes n bytes that are already buffered (e.g. after a successful peek)
+static inline void scanner_advance(scanner *sc, size_t n) {
+    sc->cur += n;
+}
+
+// Puts back the byte most recently returned by scanner_getc (no-op for EOF, like ungetc)
+static inline void scanner_ungetc(scanner *sc, int c) {
+    if (c != EOF) {
+        sc->cur--;
+    }
+}
+
+// Core helper functions
+int read_int(scanner *sc, int *value);
+int read_signed(scanner *sc, int length, long long *value);
+int read_unsigned(scanner *sc, int length, unsigned long long *value);
+int read_char(scanner *sc, char *c);
+int read_string(scanner *sc, char *str);
+int read_string_bounded(scanner *sc, char *str, size_t width);
+int read_chars(scanner *sc, char *str, size_t width);
+int read_view(scanner *sc, scan_view *view, size_t width);
+int read_scanset(scanner *sc, char *str, const scan_set *set, size_t width);
+int read_string_alloc(scanner *sc, char **str, size_t width);
+int read_word_alloc(scanner *sc, char **str, size_t width);
+int read_scanset_alloc(scanner *sc, char **str, const scan_set *set, size_t width);
+int read_double(scanner *sc, double *value);
+int read_float(scanner *sc, float *value);
+int read_long_double(scanner *sc, long double *value);
+int read_hex(scanner *sc, unsigned int *value);
+int read_binary(scanner *sc, unsigned int *value);
+int read_hex_unsigned(scanner *sc, int length, unsigned long long *value);
+int read_binary_unsigned(scanner *sc, int length, unsigned long long *value);
+int read_roman(scanner *sc, int *value);
+int read_word(scanner *sc, char *str);
+int read_word_bounded(scanner *sc, char *str, size_t width);
+int read_word_intern(scanner *sc, unsigned int *id, size_t width);
+int read_number(scanner *sc, scan_number *number);
+
+// Skip paths of suppressed conversions (%*d): consume what the matching
+// read_* would, without computing a value
+size_t skip_digits(scanner *sc, int radix); // 0 = roman digits
+int skip_decimal(scanner *sc);
+int skip_hex(scanner *sc);
+int skip_binary(scanner *sc);
+int skip_roman(scanner *sc);
+int skip_float(scanner *sc);
+int skip_chars(scanner *sc, size_t width);
+int skip_string(scanner *sc, size_t width);
+int skip_word(scanner *sc, size_t width);
+int skip_scanset(scanner *sc, const scan_set *set, size_t width);
+int skip_number(scanner *sc);
+
+// Ancillary helper functions
+void skip_whitespace(scanner *sc);
+int is_whitespace(int c);
+int is_digit(int c);
+int is_hex_digit(int c);
+int hex_to_int(int c);
+int is_binary_digit(int c);
+int roman_to_int(char c);
+int is_roman_digit(int c);
+int is_word_char(int c);
+
+#endif
@@ -0,0 +1,114 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "my_scanf.h"
+
+// Bump-pointer arena for the strings of allocating conversions (%ms, %mw,
+// %m[...]). Strings are carved out of large blocks one after another, so a
+// record loader holding millions of short strings pays one malloc per block
+// instead of one per string, with no per-string header and no fragmentation.
+// Everything is released at once by scan_arena_reset or scan_arena_destroy.
+// Allocations are byte aligned, since they only ever hold strings. An arena
+// belongs to one thread at a time.
+
+struct scan_arena_block {
+    struct scan_arena_block *next;
+    size_t size; // Bytes in data
+    char data[];
+};
+
+// Sets up an empty arena; the first block is allocated on first use.
+// block_size 0 selects SCAN_ARENA_DEFAULT_BLOCK.
+void scan_arena_init(scan_arena *arena, size_t block_size) {
+    arena->blocks = NULL;
+    arena->next = NULL;
+    arena->limit = NULL;
+    arena->block_size = (block_size != 0) ? block_size : SCAN_ARENA_DEFAULT_BLOCK;
+    arena->used = 0;
+}
+
+static scan_arena_block *new_block(size_t size) {
+    scan_arena_block *block = malloc(sizeof(scan_arena_block) + size);
+    if (block != NULL) {
+        block->size = size;
+    }
+    return block;
+}
+
+// Returns n bytes from the arena, or NULL if out of memory
+char *scan_arena_alloc(scan_arena *arena, size_t n) {
+    if ((size_t)(arena->limit - arena->next) >= n) {
+        char *p = arena->next;
+        arena->next += n;
+        arena->used += n;
+        return p;
+    }
+
+    if (n > arena->block_size / 4 && arena->blocks != NULL) {
+        // A big string gets a block of its own behind the current one, so the
+        // space left in the current block is not thrown away
+        scan_arena_block *block = new_block(n);
+        if (block == NULL) {
+            return NULL;
+        }
+        block->next = arena->blocks->next;
+        arena->blocks->next = block;
+        arena->used += n;
+        return block->data;
+    }
+
+    // Start a new current block
+    scan_arena_block *block = new_block(n > arena->block_size ? n : arena->block_size);
+    if (block == NULL) {
+        return NULL;
+    }
+    block->next = arena->blocks;
+    arena->blocks = block;
+    arena->next = block->data + n;
+    arena->limit = block->data + block->size;
+    arena->used += n;
+    return block->data;
+}
+
+// Releases every string at once. One regular block is kept for reuse, so an
+// arena reset after each batch settles into no mallocs at all.
+void scan_arena_reset(scan_arena *arena) {
+    scan_arena_block *keep = NULL;
+    scan_arena_block *block = arena->blocks;
+    while (block != NULL) {
+        scan_arena_block *next = block->next;
+        if (keep == NULL && block->size == arena->block_size) {
+            keep = block;
+        } else {
+            free(block);
+        }
+        block = next;
+    }
+
+    arena->blocks = keep;
+    if (keep != NULL) {
+        keep->next = NULL;
+        arena->next = keep->data;
+        arena->limit = keep->data + keep->size;
+    } else {
+        arena->next = NULL;
+        arena->limit = NULL;
+    }
+    arena->used = 0;
+}
+
+void scan_arena_destroy(scan_arena *arena) {
+    scan_arena_block *block = arena->blocks;
+    while (block != NULL) {
+        scan_arena_block *next = block->next;
+        free(block);
+        block = next;
+    }
+    scan_arena_init(arena, arena->block_size);
+}
+
+// Strings from allocating conversions on sc come from arena from now on
+// (NULL = malloc each one, like POSIX %ms; the caller frees them)
+void scanner_set_arena(scanner *sc, scan_arena *arena) {
+    sc->arena = arena;
+}
@@ -0,0 +1,448 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "my_scanf.h"
+
+// Build-time parser generator. Reads a list of named format strings and writes
+// one C function per format with every op of the compiled program spelled out:
+// typed pointer parameters instead of va_arg, direct read_* calls instead of
+// the conversion switch, and literals matched with fixed comparisons. The
+// formats go through scan_compile, so a generated parser sees exactly the ops
+// scan_exec would run and behaves like my_scanf for the same format.
+//
+// Input, one format per line (blank lines and lines starting with # skipped):
+//     name "format"
+// with \n, \t, \\ and \" escapes inside the quotes. Each becomes
+//     int scan_<name>(scanner *sc, <one pointer per conversion>);
+//
+// Usage: scan_codegen formats.txt scan_generated.h scan_generated.c
+
+#define MAX_LINE 4096
+
+int parse_line(char *line, char **name, char *format);
+void emit_header_prototype(FILE *out, const char *name, const scan_program *prog);
+void emit_function(FILE *out, const char *name, const scan_program *prog);
+void emit_signature(FILE *out, const char *name, const scan_program *prog);
+void emit_c_string(FILE *out, const char *s, size_t len);
+const char *arg_type(const scan_op *op);
+
+int main(int argc, char **argv) {
+    if (argc != 4) {
+        fprintf(stderr, "usage: %s formats.txt out.h out.c\n", argv[0]);
+        return 1;
+    }
+    FILE *in = fopen(argv[1], "r");
+    FILE *header = fopen(argv[2], "w");
+    FILE *source = fopen(argv[3], "w");
+    if (in == NULL || header == NULL || source == NULL) {
+        fprintf(stderr, "scan_codegen: cannot open files\n");
+        return 1;
+    }
+
+    // Step 1: File prologues
+    const char *slash = strrchr(argv[2], '/');
+    const char *header_name = (slash != NULL) ? slash + 1 : argv[2];
+    fprintf(header, "// Generated by scan_codegen from %s. Do not edit.\n", argv[1]);
+    fprintf(header, "#ifndef SCAN_GENERATED_H\n#define SCAN_GENERATED_H\n\n");
+    fprintf(header, "#include <stdint.h>\n#include <sys/types.h>\n\n#include \"my_scanf.h\"\n\n");
+    fprintf(source, "// Generated by scan_codegen from %s. Do not edit.\n", argv[1]);
+    fprintf(source, "#include <string.h>\n\n#include \"%s\"\n", header_name);
+
+    // Step 2: One function per format line
+    char line[MAX_LINE];
+    char format[MAX_LINE];
+    int line_number = 0;
+    int status = 0;
+    while (fgets(line, sizeof(line), in) != NULL) {
+        line_number++;
+        char *name;
+        int kind = parse_line(line, &name, format);
+        if (kind == 0) {
+            continue; // Blank or comment
+        }
+        if (kind < 0) {
+            fprintf(stderr, "%s:%d: expected: name \"format\"\n", argv[1], line_number);
+            status = 1;
+            continue;
+        }
+
+        scan_program *prog = scan_compile(format);
+        if (prog == NULL) {
+            fprintf(stderr, "scan_codegen: out of memory\n");
+            return 1;
+        }
+        emit_header_prototype(header, name, prog);
+        emit_function(source, name, prog);
+        scan_program_free(prog);
+    }
+
+    fprintf(header, "\n#endif\n");
+    fclose(in);
+    fclose(header);
+    fclose(source);
+    return status;
+}
+
+// Splits a line into a C identifier and an unescaped format. Returns 1 for a
+// format line, 0 for a blank or comment line, -1 for anything else.
+int parse_line(char *line, char **name, char *format) {
+    char *p = line;
+    while (is_whitespace(*p)) {
+        p++;
+    }
+    if (*p == '\0' || *p == '#') {
+        return 0;
+    }
+
+    *name = p;
+    while (is_word_char(*p)) {
+        p++;
+    }
+    if (p == *name || is_digit(**name) || !is_whitespace(*p)) {
+        return -1;
+    }
+    *p++ = '\0';
+    while (is_whitespace(*p)) {
+        p++;
+    }
+    if (*p++ != '"') {
+        return -1;
+    }
+
+    size_t len = 0;
+    while (*p != '"') {
+        if (*p == '\0') {
+            return -1; // No closing quote
+        }
+        if (*p == '\\') {
+            p++;
+            switch (*p) {
+                case 'n': format[len++] = '\n'; break;
+                case 't': format[len++] = '\t'; break;
+                case '\\': format[len++] = '\\'; break;
+                case '"': format[len++] = '"'; break;
+                default: return -1;
+            }
+            p++;
+            continue;
+        }
+        format[len++] = *p++;
+    }
+    format[len] = '\0';
+    return 1;
+}
+
+// EMITTERS //
+
+// Pointer type a conversion stores through, matching store_signed/store_unsigned
+const char *arg_type(const scan_op *op) {
+    if (op->alloc) {
+        return "char *"; // %ms stores a pointer to the new string
+    }
+    switch (op->conv) {
+        case 'd':
+            switch (op->length) {
+                case SCAN_LEN_HH: return "signed char";
+                case SCAN_LEN_H:  return "short";
+                case SCAN_LEN_L:  return "long";
+                case SCAN_LEN_LL: return "long long";
+                case SCAN_LEN_J:  return "intmax_t";
+                case SCAN_LEN_Z:  return "ssize_t";
+                case SCAN_LEN_T:  return "ptrdiff_t";
+                default:          return "int";
+            }
+        case 'u':
+        case 'x':
+        case 'b':
+            switch (op->length) {
+                case SCAN_LEN_HH: return "unsigned char";
+                case SCAN_LEN_H:  return "unsigned short";
+                case SCAN_LEN_L:  return "unsigned long";
+                case SCAN_LEN_LL: return "unsigned long long";
+                case SCAN_LEN_J:  return "uintmax_t";
+                case SCAN_LEN_Z:  return "size_t";
+                case SCAN_LEN_T:  return "ptrdiff_t";
+                default:          return "unsigned int";
+            }
+        case 'c':
+        case 's':
+        case 'w':
+        case '[':
+            return "char";
+        case 'r':
+            return "int";
+        case 'W':
+            return "unsigned int";
+        case 'v':
+            return "scan_view";
+        case 'N':
+            return "scan_number";
+        default:
+            // Floats: %f is a double, %hf a float, %Lf a long double
+            if (op->length == SCAN_LEN_H) {
+                return "float";
+            }
+            return (op->length == SCAN_LEN_BIG_L) ? "long double" : "double";
+    }
+}
+
+// Parameters stop at the first STOP op, like the arguments scan_exec would use
+void emit_signature(FILE *out, const char *name, const scan_program *prog) {
+    fprintf(out, "int scan_%s(scanner *sc", name);
+    int arg = 0;
+    for (int i = 0; i < prog->count && prog->ops[i].kind != SCAN_OP_STOP; i++) {
+        if (prog->ops[i].kind == SCAN_OP_CONVERT) {
+            const char *type = arg_type(&prog->ops[i]);
+            const char *gap = (type[strlen(type) - 1] == '*') ? "" : " ";
+            fprintf(out, ", %s%s*a%d", type, gap, arg++);
+        }
+    }
+    fprintf(out, ")");
+}
+
+void emit_header_prototype(FILE *out, const char *name, const scan_program *prog) {
+    fprintf(out, "// ");
+    emit_c_string(out, prog->format, strlen(prog->format));
+    fprintf(out, "\n");
+    emit_signature(out, name, prog);
+    fprintf(out, ";\n");
+}
+
+// Writes bytes as a C string literal. Octal escapes are always three digits
+// so a following digit is never absorbed.
+void emit_c_string(FILE *out, const char *s, size_t len) {
+    fputc('"', out);
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c == '"' || c == '\\') {
+            fprintf(out, "\\%c", c);
+        } else if (c == '\n') {
+            fprintf(out, "\\n");
+        } else if (c == '\t') {
+            fprintf(out, "\\t");
+        } else if (c < 32 || c >= 127 || c == '?') {
+            fprintf(out, "\\%03o", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+// Writes one byte as a C character constant
+static void emit_c_char(FILE *out, unsigned char c) {
+    if (c == '\'' || c == '\\') {
+        fprintf(out, "'\\%c'", c);
+    } else if (c < 32 || c >= 127) {
+        fprintf(out, "'\\%03o'", c);
+    } else {
+        fprintf(out, "'%c'", c);
+    }
+}
+
+// Writes a byte array initializer, 16 bytes per line
+static void emit_table(FILE *out, const uint8_t *bytes, int n) {
+    fprintf(out, "{");
+    for (int i = 0; i < n; i++) {
+        const char *sep = (i == 0) ? "" : (i % 16 == 0) ? ",\n     " : ", ";
+        fprintf(out, "%s0x%02x", sep, bytes[i]);
+    }
+    fprintf(out, "}");
+}
+
+static const char *length_names[] = {
+    "SCAN_LEN_NONE", "SCAN_LEN_HH", "SCAN_LEN_H", "SCAN_LEN_L", "SCAN_LEN_LL",
+    "SCAN_LEN_J", "SCAN_LEN_Z", "SCAN_LEN_T", "SCAN_LEN_BIG_L"
+};
+
+// Emits the body of one conversion, returning `stored` on failure
+static void emit_convert(FILE *out, const char *name, const scan_op *op, int arg, int stored) {
+    const char *fail = "        return %d;\n";
+    switch (op->conv) {
+        case 'd':
+            fprintf(out, "    {\n        long long value;\n");
+            fprintf(out, "        if (!read_signed(sc, %s, &value)) {\n", length_names[op->length]);
+            fprintf(out, "    ");
+            fprintf(out, fail, stored);
+            fprintf(out, "        }\n        *a%d = (%s)value;\n    }\n", arg, arg_type(op));
+            return;
+        case 'u':
+        case 'x':
+        case 'b': {
+            const char *reader = (op->conv == 'u') ? "read_unsigned"
+                               : (op->conv == 'x') ? "read_hex_unsigned" : "read_binary_unsigned";
+            fprintf(out, "    {\n        unsigned long long value;\n");
+            fprintf(out, "        if (!%s(sc, %s, &value)) {\n", reader, length_names[op->length]);
+            fprintf(out, "    ");
+            fprintf(out, fail, stored);
+            fprintf(out, "        }\n        *a%d = (%s)value;\n    }\n", arg, arg_type(op));
+            return;
+        }
+        default:
+            break;
+    }
+
+    // The rest store straight through the pointer
+    fprintf(out, "    if (!");
+    switch (op->conv) {
+        case 'c':
+            if (op->width > 1) {
+                fprintf(out, "read_chars(sc, a%d, %u)", arg, op->width);
+            } else {
+                fprintf(out, "read_char(sc, a%d)", arg);
+            }
+            break;
+        case 's':
+            fprintf(out, "read_string_%s(sc, a%d, %u)", op->alloc ? "alloc" : "bounded", arg,
+                    op->width);
+            break;
+        case 'w':
+            fprintf(out, "read_word_%s(sc, a%d, %u)", op->alloc ? "alloc" : "bounded", arg,
+                    op->width);
+            break;
+        case 'W':
+            fprintf(out, "read_word_intern(sc, a%d, %u)", arg, op->width);
+            break;
+        case 'v':
+            fprintf(out, "read_view(sc, a%d, %u)", arg, op->width);
+            break;
+        case '[':
+            fprintf(out, "read_scanset%s(sc, a%d, &scan_%s_set%zu, %u)", op->alloc ? "_alloc" : "",
+                    arg, name, op->lit_off, op->width);
+            break;
+        case 'r':
+            fprintf(out, "read_roman(sc, a%d)", arg);
+            break;
+        case 'N':
+            fprintf(out, "read_number(sc, a%d)", arg);
+            break;
+        default:
+            if (op->length == SCAN_LEN_H) {
+                fprintf(out, "read_float(sc, a%d)", arg);
+            } else if (op->length == SCAN_LEN_BIG_L) {
+                fprintf(out, "read_long_double(sc, a%d)", arg);
+            } else {
+                fprintf(out, "read_double(sc, a%d)", arg);
+            }
+            break;
+    }
+    fprintf(out, ") {\n");
+    fprintf(out, fail, stored);
+    fprintf(out, "    }\n");
+}
+
+// Emits a literal run. A buffered run is compared in one memcmp; otherwise
+// bytes are read one by one and the first mismatch is consumed, as in
+// match_literal.
+static void emit_literal(FILE *out, const scan_program *prog, const scan_op *op, int stored) {
+    const char *lit = prog->literals + op->lit_off;
+    if (op->len == 1) {
+        fprintf(out, "    if (scanner_getc(sc) != ");
+        emit_c_char(out, (unsigned char)lit[0]);
+        fprintf(out, ") {\n        return %d;\n    }\n", stored);
+        return;
+    }
+
+    fprintf(out, "    if (sc->end - sc->cur >= %u && memcmp(sc->cur, ", op->len);
+    emit_c_string(out, lit, op->len);
+    fprintf(out, ", %u) == 0) {\n        scanner_advance(sc, %u);\n    } else if (", op->len,
+            op->len);
+    for (unsigned int k = 0; k < op->len; k++) {
+        fprintf(out, "%sscanner_getc(sc) != ", (k == 0) ? "" : " ||\n               ");
+        emit_c_char(out, (unsigned char)lit[k]);
+    }
+    fprintf(out, ") {\n        return %d;\n    }\n", stored);
+}
+
+// Emits the skip path of a suppressed conversion, returning `stored` on failure
+static void emit_skip(FILE *out, const char *name, const scan_op *op, int stored) {
+    fprintf(out, "    if (!");
+    switch (op->conv) {
+        case 'c':
+            fprintf(out, "skip_chars(sc, %u)", op->width);
+            break;
+        case 'd':
+        case 'u':
+            fprintf(out, "skip_decimal(sc)");
+            break;
+        case 's':
+        case 'v':
+            fprintf(out, "skip_string(sc, %u)", op->width);
+            break;
+        case 'x':
+            fprintf(out, "skip_hex(sc)");
+            break;
+        case 'b':
+            fprintf(out, "skip_binary(sc)");
+            break;
+        case 'r':
+            fprintf(out, "skip_roman(sc)");
+            break;
+        case 'w':
+        case 'W':
+            fprintf(out, "skip_word(sc, %u)", op->width);
+            break;
+        case 'N':
+            fprintf(out, "skip_number(sc)");
+            break;
+        case '[':
+            fprintf(out, "skip_scanset(sc, &scan_%s_set%zu, %u)", name, op->lit_off, op->width);
+            break;
+        default:
+            fprintf(out, "skip_float(sc)");
+            break;
+    }
+    fprintf(out, ") {\n        return %d;\n    }\n", stored);
+}
+
+void emit_function(FILE *out, const char *name, const scan_program *prog) {
+    // Scansets become constant tables next to their function
+    for (int i = 0; i < prog->count; i++) {
+        const scan_op *op = &prog->ops[i];
+        if ((op->kind == SCAN_OP_CONVERT || op->kind == SCAN_OP_SKIP_FIELD) && op->conv == '[') {
+            const scan_set *set = &prog->sets[op->lit_off];
+            fprintf(out, "\nstatic const scan_set scan_%s_set%zu = {\n    ", name, op->lit_off);
+            emit_table(out, set->bitmap, 32);
+            fprintf(out, ",\n    ");
+            emit_table(out, set->low, 16);
+            fprintf(out, ",\n    ");
+            emit_table(out, set->high, 16);
+            fprintf(out, "\n};\n");
+        }
+    }
+
+    fprintf(out, "\n// ");
+    emit_c_string(out, prog->format, strlen(prog->format));
+    fprintf(out, "\n");
+    emit_signature(out, name, prog);
+    fprintf(out, " {\n");
+
+    int stored = 0;
+    for (int i = 0; i < prog->count; i++) {
+        const scan_op *op = &prog->ops[i];
+        if (op->skip_ws) {
+            fprintf(out, "    skip_whitespace(sc);\n");
+        }
+        switch (op->kind) {
+            case SCAN_OP_LITERAL:
+                emit_literal(out, prog, op, stored);
+                break;
+            case SCAN_OP_SKIP_WS:
+                fprintf(out, "    skip_whitespace(sc);\n");
+                break;
+            case SCAN_OP_CONVERT:
+                emit_convert(out, name, op, stored, stored);
+                stored++;
+                break;
+            case SCAN_OP_SKIP_FIELD:
+                emit_skip(out, name, op, stored);
+                break;
+            default:
+                // Unknown specifier: scanning stops here, as in scan_exec
+                fprintf(out, "    return %d;\n}\n", stored);
+                return;
+        }
+    }
+    fprintf(out, "    return %d;\n}\n", stored);
+}
@@ -0,0 +1,343 @@
+// Generated by scan_codegen from formats.txt. Do not edit.
+#include <string.h>
+
+#include "scan_generated.h"
+
+// "(%d, %d)"
+int scan_point(scanner *sc, int *a0, int *a1) {
+    if (scanner_getc(sc) != '(') {
+        return 0;
+    }
+    {
+        long long value;
+        if (!read_signed(sc, SCAN_LEN_NONE, &value)) {
+            return 0;
+        }
+        *a0 = (int)value;
+    }
+    if (scanner_getc(sc) != ',') {
+        return 1;
+    }
+    {
+        long long value;
+        if (!read_signed(sc, SCAN_LEN_NONE, &value)) {
+            return 1;
+        }
+        *a1 = (int)value;
+    }
+    if (scanner_getc(sc) != ')') {
+        return 2;
+    }
+    return 2;
+}
+
+// "%d,%f %15s"
+int scan_record(scanner *sc, int *a0, double *a1, char *a2) {
+    {
+        long long value;
+        if (!read_signed(sc, SCAN_LEN_NONE, &value)) {
+            return 0;
+        }
+        *a0 = (int)value;
+    }
+    if (scanner_getc(sc) != ',') {
+        return 1;
+    }
+    if (!read_double(sc, a1)) {
+        return 1;
+    }
+    if (!read_string_bounded(sc, a2, 15)) {
+        return 2;
+    }
+    return 3;
+}
+
+// "%llx: %4c|%hu"
+int scan_dump_line(scanner *sc, unsigned long long *a0, char *a1, unsigned short *a2) {
+    {
+        unsigned long long value;
+        if (!read_hex_unsigned(sc, SCAN_LEN_LL, &value)) {
+            return 0;
+        }
+        *a0 = (unsigned long long)value;
+    }
+    if (scanner_getc(sc) != ':') {
+        return 1;
+    }
+    skip_whitespace(sc);
+    if (!read_chars(sc, a1, 4)) {
+        return 1;
+    }
+    if (scanner_getc(sc) != '|') {
+        return 2;
+    }
+    {
+        unsigned long long value;
+        if (!read_unsigned(sc, SCAN_LEN_H, &value)) {
+            return 2;
+        }
+        *a2 = (unsigned short)value;
+    }
+    return 3;
+}
+
+static const scan_set scan_csv_row_set0 = {
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xef, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+     0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfb, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff}
+};
+
+static const scan_set scan_csv_row_set1 = {
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xef, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+     0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfb, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff}
+};
+
+// "%31[^,],%31[^,],%hhd"
+int scan_csv_row(scanner *sc, char *a0, char *a1, signed char *a2) {
+    if (!read_scanset(sc, a0, &scan_csv_row_set0, 31)) {
+        return 0;
+    }
+    if (scanner_getc(sc) != ',') {
+        return 1;
+    }
+    if (!read_scanset(sc, a1, &scan_csv_row_set1, 31)) {
+        return 1;
+    }
+    if (scanner_getc(sc) != ',') {
+        return 2;
+    }
+    {
+        long long value;
+        if (!read_signed(sc, SCAN_LEN_HH, &value)) {
+            return 2;
+        }
+        *a2 = (signed char)value;
+    }
+    return 3;
+}
+
+// "id=%u name=%15w score=%lf%%"
+int scan_tagged(scanner *sc, unsigned int *a0, char *a1, double *a2) {
+    if (sc->end - sc->cur >= 3 && memcmp(sc->cur, "id=", 3) == 0) {
+        scanner_advance(sc, 3);
+    } else if (scanner_getc(sc) != 'i' ||
+               scanner_getc(sc) != 'd' ||
+               scanner_getc(sc) != '=') {
+        return 0;
+    }
+    {
+        unsigned long long value;
+        if (!read_unsigned(sc, SCAN_LEN_NONE, &value)) {
+            return 0;
+        }
+        *a0 = (unsigned int)value;
+    }
+    skip_whitespace(sc);
+    if (sc->end - sc->cur >= 5 && memcmp(sc->cur, "name=", 5) == 0) {
+        scanner_advance(sc, 5);
+    } else if (scanner_getc(sc) != 'n' ||
+               scanner_getc(sc) != 'a' ||
+               scanner_getc(sc) != 'm' ||
+               scanner_getc(sc) != 'e' ||
+               scanner_getc(sc) != '=') {
+        return 1;
+    }
+    if (!read_word_bounded(sc, a1, 15)) {
+        return 1;
+    }
+    skip_whitespace(sc);
+    if (sc->end - sc->cur >= 6 && memcmp(sc->cur, "score=", 6) == 0) {
+        scanner_advance(sc, 6);
+    } else if (scanner_getc(sc) != 's' ||
+               scanner_getc(sc) != 'c' ||
+               scanner_getc(sc) != 'o' ||
+               scanner_getc(sc) != 'r' ||
+               scanner_getc(sc) != 'e' ||
+               scanner_getc(sc) != '=') {
+        return 2;
+    }
+    if (!read_double(sc, a2)) {
+        return 2;
+    }
+    skip_whitespace(sc);
+    if (scanner_getc(sc) != '%') {
+        return 3;
+    }
+    return 3;
+}
+
+// "%r-%b %v"
+int scan_roman_entry(scanner *sc, int *a0, unsigned int *a1, scan_view *a2) {
+    if (!read_roman(sc, a0)) {
+        return 0;
+    }
+    if (scanner_getc(sc) != '-') {
+        return 1;
+    }
+    {
+        unsigned long long value;
+        if (!read_binary_unsigned(sc, SCAN_LEN_NONE, &value)) {
+            return 1;
+        }
+        *a1 = (unsigned int)value;
+    }
+    if (!read_view(sc, a2, 0)) {
+        return 2;
+    }
+    return 3;
+}
+
+// "%jd %zu %Lf %hf %ld\n"
+int scan_mixed_lengths(scanner *sc, intmax_t *a0, size_t *a1, long double *a2, float *a3, long *a4) {
+    {
+        long long value;
+        if (!read_signed(sc, SCAN_LEN_J, &value)) {
+            return 0;
+        }
+        *a0 = (intmax_t)value;
+    }
+    {
+        unsigned long long value;
+        if (!read_unsigned(sc, SCAN_LEN_Z, &value)) {
+            return 1;
+        }
+        *a1 = (size_t)value;
+    }
+    if (!read_long_double(sc, a2)) {
+        return 2;
+    }
+    if (!read_float(sc, a3)) {
+        return 3;
+    }
+    {
+        long long value;
+        if (!read_signed(sc, SCAN_LEN_L, &value)) {
+            return 4;
+        }
+        *a4 = (long)value;
+    }
+    skip_whitespace(sc);
+    return 5;
+}
+
+// "%d,%f"
+int scan_id_value(scanner *sc, int *a0, double *a1) {
+    {
+        long long value;
+        if (!read_signed(sc, SCAN_LEN_NONE, &value)) {
+            return 0;
+        }
+        *a0 = (int)value;
+    }
+    if (scanner_getc(sc) != ',') {
+        return 1;
+    }
+    if (!read_double(sc, a1)) {
+        return 1;
+    }
+    return 2;
+}
+
+// "%15w=%N"
+int scan_measurement(scanner *sc, char *a0, scan_number *a1) {
+    if (!read_word_bounded(sc, a0, 15)) {
+        return 0;
+    }
+    if (scanner_getc(sc) != '=') {
+        return 1;
+    }
+    if (!read_number(sc, a1)) {
+        return 1;
+    }
+    return 2;
+}
+
+static const scan_set scan_picked_columns_set0 = {
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xef, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+     0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfb, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff}
+};
+
+// "%*d,%*f,%d,%*[^,],%*x %*r %*s %lf"
+int scan_picked_columns(scanner *sc, int *a0, double *a1) {
+    if (!skip_decimal(sc)) {
+        return 0;
+    }
+    if (scanner_getc(sc) != ',') {
+        return 0;
+    }
+    if (!skip_float(sc)) {
+        return 0;
+    }
+    if (scanner_getc(sc) != ',') {
+        return 0;
+    }
+    {
+        long long value;
+        if (!read_signed(sc, SCAN_LEN_NONE, &value)) {
+            return 0;
+        }
+        *a0 = (int)value;
+    }
+    if (scanner_getc(sc) != ',') {
+        return 1;
+    }
+    if (!skip_scanset(sc, &scan_picked_columns_set0, 0)) {
+        return 1;
+    }
+    if (scanner_getc(sc) != ',') {
+        return 1;
+    }
+    if (!skip_hex(sc)) {
+        return 1;
+    }
+    if (!skip_roman(sc)) {
+        return 1;
+    }
+    if (!skip_string(sc, 0)) {
+        return 1;
+    }
+    if (!read_double(sc, a1)) {
+        return 1;
+    }
+    return 2;
+}
+
+static const scan_set scan_key_value_set0 = {
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xdf, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+     0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xf7, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff}
+};
+
+// "%m[^=]=%mw"
+int scan_key_value(scanner *sc, char **a0, char **a1) {
+    if (!read_scanset_alloc(sc, a0, &scan_key_value_set0, 0)) {
+        return 0;
+    }
+    if (scanner_getc(sc) != '=') {
+        return 1;
+    }
+    if (!read_word_alloc(sc, a1, 0)) {
+        return 1;
+    }
+    return 2;
+}
+
+// "%31W:%W"
+int scan_symbol_pair(scanner *sc, unsigned int *a0, unsigned int *a1) {
+    if (!read_word_intern(sc, a0, 31)) {
+        return 0;
+    }
+    if (scanner_getc(sc) != ':') {
+        return 1;
+    }
+    if (!read_word_intern(sc, a1, 0)) {
+        return 1;
+    }
+    return 2;
+}
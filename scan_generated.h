@@ -0,0 +1,35 @@
+// Generated by scan_codegen from formats.txt. Do not edit.
+#ifndef SCAN_GENERATED_H
+#define SCAN_GENERATED_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "my_scanf.h"
+
+// "(%d, %d)"
+int scan_point(scanner *sc, int *a0, int *a1);
+// "%d,%f %15s"
+int scan_record(scanner *sc, int *a0, double *a1, char *a2);
+// "%llx: %4c|%hu"
+int scan_dump_line(scanner *sc, unsigned long long *a0, char *a1, unsigned short *a2);
+// "%31[^,],%31[^,],%hhd"
+int scan_csv_row(scanner *sc, char *a0, char *a1, signed char *a2);
+// "id=%u name=%15w score=%lf%%"
+int scan_tagged(scanner *sc, unsigned int *a0, char *a1, double *a2);
+// "%r-%b %v"
+int scan_roman_entry(scanner *sc, int *a0, unsigned int *a1, scan_view *a2);
+// "%jd %zu %Lf %hf %ld\n"
+int scan_mixed_lengths(scanner *sc, intmax_t *a0, size_t *a1, long double *a2, float *a3, long *a4);
+// "%d,%f"
+int scan_id_value(scanner *sc, int *a0, double *a1);
+// "%15w=%N"
+int scan_measurement(scanner *sc, char *a0, scan_number *a1);
+// "%*d,%*f,%d,%*[^,],%*x %*r %*s %lf"
+int scan_picked_columns(scanner *sc, int *a0, double *a1);
+// "%m[^=]=%mw"
+int scan_key_value(scanner *sc, char **a0, char **a1);
+// "%31W:%W"
+int scan_symbol_pair(scanner *sc, unsigned int *a0, unsigned int *a1);
+
+#endif
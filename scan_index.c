@@ -0,0 +1,317 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "my_scanf.h"
+#include "scan_simd.h"
+
+// Sparse record-offset index for random access into large newline-delimited
+// files. One pass over the mapped file finds every line with the vector
+// newline search; every stride-th record gets an entry holding its offset and
+// a hash of its first bytes. To reach record N, a scanner seeks to the entry
+// at or before N and skips at most stride - 1 lines, so a lookup costs one
+// seek and a few kilobytes of reading however large the file is.
+//
+// The index is saved to its own file with the size, mtime and inode of the
+// data file, and reused on later runs while they match. Each seek also
+// compares the hash of the record it lands on, so an edit that kept the size
+// and mtime is still caught where it matters.
+
+// Leading bytes of a record covered by its check hash
+#define INDEX_CHECK_BYTES 32
+
+// On-disk format version; a file written with the other byte order reads as
+// a different version and is rebuilt
+#define INDEX_VERSION 1
+
+// Header of a saved index, followed by the offsets and then the checks
+typedef struct index_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t stride;
+    uint64_t records;
+    uint64_t entries;
+    uint64_t file_size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint64_t inode;
+    uint64_t checksum; // Of the two arrays
+} index_header;
+
+static const char index_magic[8] = "SCANIDX";
+
+static uint32_t record_check(const char *p, const char *nl);
+static uint64_t entries_checksum(const scan_index *index);
+static int identity_matches(const scan_index *index, const char *path);
+static void set_identity(scan_index *index, const struct stat *st);
+static uint32_t check_here(scanner *sc);
+
+// Indexes the file at path, keeping every stride-th record (0 = default).
+// Records are the lines that are not blank, numbered from 0 like the rows of
+// scan_parallel. Returns 0, or -1 if the file cannot be read or memory runs out.
+int scan_index_build(scan_index *index, const char *path, unsigned int stride) {
+    memset(index, 0, sizeof(*index));
+    index->stride = (stride != 0) ? stride : SCAN_INDEX_DEFAULT_STRIDE;
+
+    struct stat st;
+    scanner sc;
+    if (stat(path, &st) != 0 || scanner_map_file(&sc, path) != 0) {
+        return -1;
+    }
+    set_identity(index, &st);
+
+    const char *start = sc.cur;
+    const char *p = sc.cur;
+    const char *end = sc.end;
+    size_t capacity = 0;
+    while (p < end) {
+        const char *nl = find_newline(p, end);
+        const char *first = find_non_whitespace(p, nl);
+        if (first < nl) {
+            if (index->records % index->stride == 0) {
+                if (index->entries == capacity) {
+                    capacity = (capacity != 0) ? capacity * 2 : 1024;
+                    uint64_t *offsets = realloc(index->offsets, capacity * sizeof(uint64_t));
+                    if (offsets != NULL) {
+                        index->offsets = offsets;
+                    }
+                    uint32_t *checks = realloc(index->checks, capacity * sizeof(uint32_t));
+                    if (checks != NULL) {
+                        index->checks = checks;
+                    }
+                    if (offsets == NULL || checks == NULL) {
+                        scanner_destroy(&sc);
+                        scan_index_destroy(index);
+                        return -1;
+                    }
+                }
+                index->offsets[index->entries] = (uint64_t)(first - start);
+                index->checks[index->entries] = record_check(first, nl);
+                index->entries++;
+            }
+            index->records++;
+        }
+        p = (nl < end) ? nl + 1 : end;
+    }
+    scanner_destroy(&sc);
+    return 0;
+}
+
+// Writes the index to index_path, through a temporary file that is renamed
+// into place so readers never see half an index. Returns 0 on success.
+int scan_index_save(const scan_index *index, const char *index_path) {
+    index_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, index_magic, sizeof(header.magic));
+    header.version = INDEX_VERSION;
+    header.stride = index->stride;
+    header.records = index->records;
+    header.entries = index->entries;
+    header.file_size = index->file_size;
+    header.mtime_sec = index->mtime_sec;
+    header.mtime_nsec = index->mtime_nsec;
+    header.inode = index->inode;
+    header.checksum = entries_checksum(index);
+
+    size_t name_len = strlen(index_path);
+    char *tmp = malloc(name_len + 5);
+    if (tmp == NULL) {
+        return -1;
+    }
+    memcpy(tmp, index_path, name_len);
+    memcpy(tmp + name_len, ".tmp", 5);
+
+    FILE *out = fopen(tmp, "wb");
+    int ok = out != NULL && fwrite(&header, sizeof(header), 1, out) == 1 &&
+             fwrite(index->offsets, sizeof(uint64_t), index->entries, out) == index->entries &&
+             fwrite(index->checks, sizeof(uint32_t), index->entries, out) == index->entries;
+    if (out != NULL && fclose(out) != 0) {
+        ok = 0;
+    }
+    if (ok) {
+        ok = (rename(tmp, index_path) == 0);
+    }
+    if (!ok) {
+        remove(tmp);
+    }
+    free(tmp);
+    return ok ? 0 : -1;
+}
+
+// Reads an index saved by scan_index_save for the file at path. Returns 0,
+// or -1 if it is missing, damaged, or the file has changed since.
+int scan_index_load(scan_index *index, const char *index_path, const char *path) {
+    memset(index, 0, sizeof(*index));
+    FILE *in = fopen(index_path, "rb");
+    if (in == NULL) {
+        return -1;
+    }
+
+    // Step 1: Header
+    index_header header;
+    int ok = fread(&header, sizeof(header), 1, in) == 1 &&
+             memcmp(header.magic, index_magic, sizeof(header.magic)) == 0 &&
+             header.version == INDEX_VERSION && header.stride != 0 &&
+             header.entries == (header.records + header.stride - 1) / header.stride;
+    if (ok) {
+        index->stride = header.stride;
+        index->records = (size_t)header.records;
+        index->entries = (size_t)header.entries;
+        index->file_size = header.file_size;
+        index->mtime_sec = header.mtime_sec;
+        index->mtime_nsec = header.mtime_nsec;
+        index->inode = header.inode;
+        ok = identity_matches(index, path);
+    }
+
+    // Step 2: Entries, checked against the header's checksum
+    if (ok) {
+        size_t n = (index->entries > 0) ? index->entries : 1;
+        index->offsets = malloc(n * sizeof(uint64_t));
+        index->checks = malloc(n * sizeof(uint32_t));
+        ok = index->offsets != NULL && index->checks != NULL &&
+             fread(index->offsets, sizeof(uint64_t), index->entries, in) == index->entries &&
+             fread(index->checks, sizeof(uint32_t), index->entries, in) == index->entries &&
+             entries_checksum(index) == header.checksum;
+    }
+    fclose(in);
+    if (!ok) {
+        scan_index_destroy(index);
+        return -1;
+    }
+    return 0;
+}
+
+// Loads the index for path from index_path (NULL = path with ".idx" added)
+// if it is still valid and has the requested stride (0 = any), and otherwise
+// builds it and saves it there. Returns 0 if the saved index was reused, 1 if
+// it was rebuilt, or -1 if the file cannot be indexed.
+int scan_index_open(scan_index *index, const char *path, const char *index_path,
+                    unsigned int stride) {
+    char *name = NULL;
+    if (index_path == NULL) {
+        size_t len = strlen(path);
+        name = malloc(len + 5);
+        if (name == NULL) {
+            return -1;
+        }
+        memcpy(name, path, len);
+        memcpy(name + len, ".idx", 5);
+        index_path = name;
+    }
+
+    int result = -1;
+    if (scan_index_load(index, index_path, path) == 0 && (stride == 0 || index->stride == stride)) {
+        result = 0;
+    } else {
+        scan_index_destroy(index);
+        if (scan_index_build(index, path, stride) == 0) {
+            scan_index_save(index, index_path); // Still usable if the directory is read-only
+            result = 1;
+        }
+    }
+    free(name);
+    return result;
+}
+
+// Positions sc, a scanner over the indexed file, on the first non-whitespace
+// byte of record `record`. Returns 0, or -1 if the record is out of range,
+// the scanner cannot seek (a checkpoint is active, or it reads ahead), or the
+// file no longer matches the index there.
+int scan_index_seek(const scan_index *index, scanner *sc, size_t record) {
+    if (record >= index->records) {
+        return -1;
+    }
+
+    // Step 1: Jump to the nearest entry and make sure it is still that record
+    size_t entry = record / index->stride;
+    if (scanner_seek(sc, (size_t)index->offsets[entry]) != 0 ||
+        check_here(sc) != index->checks[entry]) {
+        return -1;
+    }
+
+    // Step 2: Walk the remaining lines; blank ones go with the whitespace
+    for (size_t k = record % index->stride; k > 0; k--) {
+        for (;;) {
+            const char *nl = find_newline(sc->cur, sc->end);
+            if (nl < sc->end) {
+                sc->cur = nl + 1;
+                break;
+            }
+            sc->cur = sc->end;
+            if (!scanner_refill(sc)) {
+                return -1; // The file got shorter
+            }
+        }
+        skip_whitespace(sc);
+        if (scanner_peek(sc) == EOF) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void scan_index_destroy(scan_index *index) {
+    free(index->offsets);
+    free(index->checks);
+    index->offsets = NULL;
+    index->checks = NULL;
+    index->entries = 0;
+    index->records = 0;
+}
+
+// HELPERS //
+
+// Hash of the first bytes of the record starting at p, up to its newline
+static uint32_t record_check(const char *p, const char *nl) {
+    size_t len = (size_t)(nl - p);
+    return (uint32_t)scan_hash(p, len < INDEX_CHECK_BYTES ? len : INDEX_CHECK_BYTES);
+}
+
+static uint64_t entries_checksum(const scan_index *index) {
+    uint64_t offsets = scan_hash((const char *)index->offsets, index->entries * sizeof(uint64_t));
+    uint64_t checks = scan_hash((const char *)index->checks, index->entries * sizeof(uint32_t));
+    return offsets ^ (checks * 31);
+}
+
+static void set_identity(scan_index *index, const struct stat *st) {
+    index->file_size = (uint64_t)st->st_size;
+    index->mtime_sec = (int64_t)st->st_mtim.tv_sec;
+    index->mtime_nsec = (int64_t)st->st_mtim.tv_nsec;
+    index->inode = (uint64_t)st->st_ino;
+}
+
+// Whether the file at path is still the one the index was built from
+static int identity_matches(const scan_index *index, const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return 0;
+    }
+    scan_index now;
+    set_identity(&now, &st);
+    return now.file_size == index->file_size && now.mtime_sec == index->mtime_sec &&
+           now.mtime_nsec == index->mtime_nsec && now.inode == index->inode;
+}
+
+// Check hash of the record at sc's position, refilling (under a checkpoint,
+// so nothing is dropped) until its first bytes are buffered
+static uint32_t check_here(scanner *sc) {
+    scanner_checkpoint cp = scanner_mark(sc);
+    while ((size_t)(sc->end - sc->cur) < INDEX_CHECK_BYTES &&
+           find_newline(sc->cur, sc->end) == sc->end && !sc->eof && sc->fill != NULL) {
+        size_t had = (size_t)(sc->end - sc->cur);
+        scanner_refill(sc);
+        if ((size_t)(sc->end - sc->cur) == had) {
+            break;
+        }
+    }
+    scanner_commit(sc, cp);
+
+    const char *limit = sc->end;
+    if ((size_t)(limit - sc->cur) > INDEX_CHECK_BYTES) {
+        limit = sc->cur + INDEX_CHECK_BYTES;
+    }
+    return record_check(sc->cur, find_newline(sc->cur, limit));
+}
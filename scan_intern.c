@@ -0,0 +1,200 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "my_scanf.h"
+
+// Intern table for %W. Each distinct word is stored once, in an arena, and
+// numbered in order of first appearance; the open-addressing index maps a
+// word to its ID with linear probing. A slot holds 32 bits of the word's hash
+// next to the ID, so a probe only touches the word itself when the hashes
+// agree, and a hit costs one hash, usually one slot and one comparison. Like an
+// arena, a table belongs to one thread at a time.
+
+// Smallest index, in slots
+#define INTERN_MIN_SLOTS 64
+
+// Arena block size for the canonical copies
+#define INTERN_ARENA_BLOCK (1 << 16)
+
+// Multipliers from splitmix64
+#define HASH_MUL_1 0x9E3779B97F4A7C15ull
+#define HASH_MUL_2 0xBF58476D1CE4E5B9ull
+
+static int grow_index(scan_intern *table);
+
+static inline uint64_t load64(const char *p) {
+    uint64_t word;
+    memcpy(&word, p, 8);
+    return word;
+}
+
+static inline uint64_t load32(const char *p) {
+    uint32_t word;
+    memcpy(&word, p, 4);
+    return word;
+}
+
+// Hashes len bytes eight at a time: one xor and one multiply per 64-bit
+// word, then a final avalanche. The last word is loaded so that it ends at
+// the last byte (overlapping the previous one), and short words are built
+// from two 4-byte or three 1-byte loads, so no length ever needs a byte loop
+// or a variable-size copy. Most identifiers take one or two multiplies.
+uint64_t scan_hash(const char *p, size_t len) {
+    uint64_t h = (uint64_t)len * HASH_MUL_1;
+    uint64_t last;
+    if (len > 8) {
+        const char *end = p + len;
+        while (end - p > 8) {
+            h = (h ^ load64(p)) * HASH_MUL_1;
+            h ^= h >> 32;
+            p += 8;
+        }
+        last = load64(end - 8);
+    } else if (len >= 4) {
+        last = load32(p) | (load32(p + len - 4) << 32);
+    } else if (len > 0) {
+        last = (uint64_t)(unsigned char)p[0] | ((uint64_t)(unsigned char)p[len / 2] << 8) |
+               ((uint64_t)(unsigned char)p[len - 1] << 16);
+    } else {
+        last = 0;
+    }
+    h = (h ^ last) * HASH_MUL_1;
+    h ^= h >> 29;
+    h *= HASH_MUL_2;
+    h ^= h >> 32;
+    return h;
+}
+
+// Whether the len bytes at a and b are equal, compared with the same
+// overlapping loads as scan_hash instead of a call to memcmp
+static inline int same_bytes(const char *a, const char *b, size_t len) {
+    if (len > 8) {
+        for (size_t i = 0; i + 8 < len; i += 8) {
+            if (load64(a + i) != load64(b + i)) {
+                return 0;
+            }
+        }
+        return load64(a + len - 8) == load64(b + len - 8);
+    }
+    if (len >= 4) {
+        return load32(a) == load32(b) && load32(a + len - 4) == load32(b + len - 4);
+    }
+    return len == 0 || (a[0] == b[0] && a[len / 2] == b[len / 2] && a[len - 1] == b[len - 1]);
+}
+
+// Sets up an empty table sized for about `expected` distinct words (0 for a
+// small default). Returns 0, or -1 if out of memory.
+int scan_intern_init(scan_intern *table, size_t expected) {
+    size_t slots = INTERN_MIN_SLOTS;
+    while (slots < expected * 2) {
+        slots *= 2;
+    }
+    table->slots = calloc(slots, sizeof(scan_intern_slot));
+    table->mask = slots - 1;
+    table->words = NULL;
+    table->count = 0;
+    table->capacity = 0;
+    scan_arena_init(&table->strings, INTERN_ARENA_BLOCK);
+    return (table->slots != NULL) ? 0 : -1;
+}
+
+// Stores the ID of the len bytes at p in *id, adding them as a new word if
+// they have not been seen. Returns 1, or 0 if out of memory.
+int scan_intern_add(scan_intern *table, const char *p, size_t len, unsigned int *id) {
+    uint32_t hash = (uint32_t)scan_hash(p, len);
+
+    // Step 1: Probe for the word
+    size_t i = hash & table->mask;
+    for (; table->slots[i].id != 0; i = (i + 1) & table->mask) {
+        const scan_intern_slot *slot = &table->slots[i];
+        if (slot->hash == hash) {
+            const scan_view *word = &table->words[slot->id - 1];
+            if (word->len == len && same_bytes(word->ptr, p, len)) {
+                *id = slot->id - 1;
+                return 1; // Seen before
+            }
+        }
+    }
+
+    // Step 2: Make room, keeping the index at most half full
+    if (table->count == UINT32_MAX - 1) {
+        return 0; // Out of IDs
+    }
+    if ((size_t)(table->count + 1) * 2 > table->mask + 1) {
+        if (!grow_index(table)) {
+            return 0;
+        }
+        i = hash & table->mask;
+        while (table->slots[i].id != 0) {
+            i = (i + 1) & table->mask;
+        }
+    }
+    if (table->count == table->capacity) {
+        unsigned int capacity = (table->capacity != 0) ? table->capacity * 2 : 64;
+        scan_view *grown = realloc(table->words, (size_t)capacity * sizeof(scan_view));
+        if (grown == NULL) {
+            return 0;
+        }
+        table->words = grown;
+        table->capacity = capacity;
+    }
+
+    // Step 3: Keep a canonical null-terminated copy and claim the slot
+    char *copy = scan_arena_alloc(&table->strings, len + 1);
+    if (copy == NULL) {
+        return 0;
+    }
+    memcpy(copy, p, len);
+    copy[len] = '\0';
+    table->words[table->count].ptr = copy;
+    table->words[table->count].len = len;
+    table->slots[i].hash = hash;
+    table->slots[i].id = table->count + 1;
+    *id = table->count++;
+    return 1;
+}
+
+// Doubles the index and reinserts every slot by its stored hash
+static int grow_index(scan_intern *table) {
+    size_t slots = (table->mask + 1) * 2;
+    scan_intern_slot *grown = calloc(slots, sizeof(scan_intern_slot));
+    if (grown == NULL) {
+        return 0;
+    }
+    for (size_t j = 0; j <= table->mask; j++) {
+        if (table->slots[j].id != 0) {
+            size_t i = table->slots[j].hash & (slots - 1);
+            while (grown[i].id != 0) {
+                i = (i + 1) & (slots - 1);
+            }
+            grown[i] = table->slots[j];
+        }
+    }
+    free(table->slots);
+    table->slots = grown;
+    table->mask = slots - 1;
+    return 1;
+}
+
+// Canonical copy of word id: the same pointer every time the word is read,
+// valid until the table is destroyed
+const char *scan_intern_string(const scan_intern *table, unsigned int id) {
+    return (id < table->count) ? table->words[id].ptr : NULL;
+}
+
+void scan_intern_destroy(scan_intern *table) {
+    free(table->slots);
+    free(table->words);
+    scan_arena_destroy(&table->strings);
+    table->slots = NULL;
+    table->words = NULL;
+    table->mask = 0;
+    table->count = 0;
+    table->capacity = 0;
+}
+
+// %W on sc interns into table from now on (NULL makes %W fail)
+void scanner_set_intern(scanner *sc, scan_intern *table) {
+    sc->intern = table;
+}
@@ -0,0 +1,139 @@
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "my_scanf.h"
+#include "scan_simd.h"
+
+// Line-record iteration: one record per line, with bad lines skipped.
+//
+// my_scanf stops at the first field that does not match and leaves the rest
+// of the line unread, so a caller that wants to carry on has to drain it by
+// hand, rescanning bytes that were already looked at. Here the end of the line
+// is found first, with the vector newline search, and the format then runs on
+// a memory scanner over just that line. A malformed line can therefore never
+// swallow part of the next one (no %d skips over a newline looking for
+// digits), and whatever happens the iterator resumes right after the newline
+// it already found.
+
+static const char *buffer_line(scanner *sc, int *failed);
+
+// Compiles format and records one destination pointer per conversion, in the
+// same order as for my_scanf. Every line is stored through them. The scanner
+// stays the caller's; its arena and intern table are used for %m and %W.
+// Returns 0, or -1 if the format cannot be compiled or memory runs out.
+int scan_lines_init(scan_lines *it, scanner *sc, const char *format, ...) {
+    memset(it, 0, sizeof(*it));
+    it->sc = sc;
+    it->prog = scan_compile(format);
+    if (it->prog == NULL) {
+        return -1;
+    }
+
+    for (int i = 0; i < it->prog->count; i++) {
+        it->conversions += (it->prog->ops[i].kind == SCAN_OP_CONVERT);
+    }
+    it->dsts = calloc((size_t)(it->conversions > 0 ? it->conversions : 1), sizeof(scan_column));
+    if (it->dsts == NULL) {
+        scan_lines_destroy(it);
+        return -1;
+    }
+
+    va_list args;
+    va_start(args, format);
+    for (int i = 0; i < it->conversions; i++) {
+        it->dsts[i].base = va_arg(args, void *);
+    }
+    va_end(args);
+
+    // Each line only moves the view's window; the rest stays as set up here
+    scanner_init_memory(&it->view, NULL, 0);
+    return 0;
+}
+
+// Scans the next line that is not blank. SCAN_LINE_OK means every op of the
+// format matched and only whitespace was left; SCAN_LINE_REJECTED means an op
+// did not match, after it->fields conversions were stored, or that the line
+// had more text than the format. Either way the line is consumed and the next call
+// starts on the following line. it->line and it->len give the line's text
+// (without the newline) until the next call.
+enum scan_line_status scan_lines_next(scan_lines *it) {
+    scanner *sc = it->sc;
+    for (;;) {
+        if (scanner_peek(sc) == EOF) {
+            return SCAN_LINE_END;
+        }
+
+        // Step 1: Find the end of the line, refilling if it is not all buffered
+        const char *nl = find_newline(sc->cur, sc->end);
+        if (nl == sc->end) {
+            int failed;
+            nl = buffer_line(sc, &failed);
+            if (failed) {
+                return SCAN_LINE_ERROR;
+            }
+        }
+        const char *line = sc->cur;
+        size_t len = (size_t)(nl - line);
+        it->offset = scanner_offset(sc);
+        it->number++;
+        sc->cur = (nl < sc->end) ? nl + 1 : nl;
+
+        // Step 2: Blank lines are not records
+        if (find_non_whitespace(line, nl) == nl) {
+            continue;
+        }
+        it->line = line;
+        it->len = len;
+
+        // Step 3: Run the format on the line alone
+        scanner *view = &it->view;
+        view->cur = line;
+        view->end = nl;
+        view->origin = line;
+        view->arena = sc->arena;
+        view->intern = sc->intern;
+        int complete;
+        it->fields = scan_exec_row(view, it->prog, it->dsts, 0, &complete);
+
+        // Step 4: A line with text left after the format is not a match either
+        if (complete && find_non_whitespace(view->cur, nl) == nl) {
+            it->accepted++;
+            return SCAN_LINE_OK;
+        }
+        it->rejected++;
+        return SCAN_LINE_REJECTED;
+    }
+}
+
+void scan_lines_destroy(scan_lines *it) {
+    scan_program_free(it->prog);
+    free(it->dsts);
+    it->prog = NULL;
+    it->dsts = NULL;
+}
+
+// Refills until the line starting at cur ends inside the buffer, and returns
+// its newline (or the end of input for a last line without one). A checkpoint
+// keeps the line buffered, growing the buffer for lines longer than it, and
+// each refill only searches the bytes it added. Sets *failed if the buffer
+// could not grow.
+static const char *buffer_line(scanner *sc, int *failed) {
+    *failed = 0;
+    scanner_checkpoint cp = scanner_mark(sc);
+    const char *nl = sc->end;
+    while (!sc->eof && sc->fill != NULL) {
+        size_t searched = (size_t)(sc->end - sc->cur);
+        scanner_refill(sc);
+        nl = find_newline(sc->cur + searched, sc->end);
+        if (nl < sc->end) {
+            break;
+        }
+        if ((size_t)(sc->end - sc->cur) == searched && !sc->eof) {
+            *failed = 1; // Full buffer that could not grow
+            break;
+        }
+    }
+    scanner_commit(sc, cp);
+    return nl;
+}
@@ -0,0 +1,251 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "my_scanf.h"
+#include "scan_simd.h"
+
+// Parallel parsing of newline-delimited input (one record per line).
+//
+// The input is cut into chunks that end on a newline, more chunks than
+// threads. Threads take chunks off a shared counter, so a thread that drew
+// short chunks simply takes more of them. Two passes keep the output in
+// record order without copying:
+//   1. Every chunk counts its records (lines with anything but whitespace)
+//   2. A prefix sum gives each chunk its first row, and every chunk is then
+//      parsed line by line straight into the caller's columns from that row.
+//      Each line is scanned on its own memory view, as in scan_lines, so a
+//      line with too few or too many fields is caught where it is instead of
+//      shifting every row after it.
+
+// Chunk size bounds; between them, aim for several chunks per thread
+#define PARALLEL_MIN_CHUNK (64u << 10)
+#define PARALLEL_MAX_CHUNK (4u << 20)
+#define PARALLEL_CHUNKS_PER_THREAD 8
+
+// Upper bound on worker threads
+#define PARALLEL_MAX_THREADS 256
+
+typedef struct parse_chunk {
+    const char *start;
+    size_t len;
+    size_t records;  // Pass 1: records in the chunk
+    size_t first;    // Row of the chunk's first record
+    size_t parsed;   // Pass 2: rows stored
+    size_t error;    // Pass 2: chunk-relative offset of the first malformed line, or SCAN_NO_ERROR
+} parse_chunk;
+
+typedef struct parallel_job {
+    parse_chunk *chunks;
+    size_t count;
+    size_t next;  // Next unclaimed chunk, advanced atomically
+    int pass;     // 1 = count records, 2 = parse
+    const scan_program *prog;
+    const scan_column *columns;
+    size_t max_rows;
+} parallel_job;
+
+static size_t count_records(const char *p, const char *end);
+static void parse_one_chunk(const parallel_job *job, parse_chunk *chunk);
+static void *parallel_worker(void *arg);
+static void run_pass(parallel_job *job, int threads, int pass);
+
+// Parses data[0, len) with format, one record per line, into columns using the
+// given number of threads (0 = one per online CPU). *rows receives the number
+// of rows stored in record order up to the first malformed line, whose offset
+// goes to *error_offset (SCAN_NO_ERROR if none). Returns 0, or -1 if the format
+// cannot be compiled.
+int scan_parallel(const char *data, size_t len, const char *format, const scan_column *columns,
+                  size_t max_rows, int threads, size_t *rows, size_t *error_offset) {
+    *rows = 0;
+    if (error_offset != NULL) {
+        *error_offset = SCAN_NO_ERROR;
+    }
+
+    scan_program *prog = scan_compile(format);
+    if (prog == NULL) {
+        return -1;
+    }
+
+    // Step 1: Pick the thread count and chunk size
+    if (threads <= 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (online > 0) ? (int)online : 1;
+    }
+    if (threads > PARALLEL_MAX_THREADS) {
+        threads = PARALLEL_MAX_THREADS;
+    }
+    size_t target = len / ((size_t)threads * PARALLEL_CHUNKS_PER_THREAD);
+    if (target < PARALLEL_MIN_CHUNK) {
+        target = PARALLEL_MIN_CHUNK;
+    }
+    if (target > PARALLEL_MAX_CHUNK) {
+        target = PARALLEL_MAX_CHUNK;
+    }
+
+    // Step 2: Cut chunks, moving each boundary past the next newline
+    size_t capacity = len / target + 1;
+    parse_chunk *chunks = calloc(capacity, sizeof(parse_chunk));
+    if (chunks == NULL) {
+        scan_program_free(prog);
+        return -1;
+    }
+    size_t count = 0;
+    size_t pos = 0;
+    while (pos < len) {
+        size_t stop = len;
+        if (len - pos > target) {
+            const char *nl = memchr(data + pos + target, '\n', len - pos - target);
+            stop = (nl != NULL) ? (size_t)(nl - data) + 1 : len;
+        }
+        chunks[count].start = data + pos;
+        chunks[count].len = stop - pos;
+        count++;
+        pos = stop;
+    }
+
+    parallel_job job = {chunks, count, 0, 0, prog, columns, max_rows};
+
+    // Step 3: Count records per chunk, then give each chunk its first row
+    run_pass(&job, threads, 1);
+    size_t row = 0;
+    for (size_t i = 0; i < count; i++) {
+        chunks[i].first = row;
+        row += chunks[i].records;
+    }
+
+    // Step 4: Parse every chunk into its rows
+    run_pass(&job, threads, 2);
+
+    // Step 5: Rows are valid in order up to the first short chunk
+    for (size_t i = 0; i < count; i++) {
+        *rows = chunks[i].first + chunks[i].parsed;
+        if (chunks[i].error != SCAN_NO_ERROR) {
+            if (error_offset != NULL) {
+                *error_offset = (size_t)(chunks[i].start - data) + chunks[i].error;
+            }
+            break;
+        }
+        if (*rows >= max_rows) {
+            *rows = max_rows;
+            break;
+        }
+    }
+
+    free(chunks);
+    scan_program_free(prog);
+    return 0;
+}
+
+// Maps a file and parses it with scan_parallel. Returns -1 if the file cannot
+// be mapped or the format cannot be compiled.
+int scan_parallel_file(const char *path, const char *format, const scan_column *columns,
+                       size_t max_rows, int threads, size_t *rows, size_t *error_offset) {
+    scanner sc;
+    if (scanner_map_file(&sc, path) != 0) {
+        return -1;
+    }
+    int ret = scan_parallel(sc.cur, (size_t)(sc.end - sc.cur), format, columns, max_rows,
+                            threads, rows, error_offset);
+    scanner_destroy(&sc);
+    return ret;
+}
+
+// WORKERS //
+
+// Lines in [p, end) that hold anything besides whitespace
+static size_t count_records(const char *p, const char *end) {
+    size_t records = 0;
+    for (;;) {
+        p = find_non_whitespace(p, end);
+        if (p == end) {
+            return records;
+        }
+        records++;
+        const char *nl = memchr(p, '\n', (size_t)(end - p));
+        if (nl == NULL) {
+            return records;
+        }
+        p = nl + 1;
+    }
+}
+
+static void parse_one_chunk(const parallel_job *job, parse_chunk *chunk) {
+    chunk->parsed = 0;
+    chunk->error = SCAN_NO_ERROR;
+    if (chunk->first >= job->max_rows) {
+        return; // Entirely past the caller's capacity
+    }
+    size_t limit = chunk->records;
+    if (limit > job->max_rows - chunk->first) {
+        limit = job->max_rows - chunk->first;
+    }
+
+    // Each line only moves the view's window
+    scanner view;
+    scanner_init_memory(&view, NULL, 0);
+    const char *p = chunk->start;
+    const char *end = chunk->start + chunk->len;
+    while (chunk->parsed < limit && p < end) {
+        const char *nl = find_newline(p, end);
+        const char *line = p;
+        p = (nl < end) ? nl + 1 : end;
+        if (find_non_whitespace(line, nl) == nl) {
+            continue; // Blank lines are not records
+        }
+
+        // A line must hold exactly one record: every op matches and only
+        // whitespace is left
+        view.cur = line;
+        view.end = nl;
+        view.origin = line;
+        int complete;
+        scan_exec_row(&view, job->prog, job->columns, chunk->first + chunk->parsed, &complete);
+        if (!complete || find_non_whitespace(view.cur, nl) != nl) {
+            chunk->error = (size_t)(line - chunk->start);
+            return;
+        }
+        chunk->parsed++;
+    }
+}
+
+static void *parallel_worker(void *arg) {
+    parallel_job *job = arg;
+    for (;;) {
+        size_t i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+        if (i >= job->count) {
+            return NULL;
+        }
+        parse_chunk *chunk = &job->chunks[i];
+        if (job->pass == 1) {
+            chunk->records = count_records(chunk->start, chunk->start + chunk->len);
+        } else {
+            parse_one_chunk(job, chunk);
+        }
+    }
+}
+
+// Runs one pass over all chunks on up to threads threads, the caller included.
+// If a thread cannot be started the others simply take more chunks.
+static void run_pass(parallel_job *job, int threads, int pass) {
+    job->pass = pass;
+    job->next = 0;
+    if ((size_t)threads > job->count) {
+        threads = (int)job->count;
+    }
+
+    pthread_t ids[PARALLEL_MAX_THREADS];
+    int started = 0;
+    for (int t = 1; t < threads; t++) {
+        if (pthread_create(&ids[started], NULL, parallel_worker, job) == 0) {
+            started++;
+        }
+    }
+    parallel_worker(job);
+    for (int t = 0; t < started; t++) {
+        pthread_join(ids[t], NULL);
+    }
+}
@@ -0,0 +1,270 @@
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "my_scanf.h"
+#include "scan_simd.h"
+#include "scan_stats.h"
+
+// Push-style scanning of input that arrives in fragments.
+//
+// The read_* helpers treat the end of their window as the end of input, so a
+// token cut in half by a short read() would be parsed as a short token. The
+// push scanner therefore only runs an op once the op's whole token is
+// buffered: it first looks for the byte that ends the token (a byte that
+// cannot continue it), remembering how far it looked, and returns
+// SCAN_PUSH_NEED_MORE if that byte has not arrived yet. Whitespace an op
+// skips is consumed as soon as it is seen. When the op finally runs it sees
+// its complete token, so its result is exactly what a blocking scan would
+// give, and every op that finished is committed and never looked at again.
+
+// Initial size of the push buffer
+#define PUSH_INITIAL_CAPACITY 4096
+
+static int op_skips_ws(const scan_op *op);
+static int can_continue(const scan_op *op, int c);
+static int token_buffered(scan_push *ps, const scan_op *op);
+
+// Compiles format and records one destination pointer per conversion, in
+// the same order as for my_scanf. Every record returned by scan_push_next is
+// stored through them. %v is refused, since views would point into a buffer
+// that moves, and so is %W, which needs a scanner's intern table, as well as
+// registered conversions, whose token boundaries are unknown here. Returns 0,
+// or -1 if the format cannot be used.
+int scan_push_init(scan_push *ps, const char *format, ...) {
+    memset(ps, 0, sizeof(*ps));
+    ps->prog = scan_compile(format);
+    if (ps->prog == NULL) {
+        return -1;
+    }
+
+    int conversions = 0;
+    for (int i = 0; i < ps->prog->count; i++) {
+        const scan_op *op = &ps->prog->ops[i];
+        const scan_converter *entry = scan_converter_for(op->conv);
+        if ((op->kind == SCAN_OP_CONVERT && (op->conv == 'v' || op->conv == 'W')) ||
+            ((op->kind == SCAN_OP_CONVERT || op->kind == SCAN_OP_SKIP_FIELD) &&
+             !(entry->flags & SCAN_CONV_BUILTIN))) {
+            scan_push_destroy(ps);
+            return -1;
+        }
+        conversions += (op->kind == SCAN_OP_CONVERT);
+    }
+
+    ps->dsts = malloc((size_t)(conversions > 0 ? conversions : 1) * sizeof(void *));
+    ps->buf = malloc(PUSH_INITIAL_CAPACITY);
+    if (ps->dsts == NULL || ps->buf == NULL) {
+        scan_push_destroy(ps);
+        return -1;
+    }
+    ps->cap = PUSH_INITIAL_CAPACITY;
+
+    va_list args;
+    va_start(args, format);
+    for (int i = 0; i < conversions; i++) {
+        ps->dsts[i] = va_arg(args, void *);
+    }
+    va_end(args);
+    return 0;
+}
+
+// Appends len bytes of input. Consumed bytes are dropped first, so the buffer
+// only grows when a single record outgrows it. Returns 0, or -1 if out of memory.
+int scan_push_feed(scan_push *ps, const char *data, size_t len) {
+    if (ps->len + len > ps->cap && ps->pos > 0) {
+        memmove(ps->buf, ps->buf + ps->pos, ps->len - ps->pos);
+        ps->base += ps->pos;
+        ps->len -= ps->pos;
+        ps->probe -= ps->pos;
+        ps->pos = 0;
+    }
+    if (ps->len + len > ps->cap) {
+        size_t cap = ps->cap * 2;
+        while (cap < ps->len + len) {
+            cap *= 2;
+        }
+        char *grown = realloc(ps->buf, cap);
+        if (grown == NULL) {
+            return -1;
+        }
+        ps->buf = grown;
+        ps->cap = cap;
+    }
+    memcpy(ps->buf + ps->len, data, len);
+    ps->len += len;
+    return 0;
+}
+
+// Marks the end of input: the last token may now end at the end of the buffer
+void scan_push_finish(scan_push *ps) {
+    ps->finished = 1;
+}
+
+// Parses the next record. On SCAN_PUSH_NEED_MORE the scanner keeps its place
+// and picks up there after the next scan_push_feed. On SCAN_PUSH_ERROR the
+// malformed record is abandoned, and the next call first drops the rest of its
+// line, through the '\n', so scanning resumes with the record on the next line.
+// Fields stored before the failure are left in the destinations.
+enum scan_push_status scan_push_next(scan_push *ps) {
+    const scan_program *prog = ps->prog;
+    if (prog->count == 0) {
+        return SCAN_PUSH_END; // An empty format never consumes anything
+    }
+
+    // Step 0: Drop what is left of a malformed line, which may still be arriving
+    if (ps->skipping) {
+        const char *nl = find_newline(ps->buf + ps->pos, ps->buf + ps->len);
+        ps->pos = (size_t)(nl - ps->buf);
+        ps->probe = ps->pos;
+        if (ps->pos == ps->len) {
+            return ps->finished ? SCAN_PUSH_END : SCAN_PUSH_NEED_MORE;
+        }
+        ps->pos++;
+        ps->probe = ps->pos;
+        ps->skipping = 0;
+    }
+
+    while (ps->op < prog->count) {
+        const scan_op *op = &prog->ops[ps->op];
+
+        // Step 1: Consume whitespace the op would skip anyway
+        if (op_skips_ws(op)) {
+            const char *p = find_non_whitespace(ps->buf + ps->pos, ps->buf + ps->len);
+            ps->pos = (size_t)(p - ps->buf);
+            if (ps->probe < ps->pos) {
+                ps->probe = ps->pos;
+            }
+            if (op->kind == SCAN_OP_SKIP_WS) {
+                ps->op++;
+                continue;
+            }
+        }
+
+        // Step 2: A clean end of input falls between records
+        if (ps->pos == ps->len && ps->op == 0) {
+            return ps->finished ? SCAN_PUSH_END : SCAN_PUSH_NEED_MORE;
+        }
+        if (ps->op == 0) {
+            ps->record = ps->base + ps->pos;
+#ifdef MY_SCANF_STATS
+            scan_stats_scan_begin();
+#endif
+        }
+
+        // Step 3: Wait for the rest of the token
+        if (!ps->finished && !token_buffered(ps, op)) {
+            return SCAN_PUSH_NEED_MORE;
+        }
+
+        // Step 4: Run the op over the buffered bytes and commit what it used
+        scanner sc;
+        scanner_init_memory(&sc, ps->buf + ps->pos, ps->len - ps->pos);
+        void *dst = (op->kind == SCAN_OP_CONVERT) ? ps->dsts[ps->stored] : NULL;
+        int ok = scan_exec_op(&sc, prog, op, dst);
+        ps->pos += scanner_offset(&sc);
+        ps->probe = ps->pos;
+        if (!ok) {
+            ps->op = 0;
+            ps->stored = 0;
+            ps->skipping = 1;
+            return SCAN_PUSH_ERROR;
+        }
+        ps->stored += (op->kind == SCAN_OP_CONVERT);
+        ps->op++;
+    }
+
+    ps->op = 0;
+    ps->stored = 0;
+    return SCAN_PUSH_RECORD;
+}
+
+// Input offset where the current record started, or the malformed record
+// after SCAN_PUSH_ERROR
+size_t scan_push_offset(const scan_push *ps) {
+    return ps->record;
+}
+
+void scan_push_destroy(scan_push *ps) {
+    scan_program_free(ps->prog);
+    free(ps->dsts);
+    free(ps->buf);
+    ps->prog = NULL;
+    ps->dsts = NULL;
+    ps->buf = NULL;
+}
+
+// TOKEN BOUNDARIES //
+
+// Ops that skip leading whitespace before reading anything
+static int op_skips_ws(const scan_op *op) {
+    if (op->skip_ws || op->kind == SCAN_OP_SKIP_WS) {
+        return 1;
+    }
+    return (op->kind == SCAN_OP_CONVERT || op->kind == SCAN_OP_SKIP_FIELD) && op->conv != 'c' &&
+           op->conv != '[';
+}
+
+// Whether c could be part of the op's token. This may admit more than the
+// conversion accepts (waiting a little longer is harmless) but never less.
+static int can_continue(const scan_op *op, int c) {
+    switch (op->conv) {
+        case 'd':
+        case 'u':
+            return is_digit(c) || c == '+' || c == '-';
+        case 'x':
+            return is_hex_digit(c) || c == 'x' || c == 'X' || c == '+' || c == '-';
+        case 'b':
+            return is_binary_digit(c) || c == 'b' || c == 'B' || c == '+' || c == '-';
+        case 'r':
+            return is_roman_digit(c);
+        default:
+            // Floats: digits, signs, '.', exponents, hex digits, "inf" and "nan"
+            return is_word_char(c) || c == '.' || c == '+' || c == '-';
+    }
+}
+
+// Whether the whole token of op is buffered from pos on, i.e. running the op
+// now cannot stop early at the end of the buffer. The search resumes at probe,
+// so every byte is examined once however the input was split.
+static int token_buffered(scan_push *ps, const scan_op *op) {
+    size_t avail = ps->len - ps->pos;
+    const char *p = ps->buf + ps->probe;
+    const char *end = ps->buf + ps->len;
+
+    if (op->kind == SCAN_OP_LITERAL) {
+        // Complete once every byte is here, or as soon as one differs
+        const char *lit = ps->prog->literals + op->lit_off;
+        size_t have = (avail < op->len) ? avail : op->len;
+        return have == op->len || memcmp(ps->buf + ps->pos, lit, have) != 0;
+    }
+    if (op->kind != SCAN_OP_CONVERT && op->kind != SCAN_OP_SKIP_FIELD) {
+        return 1; // SCAN_OP_STOP fails without reading
+    }
+    if (op->conv == 'c') {
+        return avail >= (op->width > 1 ? op->width : 1);
+    }
+    if (op->width > 0 && avail >= op->width) {
+        return 1; // %15s and friends stop at their width anyway
+    }
+
+    switch (op->conv) {
+        case 's':
+        case 'v': // Only as %*v
+            p = find_whitespace(p, end);
+            break;
+        case 'w':
+        case 'W': // Only as %*W
+            p = find_non_word(p, end);
+            break;
+        case '[':
+            p = find_not_in_set(&ps->prog->sets[op->lit_off], p, end);
+            break;
+        default:
+            while (p < end && can_continue(op, (unsigned char)*p)) {
+                p++;
+            }
+            break;
+    }
+    ps->probe = (size_t)(p - ps->buf);
+    return p < end;
+}
@@ -0,0 +1,293 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#else
+#include <sched.h>
+#endif
+
+#include "my_scanf.h"
+
+// Read-ahead source: a reader thread keeps a ring of chunks filled while the
+// scanner parses, so read(2) latency (disk, pipe, network) overlaps with
+// conversion instead of stalling it.
+//
+// The ring is single-producer single-consumer. The reader only advances head
+// and the parser only advances tail, both free-running 32-bit counters, so a
+// handoff is one release store and one acquire load with no lock. A side that
+// finds the ring full (reader) or empty (parser) announces that it is waiting
+// and sleeps on a futex; the other side only makes the wake-up syscall when it
+// sees that announcement, so in the steady state nobody enters the kernel
+// except for the reads themselves.
+
+// Defaults for scanner_init_readahead
+#define READAHEAD_DEFAULT_CHUNK (1 << 20)
+#define READAHEAD_DEFAULT_CHUNKS 4
+
+typedef struct read_ring {
+    int fd;
+    char **chunks;        // Ring of chunk buffers
+    size_t *lens;         // Bytes read into each chunk; 0 marks the end of input
+    size_t chunk_size;
+    uint32_t count;       // Chunks in the ring (at least 2)
+    uint32_t head;        // Chunks filled (reader only); the parser sleeps on it
+    uint32_t tail;        // Chunks given back (parser only)
+    uint32_t reader_wake; // Bumped to wake a sleeping reader
+    int reader_waiting;   // Reader found the ring full
+    int parser_waiting;   // Parser found the ring empty
+    int stop;             // scanner_destroy wants the reader gone
+    off_t hint;           // File offset of the next chunk to hint, or -1 when not a regular file
+    pthread_t thread;
+
+    // Parser side
+    const char *data;     // Chunk being copied out, or NULL
+    size_t pos;           // Bytes of it already copied
+    size_t len;           // Its length
+    int done;             // End of input reached
+} read_ring;
+
+static void *reader_main(void *arg);
+static size_t fill_from_readahead(void *source, char *dst, size_t n);
+static void release_readahead(void *source);
+static void free_readahead(read_ring *ra);
+static void wait_on(uint32_t *word, uint32_t seen);
+static void wake_on(uint32_t *word);
+
+// Creates a scanner whose input is read from fd by a background thread, in
+// chunks of chunk_size bytes with up to `chunks` of them read ahead (0 for
+// the defaults, 1 MiB and 4). Regular files are also hinted to the kernel as
+// sequential, with each chunk's successor requested while it is read. The
+// descriptor stays the caller's, but its position is unspecified after
+// scanner_destroy, since the reader runs ahead of the scan. Returns 0 on
+// success.
+int scanner_init_readahead(scanner *sc, int fd, size_t chunk_size, int chunks) {
+    if (chunk_size == 0) {
+        chunk_size = READAHEAD_DEFAULT_CHUNK;
+    }
+    if (chunks <= 0) {
+        chunks = READAHEAD_DEFAULT_CHUNKS;
+    }
+    if (chunks < 2) {
+        chunks = 2; // One being parsed, one being read
+    }
+
+    // Step 1: Allocate the ring and the scanner's own buffer
+    read_ring *ra = calloc(1, sizeof(read_ring));
+    char *buf = malloc(chunk_size);
+    if (ra == NULL || buf == NULL) {
+        free(ra);
+        free(buf);
+        return -1;
+    }
+    ra->fd = fd;
+    ra->chunk_size = chunk_size;
+    ra->count = (uint32_t)chunks;
+    ra->chunks = calloc((size_t)chunks, sizeof(char *));
+    ra->lens = calloc((size_t)chunks, sizeof(size_t));
+    int ok = (ra->chunks != NULL && ra->lens != NULL);
+    for (int i = 0; ok && i < chunks; i++) {
+        ra->chunks[i] = malloc(chunk_size);
+        ok = (ra->chunks[i] != NULL);
+    }
+    if (!ok) {
+        free_readahead(ra);
+        free(buf);
+        return -1;
+    }
+
+    // Step 2: Tell the kernel how a regular file will be read
+    struct stat st;
+    ra->hint = -1;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        ra->hint = lseek(fd, 0, SEEK_CUR);
+        if (ra->hint >= 0) {
+            posix_fadvise(fd, ra->hint, 0, POSIX_FADV_SEQUENTIAL);
+        }
+    }
+
+    // Step 3: Start reading
+    if (pthread_create(&ra->thread, NULL, reader_main, ra) != 0) {
+        free_readahead(ra);
+        free(buf);
+        return -1;
+    }
+
+    sc->buf = buf;
+    sc->cap = chunk_size;
+    sc->cur = buf;
+    sc->end = buf;
+    sc->fill = fill_from_readahead;
+    sc->source = ra;
+    sc->stream = NULL;
+    sc->fd = -1; // Read-ahead bytes cannot be handed back
+    sc->eof = 0;
+    sc->owns_buf = 1;
+    sc->map = NULL;
+    sc->map_len = 0;
+    sc->origin = buf;
+    sc->base = 0;
+    sc->pin = SCANNER_NO_PIN;
+    sc->arena = NULL;
+    sc->intern = NULL;
+    sc->release = release_readahead;
+    return 0;
+}
+
+// READER THREAD //
+
+static void *reader_main(void *arg) {
+    read_ring *ra = arg;
+    // Only a blocking read may be cancelled (see release_readahead)
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+
+    for (;;) {
+        // Step 1: Wait for a free chunk
+        uint32_t head = ra->head;
+        for (;;) {
+            uint32_t seen = __atomic_load_n(&ra->reader_wake, __ATOMIC_SEQ_CST);
+            if (__atomic_load_n(&ra->stop, __ATOMIC_SEQ_CST)) {
+                return NULL;
+            }
+            if (head - __atomic_load_n(&ra->tail, __ATOMIC_SEQ_CST) < ra->count) {
+                break;
+            }
+            __atomic_store_n(&ra->reader_waiting, 1, __ATOMIC_SEQ_CST);
+            if (head - __atomic_load_n(&ra->tail, __ATOMIC_SEQ_CST) == ra->count &&
+                !__atomic_load_n(&ra->stop, __ATOMIC_SEQ_CST)) {
+                wait_on(&ra->reader_wake, seen);
+            }
+            __atomic_store_n(&ra->reader_waiting, 0, __ATOMIC_SEQ_CST);
+        }
+
+        // Step 2: Ask for the chunk after this one, then read this one
+        if (ra->hint >= 0) {
+            posix_fadvise(ra->fd, ra->hint + (off_t)ra->chunk_size, (off_t)ra->chunk_size,
+                          POSIX_FADV_WILLNEED);
+        }
+        uint32_t slot = head % ra->count;
+        ssize_t got;
+        do {
+            pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+            got = read(ra->fd, ra->chunks[slot], ra->chunk_size);
+            pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+        } while (got < 0 && errno == EINTR);
+        if (got < 0) {
+            got = 0; // A read error ends the input, as for fd scanners
+        }
+        if (ra->hint >= 0) {
+            ra->hint += got;
+        }
+
+        // Step 3: Publish it; a chunk of length 0 is the end marker
+        ra->lens[slot] = (size_t)got;
+        __atomic_store_n(&ra->head, head + 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&ra->parser_waiting, __ATOMIC_SEQ_CST)) {
+            wake_on(&ra->head);
+        }
+        if (got == 0) {
+            return NULL;
+        }
+    }
+}
+
+// PARSER SIDE //
+
+// Copies up to n bytes out of the ring. Chunks are given back to the reader
+// as soon as they are used up. Blocks only when nothing at all has been
+// copied yet, so a slow pipe delivers what it has.
+static size_t fill_from_readahead(void *source, char *dst, size_t n) {
+    read_ring *ra = source;
+    size_t copied = 0;
+    while (copied < n && !ra->done) {
+        if (ra->data == NULL) {
+            // Step 1: Take the next chunk, sleeping until one is ready
+            uint32_t tail = ra->tail;
+            while (__atomic_load_n(&ra->head, __ATOMIC_ACQUIRE) == tail) {
+                if (copied > 0) {
+                    return copied;
+                }
+                __atomic_store_n(&ra->parser_waiting, 1, __ATOMIC_SEQ_CST);
+                if (__atomic_load_n(&ra->head, __ATOMIC_SEQ_CST) == tail) {
+                    wait_on(&ra->head, tail);
+                }
+                __atomic_store_n(&ra->parser_waiting, 0, __ATOMIC_SEQ_CST);
+            }
+            uint32_t slot = tail % ra->count;
+            ra->data = ra->chunks[slot];
+            ra->len = ra->lens[slot];
+            ra->pos = 0;
+            if (ra->len == 0) {
+                ra->done = 1;
+            }
+        }
+
+        // Step 2: Copy what fits
+        size_t take = ra->len - ra->pos;
+        if (take > n - copied) {
+            take = n - copied;
+        }
+        memcpy(dst + copied, ra->data + ra->pos, take);
+        copied += take;
+        ra->pos += take;
+
+        // Step 3: Hand a finished chunk back to the reader
+        if (ra->pos == ra->len && !ra->done) {
+            ra->data = NULL;
+            __atomic_store_n(&ra->tail, ra->tail + 1, __ATOMIC_SEQ_CST);
+            if (__atomic_load_n(&ra->reader_waiting, __ATOMIC_SEQ_CST)) {
+                __atomic_add_fetch(&ra->reader_wake, 1, __ATOMIC_SEQ_CST);
+                wake_on(&ra->reader_wake);
+            }
+        }
+    }
+    return copied;
+}
+
+// Stops the reader (waking it if it waits for a free chunk, cancelling it if
+// it is blocked in read) and frees everything
+static void release_readahead(void *source) {
+    read_ring *ra = source;
+    __atomic_store_n(&ra->stop, 1, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&ra->reader_wake, 1, __ATOMIC_SEQ_CST);
+    wake_on(&ra->reader_wake);
+    pthread_cancel(ra->thread);
+    pthread_join(ra->thread, NULL);
+    free_readahead(ra);
+}
+
+static void free_readahead(read_ring *ra) {
+    for (uint32_t i = 0; ra->chunks != NULL && i < ra->count; i++) {
+        free(ra->chunks[i]);
+    }
+    free(ra->chunks);
+    free(ra->lens);
+    free(ra);
+}
+
+// Sleeps while *word still holds seen (returns at once if it has changed)
+static void wait_on(uint32_t *word, uint32_t seen) {
+#ifdef __linux__
+    syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, seen, NULL, NULL, 0);
+#else
+    if (__atomic_load_n(word, __ATOMIC_SEQ_CST) == seen) {
+        sched_yield();
+    }
+#endif
+}
+
+static void wake_on(uint32_t *word) {
+#ifdef __linux__
+    syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#else
+    (void)word;
+#endif
+}
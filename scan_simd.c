@@ -0,0 +1,507 @@
+#include <stdint.h>
+
+#include "scan_simd.h"
+
+#if defined(__x86_64__)
+#define SCAN_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+// Whitespace is ' ' plus the control range '\t'..'\r' (9-13), the same set
+// as is_whitespace()
+static inline int byte_is_whitespace(unsigned char c) {
+    return c == ' ' || (unsigned char)(c - '\t') <= '\r' - '\t';
+}
+
+// SCALAR KERNELS //
+
+static const char *find_non_whitespace_scalar(const char *p, const char *end) {
+    while (p < end && byte_is_whitespace((unsigned char)*p)) {
+        p++;
+    }
+    return p;
+}
+
+static const char *find_whitespace_scalar(const char *p, const char *end) {
+    while (p < end && !byte_is_whitespace((unsigned char)*p)) {
+        p++;
+    }
+    return p;
+}
+
+// Word characters are [A-Za-z0-9_], the same set as is_word_char()
+static inline int byte_is_word(unsigned char c) {
+    return (unsigned char)((c | 0x20) - 'a') <= 'z' - 'a' || (unsigned char)(c - '0') <= 9 ||
+           c == '_';
+}
+
+static const char *find_non_word_scalar(const char *p, const char *end) {
+    while (p < end && byte_is_word((unsigned char)*p)) {
+        p++;
+    }
+    return p;
+}
+
+static const char *find_newline_scalar(const char *p, const char *end) {
+    while (p < end && *p != '\n') {
+        p++;
+    }
+    return p;
+}
+
+static const char *find_not_in_set_scalar(const scan_set *set, const char *p, const char *end) {
+    while (p < end) {
+        unsigned char c = (unsigned char)*p;
+        if (!(set->bitmap[c >> 3] & (1u << (c & 7)))) {
+            break;
+        }
+        p++;
+    }
+    return p;
+}
+
+// Value of each byte as a hex digit, or -1; filled in by scan_simd_init
+static int8_t hex_values[256];
+
+static int hex_prefix16_scalar(const char *p, uint64_t *value) {
+    uint64_t v = 0;
+    int n = 0;
+    while (n < 16) {
+        int d = hex_values[(unsigned char)p[n]];
+        if (d < 0) {
+            break;
+        }
+        v = (v << 4) | (uint64_t)d;
+        n++;
+    }
+    *value = v;
+    return n;
+}
+
+static int binary_prefix64_scalar(const char *p, uint64_t *value) {
+    uint64_t v = 0;
+    int n = 0;
+    while (n < 64 && (p[n] == '0' || p[n] == '1')) {
+        v = (v << 1) | (uint64_t)(p[n] - '0');
+        n++;
+    }
+    *value = v;
+    return n;
+}
+
+// Reverses the bit order of a word, so bit 0 (first character) becomes bit 63
+static inline uint64_t reverse_bits64(uint64_t x) {
+    x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+    x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+    x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    return __builtin_bswap64(x);
+}
+
+// Turns "one" and "valid" bitmaps (bit i = character i) into a digit count and value
+static inline int binary_from_masks(uint64_t ones, uint64_t valid, uint64_t *value) {
+    int n = (~valid == 0) ? 64 : __builtin_ctzll(~valid);
+    if (n == 0) {
+        *value = 0;
+        return 0;
+    }
+    uint64_t bits = (n == 64) ? ones : ones & ((1ULL << n) - 1);
+    *value = reverse_bits64(bits) >> (64 - n);
+    return n;
+}
+
+#ifdef SCAN_SIMD_X86
+
+// SSE2 KERNELS //
+
+// Mask of lanes holding whitespace: c == ' ' or (c - 9) <= 4 unsigned
+static inline int whitespace_mask_sse2(__m128i v) {
+    __m128i shifted = _mm_sub_epi8(v, _mm_set1_epi8('\t'));
+    __m128i in_range = _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8('\r' - '\t')), shifted);
+    __m128i space = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+    return _mm_movemask_epi8(_mm_or_si128(in_range, space));
+}
+
+static const char *find_non_whitespace_sse2(const char *p, const char *end) {
+    while (end - p >= 16) {
+        int mask = ~whitespace_mask_sse2(_mm_loadu_si128((const __m128i *)p)) & 0xFFFF;
+        if (mask != 0) {
+            return p + __builtin_ctz((unsigned)mask);
+        }
+        p += 16;
+    }
+    return find_non_whitespace_scalar(p, end);
+}
+
+static const char *find_whitespace_sse2(const char *p, const char *end) {
+    while (end - p >= 16) {
+        int mask = whitespace_mask_sse2(_mm_loadu_si128((const __m128i *)p));
+        if (mask != 0) {
+            return p + __builtin_ctz((unsigned)mask);
+        }
+        p += 16;
+    }
+    return find_whitespace_scalar(p, end);
+}
+
+// Mask of lanes holding word characters: letters (folded to lower case),
+// digits and '_'
+static inline int word_mask_sse2(__m128i v) {
+    __m128i lower = _mm_sub_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i letter = _mm_cmpeq_epi8(_mm_min_epu8(lower, _mm_set1_epi8('z' - 'a')), lower);
+    __m128i digit = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+    __m128i underscore = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+    return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(letter, is_digit), underscore));
+}
+
+static const char *find_non_word_sse2(const char *p, const char *end) {
+    while (end - p >= 16) {
+        int mask = ~word_mask_sse2(_mm_loadu_si128((const __m128i *)p)) & 0xFFFF;
+        if (mask != 0) {
+            return p + __builtin_ctz((unsigned)mask);
+        }
+        p += 16;
+    }
+    return find_non_word_scalar(p, end);
+}
+
+static const char *find_newline_sse2(const char *p, const char *end) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    while (end - p >= 16) {
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)p), newline));
+        if (mask != 0) {
+            return p + __builtin_ctz((unsigned)mask);
+        }
+        p += 16;
+    }
+    return find_newline_scalar(p, end);
+}
+
+// Packs the first n of 16 nibble lanes (zero past the run) into a word:
+// pairs of nibbles are merged into bytes and the eight bytes are byte-swapped
+// into place
+static inline int hex_from_nibbles(__m128i nibbles, int n, uint64_t *value) {
+    if (n == 0) {
+        *value = 0;
+        return 0;
+    }
+    // Each 16-bit lane becomes (first nibble << 4) | second nibble
+    __m128i pairs = _mm_or_si128(_mm_and_si128(_mm_slli_epi16(nibbles, 4), _mm_set1_epi16(0x00F0)),
+                                 _mm_srli_epi16(nibbles, 8));
+    __m128i packed = _mm_packus_epi16(pairs, pairs);
+    uint64_t full = __builtin_bswap64((uint64_t)_mm_cvtsi128_si64(packed));
+
+    // Digits past the run sit in the low bits and shift out
+    *value = (n == 16) ? full : full >> (4 * (16 - n));
+    return n;
+}
+
+// Classifies 16 bytes as hex digits with two range checks, which also give
+// the nibble values
+static int hex_prefix16_sse2(const char *p, uint64_t *value) {
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    __m128i digit = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+    __m128i alpha = _mm_sub_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i is_alpha = _mm_cmpeq_epi8(_mm_min_epu8(alpha, _mm_set1_epi8(5)), alpha);
+
+    int valid = _mm_movemask_epi8(_mm_or_si128(is_digit, is_alpha));
+    int n = __builtin_ctz((unsigned)~valid | 0x10000u);
+    __m128i nibbles = _mm_or_si128(_mm_and_si128(is_digit, digit),
+                                   _mm_and_si128(is_alpha, _mm_add_epi8(alpha, _mm_set1_epi8(10))));
+    return hex_from_nibbles(nibbles, n, value);
+}
+
+static int binary_prefix64_sse2(const char *p, uint64_t *value) {
+    uint64_t ones = 0;
+    uint64_t valid = 0;
+    for (int k = 0; k < 4; k++) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + 16 * k));
+        uint64_t ok = (uint64_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_or_si128(v, _mm_set1_epi8(1)),
+                                                                 _mm_set1_epi8('1')));
+        uint64_t one = (uint64_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('1')));
+        valid |= ok << (16 * k);
+        ones |= one << (16 * k);
+        if (ok != 0xFFFF) {
+            break; // The run ends in this block
+        }
+    }
+    return binary_from_masks(ones, valid, value);
+}
+
+// SSSE3 KERNELS //
+
+// Classifies 16 bytes as hex digits with nibble-table shuffles: the high
+// nibble picks a class (3 for digits, 4 and 6 for letters), the low nibble
+// must belong to it, and a third table adds 9 to the low nibble of letters
+__attribute__((target("ssse3")))
+static int hex_prefix16_ssse3(const char *p, uint64_t *value) {
+    const __m128i class_by_high = _mm_setr_epi8(0, 0, 0, 1, 2, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i class_by_low = _mm_setr_epi8(1, 3, 3, 3, 3, 3, 3, 1, 1, 1, 0, 0, 0, 0, 0, 0);
+    const __m128i offset_by_high = _mm_setr_epi8(0, 0, 0, 0, 9, 0, 9, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    __m128i lo = _mm_and_si128(v, nibble);
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), nibble);
+    __m128i classes = _mm_and_si128(_mm_shuffle_epi8(class_by_high, hi), _mm_shuffle_epi8(class_by_low, lo));
+    __m128i invalid = _mm_cmpeq_epi8(classes, _mm_setzero_si128());
+
+    int n = __builtin_ctz((unsigned)_mm_movemask_epi8(invalid) | 0x10000u);
+    __m128i nibbles = _mm_andnot_si128(invalid, _mm_add_epi8(lo, _mm_shuffle_epi8(offset_by_high, hi)));
+    return hex_from_nibbles(nibbles, n, value);
+}
+
+// Set membership for 16 bytes, as in the AVX2 kernel below. Without a blend,
+// the row comes from two shuffles indexed by the low nibble plus the top bit
+// of the byte: a shuffle index with its top bit set gives 0, so exactly one of
+// the two tables contributes
+__attribute__((target("ssse3")))
+static const char *find_not_in_set_ssse3(const scan_set *set, const char *p, const char *end) {
+    const __m128i low = _mm_loadu_si128((const __m128i *)set->low);
+    const __m128i high = _mm_loadu_si128((const __m128i *)set->high);
+    const __m128i bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m128i top = _mm_set1_epi8(-128);
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        __m128i index = _mm_and_si128(v, _mm_set1_epi8((char)0x8F));
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), nibble);
+        __m128i row = _mm_or_si128(_mm_shuffle_epi8(low, index),
+                                   _mm_shuffle_epi8(high, _mm_xor_si128(index, top)));
+        __m128i bit = _mm_shuffle_epi8(bits, hi);
+        __m128i in_set = _mm_cmpeq_epi8(_mm_and_si128(row, bit), bit);
+        int mask = ~_mm_movemask_epi8(in_set) & 0xFFFF;
+        if (mask != 0) {
+            return p + __builtin_ctz((unsigned)mask);
+        }
+        p += 16;
+    }
+    return find_not_in_set_scalar(set, p, end);
+}
+
+// AVX2 KERNELS //
+
+__attribute__((target("avx2")))
+static int binary_prefix64_avx2(const char *p, uint64_t *value) {
+    uint64_t ones = 0;
+    uint64_t valid = 0;
+    for (int k = 0; k < 2; k++) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + 32 * k));
+        uint64_t ok = (uint32_t)_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_or_si256(v, _mm256_set1_epi8(1)), _mm256_set1_epi8('1')));
+        uint64_t one = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('1')));
+        valid |= ok << (32 * k);
+        ones |= one << (32 * k);
+        if (ok != 0xFFFFFFFFu) {
+            break;
+        }
+    }
+    return binary_from_masks(ones, valid, value);
+}
+
+__attribute__((target("avx2")))
+static inline uint32_t whitespace_mask_avx2(__m256i v) {
+    __m256i shifted = _mm256_sub_epi8(v, _mm256_set1_epi8('\t'));
+    __m256i in_range = _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8('\r' - '\t')), shifted);
+    __m256i space = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '));
+    return (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(in_range, space));
+}
+
+__attribute__((target("avx2")))
+static const char *find_non_whitespace_avx2(const char *p, const char *end) {
+    while (end - p >= 32) {
+        uint32_t mask = ~whitespace_mask_avx2(_mm256_loadu_si256((const __m256i *)p));
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 32;
+    }
+    return find_non_whitespace_sse2(p, end);
+}
+
+__attribute__((target("avx2")))
+static const char *find_whitespace_avx2(const char *p, const char *end) {
+    while (end - p >= 32) {
+        uint32_t mask = whitespace_mask_avx2(_mm256_loadu_si256((const __m256i *)p));
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 32;
+    }
+    return find_whitespace_sse2(p, end);
+}
+
+__attribute__((target("avx2")))
+static const char *find_non_word_avx2(const char *p, const char *end) {
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        __m256i lower = _mm256_sub_epi8(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+        __m256i letter = _mm256_cmpeq_epi8(_mm256_min_epu8(lower, _mm256_set1_epi8('z' - 'a')), lower);
+        __m256i digit = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+        __m256i is_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, _mm256_set1_epi8(9)), digit);
+        __m256i underscore = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+        uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_or_si256(letter, is_digit), underscore));
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 32;
+    }
+    return find_non_word_sse2(p, end);
+}
+
+// Lines are usually longer than one vector, so this looks at 64 bytes per
+// step and only works out which half matched once either did
+__attribute__((target("avx2")))
+static const char *find_newline_avx2(const char *p, const char *end) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    while (end - p >= 64) {
+        __m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)p), newline);
+        __m256i b = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(p + 32)), newline);
+        if (!_mm256_testz_si256(_mm256_or_si256(a, b), _mm256_or_si256(a, b))) {
+            uint64_t mask = (uint32_t)_mm256_movemask_epi8(a) |
+                            ((uint64_t)(uint32_t)_mm256_movemask_epi8(b) << 32);
+            return p + __builtin_ctzll(mask);
+        }
+        p += 64;
+    }
+    return find_newline_sse2(p, end);
+}
+
+// Set membership for 32 bytes with two shuffles: the low nibble picks a row
+// of eight membership bits (from low or high by the top bit of the byte), and
+// the high nibble picks which bit of the row to test
+__attribute__((target("avx2")))
+static const char *find_not_in_set_avx2(const scan_set *set, const char *p, const char *end) {
+    __m256i low = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)set->low));
+    __m256i high = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)set->high));
+    __m256i bits = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+                                    1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    __m256i nibble = _mm256_set1_epi8(0x0F);
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        __m256i lo = _mm256_and_si256(v, nibble);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble);
+        __m256i row = _mm256_blendv_epi8(_mm256_shuffle_epi8(low, lo), _mm256_shuffle_epi8(high, lo), v);
+        __m256i bit = _mm256_shuffle_epi8(bits, hi);
+        __m256i in_set = _mm256_cmpeq_epi8(_mm256_and_si256(row, bit), bit);
+        uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(in_set);
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 32;
+    }
+    return find_not_in_set_ssse3(set, p, end);
+}
+
+#endif
+
+// DISPATCH //
+
+const char *(*find_non_whitespace)(const char *p, const char *end) = find_non_whitespace_scalar;
+const char *(*find_whitespace)(const char *p, const char *end) = find_whitespace_scalar;
+const char *(*find_non_word)(const char *p, const char *end) = find_non_word_scalar;
+const char *(*find_newline)(const char *p, const char *end) = find_newline_scalar;
+const char *(*find_not_in_set)(const scan_set *set, const char *p, const char *end) = find_not_in_set_scalar;
+int (*hex_prefix16)(const char *p, uint64_t *value) = hex_prefix16_scalar;
+int (*binary_prefix64)(const char *p, uint64_t *value) = binary_prefix64_scalar;
+
+static enum scan_simd_level current_level = SCAN_SIMD_SCALAR;
+
+static enum scan_simd_level detect_level(void) {
+#ifdef SCAN_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return SCAN_SIMD_AVX2;
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        return SCAN_SIMD_SSSE3;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return SCAN_SIMD_SSE2;
+    }
+#endif
+    return SCAN_SIMD_SCALAR;
+}
+
+void scan_simd_force(enum scan_simd_level level) {
+    enum scan_simd_level best = detect_level();
+    if (level > best) {
+        level = best;
+    }
+
+    current_level = level;
+    switch (level) {
+#ifdef SCAN_SIMD_X86
+        case SCAN_SIMD_AVX2:
+            find_non_whitespace = find_non_whitespace_avx2;
+            find_whitespace = find_whitespace_avx2;
+            find_non_word = find_non_word_avx2;
+            find_newline = find_newline_avx2;
+            find_not_in_set = find_not_in_set_avx2;
+            hex_prefix16 = hex_prefix16_ssse3; // 16 digits fill a word, so no wider version
+            binary_prefix64 = binary_prefix64_avx2;
+            break;
+        case SCAN_SIMD_SSSE3:
+            find_non_whitespace = find_non_whitespace_sse2;
+            find_whitespace = find_whitespace_sse2;
+            find_non_word = find_non_word_sse2;
+            find_newline = find_newline_sse2;
+            find_not_in_set = find_not_in_set_ssse3;
+            hex_prefix16 = hex_prefix16_ssse3;
+            binary_prefix64 = binary_prefix64_sse2;
+            break;
+        case SCAN_SIMD_SSE2:
+            find_non_whitespace = find_non_whitespace_sse2;
+            find_whitespace = find_whitespace_sse2;
+            find_non_word = find_non_word_sse2;
+            find_newline = find_newline_sse2;
+            find_not_in_set = find_not_in_set_scalar; // Needs a byte shuffle, which SSE2 lacks
+            hex_prefix16 = hex_prefix16_sse2;
+            binary_prefix64 = binary_prefix64_sse2;
+            break;
+#endif
+        default:
+            find_non_whitespace = find_non_whitespace_scalar;
+            find_whitespace = find_whitespace_scalar;
+            find_non_word = find_non_word_scalar;
+            find_newline = find_newline_scalar;
+            find_not_in_set = find_not_in_set_scalar;
+            hex_prefix16 = hex_prefix16_scalar;
+            binary_prefix64 = binary_prefix64_scalar;
+            break;
+    }
+}
+
+void scan_set_prepare(scan_set *set) {
+    memset(set->low, 0, sizeof(set->low));
+    memset(set->high, 0, sizeof(set->high));
+    for (int c = 0; c < 256; c++) {
+        if (set->bitmap[c >> 3] & (1u << (c & 7))) {
+            uint8_t *row = (c < 128) ? set->low : set->high;
+            row[c & 0x0F] |= (uint8_t)(1u << ((c >> 4) & 7));
+        }
+    }
+}
+
+enum scan_simd_level scan_simd_level(void) {
+    return current_level;
+}
+
+// Pick the best kernels before main() runs so the pointers never change under
+// concurrent scanners
+__attribute__((constructor))
+static void scan_simd_init(void) {
+    for (int c = 0; c < 256; c++) {
+        hex_values[c] = -1;
+    }
+    for (int d = 0; d < 10; d++) {
+        hex_values['0' + d] = (int8_t)d;
+    }
+    for (int d = 0; d < 6; d++) {
+        hex_values['a' + d] = (int8_t)(10 + d);
+        hex_values['A' + d] = (int8_t)(10 + d);
+    }
+    scan_simd_force(SCAN_SIMD_AVX2);
+}
@@ -0,0 +1,84 @@
+#ifndef SCAN_SIMD_H
+#define SCAN_SIMD_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Vectorized byte-class kernels used by the read_* helpers. Each kernel has a
+// scalar version and, on x86, SSE2, SSSE3 and AVX2 versions picked at startup
+// from CPUID. All of them work on a contiguous range [p, end) and return end
+// when nothing matches, so callers can refill and try again.
+
+enum scan_simd_level {
+    SCAN_SIMD_SCALAR,
+    SCAN_SIMD_SSE2,
+    SCAN_SIMD_SSSE3,
+    SCAN_SIMD_AVX2
+};
+
+// First byte in [p, end) that is not whitespace
+extern const char *(*find_non_whitespace)(const char *p, const char *end);
+// First whitespace byte in [p, end), i.e. the end of the current token
+extern const char *(*find_whitespace)(const char *p, const char *end);
+// First byte in [p, end) that is not a word character ([A-Za-z0-9_])
+extern const char *(*find_non_word)(const char *p, const char *end);
+// First '\n' in [p, end), i.e. the end of the current line
+extern const char *(*find_newline)(const char *p, const char *end);
+
+// A compiled %[...] scanset. The bitmap is the set itself; the two nibble
+// tables are the same bits rearranged for a 16-entry byte shuffle: entry l of
+// low has bit h set when byte (h << 4 | l) is in the set for h < 8, and high
+// does the same for h >= 8 (bit h - 8).
+typedef struct scan_set {
+    uint8_t bitmap[32];
+    uint8_t low[16];
+    uint8_t high[16];
+} scan_set;
+
+// Fills in the nibble tables from the bitmap
+void scan_set_prepare(scan_set *set);
+// First byte in [p, end) that is not in the set
+extern const char *(*find_not_in_set)(const scan_set *set, const char *p, const char *end);
+
+// Leading run of hex digits in the 16 bytes at p (all readable): returns how
+// many there are (0-16) and stores their value, first digit most significant
+extern int (*hex_prefix16)(const char *p, uint64_t *value);
+// Same for '0'/'1' digits in the 64 bytes at p (all readable)
+extern int (*binary_prefix64)(const char *p, uint64_t *value);
+
+enum scan_simd_level scan_simd_level(void);
+// Forces a lower level (e.g. for benchmarking); levels the CPU lacks are clamped
+void scan_simd_force(enum scan_simd_level level);
+
+// SWAR DIGIT KERNELS //
+// Portable 64-bit tricks for eight ASCII digits at once; no dispatch needed.
+
+// Loads eight bytes so that the first byte is the least significant
+static inline uint64_t load_eight_bytes(const char *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+// True if all eight bytes are '0'..'9'
+static inline int is_eight_digits(uint64_t v) {
+    return (((v & 0xF0F0F0F0F0F0F0F0ULL) |
+             (((v + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) ==
+            0x3333333333333333ULL);
+}
+
+// Value of eight ASCII digits (first byte most significant) in three multiplies
+static inline uint32_t parse_eight_digits(uint64_t v) {
+    const uint64_t mask = 0x000000FF000000FFULL;
+    const uint64_t mul1 = 0x000F424000000064ULL; // 100 + (1000000 << 32)
+    const uint64_t mul2 = 0x0000271000000001ULL; // 1 + (10000 << 32)
+    v -= 0x3030303030303030ULL;
+    v = (v * 10) + (v >> 8); // Pairs of digits
+    v = (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32;
+    return (uint32_t)v;
+}
+
+#endif
@@ -0,0 +1,199 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "scan_stats.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define SCAN_STATS_TSC 1
+#endif
+
+// Every counter is a uint64_t, so a thread's block can be summed or cleared
+// as a flat array of this many words
+#define COUNTER_WORDS (SCAN_STAT_KINDS * sizeof(scan_stat_counters) / sizeof(uint64_t))
+
+static const char *kind_names[SCAN_STAT_KINDS] = {
+    "%c", "%d", "%u", "%s", "%f", "%x", "%b", "%r", "%w", "%W", "%v", "%[", "%N", "custom",
+    "literal", "unknown"
+};
+
+const char *scan_stat_kind_name(enum scan_stat_kind kind) {
+    return (kind < SCAN_STAT_KINDS) ? kind_names[kind] : "?";
+}
+
+int scan_stats_enabled(void) {
+#ifdef MY_SCANF_STATS
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+uint64_t scan_stats_clock(void) {
+#ifdef SCAN_STATS_TSC
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+#ifdef MY_SCANF_STATS
+
+// One block per thread, pushed onto a global list the first time the thread
+// records anything. Blocks are never freed so their counts outlive the thread.
+typedef struct stats_block {
+    scan_stat_counters kinds[SCAN_STAT_KINDS];
+    struct stats_block *next;
+} stats_block;
+
+static stats_block *all_blocks;
+static _Thread_local stats_block *my_block;
+static _Thread_local int last_failed;
+static _Thread_local enum scan_stat_kind last_kind;
+static _Thread_local enum scan_fail_reason last_reason;
+
+static stats_block *thread_block(void) {
+    if (my_block == NULL) {
+        stats_block *block = calloc(1, sizeof(stats_block));
+        if (block == NULL) {
+            return NULL;
+        }
+        // Lock-free push
+        block->next = __atomic_load_n(&all_blocks, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&all_blocks, &block->next, block, 1,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        }
+        my_block = block;
+    }
+    return my_block;
+}
+
+// Only the owning thread writes a counter, so a load and a store suffice; the
+// atomics just keep concurrent snapshots well defined
+static inline void bump(uint64_t *counter, uint64_t n) {
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+}
+
+// A new scan starts: an earlier one's failure is no longer the most recent scan's
+void scan_stats_scan_begin(void) {
+    last_failed = 0;
+}
+
+void scan_stats_record(enum scan_stat_kind kind, int ok, enum scan_fail_reason reason,
+                       uint64_t bytes, uint64_t cycles) {
+    stats_block *block = thread_block();
+    if (block == NULL) {
+        return;
+    }
+    scan_stat_counters *c = &block->kinds[kind];
+    bump(&c->calls, 1);
+    if (ok) {
+        bump(&c->successes, 1);
+    } else {
+        bump(&c->failures[reason], 1);
+        last_failed = 1;
+        last_kind = kind;
+        last_reason = reason;
+    }
+    bump(&c->bytes, bytes);
+    bump(&c->cycles, cycles);
+
+    int bucket = (cycles == 0) ? 0 : 63 - __builtin_clzll(cycles);
+    if (bucket >= SCAN_STATS_BUCKETS) {
+        bucket = SCAN_STATS_BUCKETS - 1;
+    }
+    bump(&c->histogram[bucket], 1);
+}
+
+void scan_stats_snapshot_take(scan_stats_snapshot *out) {
+    memset(out, 0, sizeof(*out));
+    stats_block *block = __atomic_load_n(&all_blocks, __ATOMIC_ACQUIRE);
+    for (; block != NULL; block = block->next) {
+        const uint64_t *src = (const uint64_t *)block->kinds;
+        uint64_t *dst = (uint64_t *)out->kinds;
+        for (size_t i = 0; i < COUNTER_WORDS; i++) {
+            dst[i] += __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+        }
+    }
+}
+
+void scan_stats_reset(void) {
+    stats_block *block = __atomic_load_n(&all_blocks, __ATOMIC_ACQUIRE);
+    for (; block != NULL; block = block->next) {
+        uint64_t *words = (uint64_t *)block->kinds;
+        for (size_t i = 0; i < COUNTER_WORDS; i++) {
+            __atomic_store_n(&words[i], 0, __ATOMIC_RELAXED);
+        }
+    }
+    last_failed = 0;
+}
+
+int scan_stats_last_failure(enum scan_stat_kind *kind, enum scan_fail_reason *reason) {
+    if (!last_failed) {
+        return 0;
+    }
+    *kind = last_kind;
+    *reason = last_reason;
+    return 1;
+}
+
+#else
+
+void scan_stats_record(enum scan_stat_kind kind, int ok, enum scan_fail_reason reason,
+                       uint64_t bytes, uint64_t cycles) {
+    (void)kind;
+    (void)ok;
+    (void)reason;
+    (void)bytes;
+    (void)cycles;
+}
+
+void scan_stats_snapshot_take(scan_stats_snapshot *out) {
+    memset(out, 0, sizeof(*out));
+}
+
+void scan_stats_reset(void) {
+}
+
+int scan_stats_last_failure(enum scan_stat_kind *kind, enum scan_fail_reason *reason) {
+    (void)kind;
+    (void)reason;
+    return 0;
+}
+
+#endif
+
+void scan_stats_print(FILE *stream, const scan_stats_snapshot *snap) {
+    fprintf(stream, "%-8s %12s %12s %10s %10s %10s %14s %10s  %s\n", "kind", "calls", "ok",
+            "mismatch", "eof", "unknown", "bytes", "cyc/call", "median bucket");
+    for (int k = 0; k < SCAN_STAT_KINDS; k++) {
+        const scan_stat_counters *c = &snap->kinds[k];
+        if (c->calls == 0) {
+            continue;
+        }
+
+        // Bucket holding the median call
+        uint64_t seen = 0;
+        int median = 0;
+        for (int b = 0; b < SCAN_STATS_BUCKETS; b++) {
+            seen += c->histogram[b];
+            if (seen * 2 >= c->calls) {
+                median = b;
+                break;
+            }
+        }
+
+        fprintf(stream, "%-8s %12llu %12llu %10llu %10llu %10llu %14llu %10.1f  [%llu, %llu)\n",
+                kind_names[k], (unsigned long long)c->calls, (unsigned long long)c->successes,
+                (unsigned long long)c->failures[SCAN_FAIL_MISMATCH],
+                (unsigned long long)c->failures[SCAN_FAIL_EOF],
+                (unsigned long long)c->failures[SCAN_FAIL_UNSUPPORTED],
+                (unsigned long long)c->bytes, (double)c->cycles / (double)c->calls,
+                1ULL << median, 1ULL << (median + 1));
+    }
+}
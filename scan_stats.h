@@ -0,0 +1,79 @@
+#ifndef SCAN_STATS_H
+#define SCAN_STATS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Optional hot-path statistics, compiled in with -DMY_SCANF_STATS. Every
+// thread counts into its own block with plain (relaxed) stores, so recording
+// never takes a lock; a snapshot sums all blocks, including those of threads
+// that have exited. Without MY_SCANF_STATS the hooks compile to nothing and a
+// snapshot is all zeros.
+
+// What an op was: one kind per conversion, plus literals and unknown specifiers
+enum scan_stat_kind {
+    SCAN_STAT_CHAR,     // %c
+    SCAN_STAT_INT,      // %d
+    SCAN_STAT_UNSIGNED, // %u
+    SCAN_STAT_STRING,   // %s
+    SCAN_STAT_FLOAT,    // %f %e %g %a and capitals
+    SCAN_STAT_HEX,      // %x
+    SCAN_STAT_BINARY,   // %b
+    SCAN_STAT_ROMAN,    // %r
+    SCAN_STAT_WORD,     // %w
+    SCAN_STAT_INTERN,   // %W
+    SCAN_STAT_VIEW,     // %v
+    SCAN_STAT_SCANSET,  // %[...]
+    SCAN_STAT_NUMBER,   // %N
+    SCAN_STAT_CUSTOM,   // Registered conversions (scan_register)
+    SCAN_STAT_LITERAL,  // Literal text in the format
+    SCAN_STAT_UNKNOWN,  // Unsupported specifier that stopped the format
+    SCAN_STAT_KINDS
+};
+
+// Why an op failed
+enum scan_fail_reason {
+    SCAN_FAIL_MISMATCH,    // Input did not match (bad character)
+    SCAN_FAIL_EOF,         // Input ended first
+    SCAN_FAIL_UNSUPPORTED, // The format used a specifier the scanner does not know
+    SCAN_FAIL_REASONS
+};
+
+// Cycle histogram buckets: bucket k counts ops that took [2^k, 2^(k+1)) cycles
+#define SCAN_STATS_BUCKETS 32
+
+typedef struct scan_stat_counters {
+    uint64_t calls;
+    uint64_t successes;
+    uint64_t failures[SCAN_FAIL_REASONS];
+    uint64_t bytes;  // Input bytes consumed, including skipped whitespace
+    uint64_t cycles; // Total cycles (TSC ticks, or nanoseconds off x86)
+    uint64_t histogram[SCAN_STATS_BUCKETS];
+} scan_stat_counters;
+
+typedef struct scan_stats_snapshot {
+    scan_stat_counters kinds[SCAN_STAT_KINDS];
+} scan_stats_snapshot;
+
+// 1 if the library was built with MY_SCANF_STATS
+int scan_stats_enabled(void);
+// Sums every thread's counters into *out
+void scan_stats_snapshot_take(scan_stats_snapshot *out);
+// Zeroes every thread's counters (counts racing with the reset may be lost)
+void scan_stats_reset(void);
+// Prints a snapshot as a table, one row per kind that was used
+void scan_stats_print(FILE *stream, const scan_stats_snapshot *snap);
+const char *scan_stat_kind_name(enum scan_stat_kind kind);
+
+// Why the calling thread's most recent scan stopped early: the kind of op and
+// the reason. Returns 0 if that scan did not fail (or stats are off). Each
+// call, batch row, line or push record starts a new scan.
+int scan_stats_last_failure(enum scan_stat_kind *kind, enum scan_fail_reason *reason);
+
+// Recording hooks used by my_scanf.c
+void scan_stats_scan_begin(void);
+uint64_t scan_stats_clock(void);
+void scan_stats_record(enum scan_stat_kind kind, int ok, enum scan_fail_reason reason,
+                       uint64_t bytes, uint64_t cycles);
+
+#endif